@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "cpp14/AsyncQueue.hpp"
+#include "cpp14/Courier.hpp"
+#include "cpp14/LatencyHistogram.hpp"
+
+namespace
+{
+   using Histogram = BasicLatencyHistogram<3>;
+
+   std::uint64_t now()
+   {
+      return static_cast<std::uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch() ).count() );
+   }
+
+   // Añade a los resultados los percentiles de las esperas, en nanosegundos.
+   void report( benchmark::State& aState, const Histogram& aHistogram )
+   {
+      aState.counters["p50_ns"] = static_cast<double>( aHistogram.quantile( 0.5 ) );
+      aState.counters["p99_ns"] = static_cast<double>( aHistogram.quantile( 0.99 ) );
+      aState.counters["p999_ns"] = static_cast<double>( aHistogram.quantile( 0.999 ) );
+   }
+
+   // Mide la espera de cada instante almacenado hasta que llega a la función de la cola.
+   struct Measure
+   {
+      void operator()( std::uint64_t aStamp )
+      {
+         theHistogram->record( now() - aStamp );
+         theDone->fetch_add( 1, std::memory_order_release );
+      }
+
+      Histogram* theHistogram;
+      std::atomic<std::uint64_t>* theDone;
+   };
+
+   void waitFor( const std::atomic<std::uint64_t>& aDone, std::uint64_t aCount )
+   {
+      while( aDone.load( std::memory_order_acquire ) < aCount )
+      {
+         std::this_thread::yield();
+      }
+   }
+
+   // Un objeto almacenado cada vez: la espera de la cola vacía.
+   template<template<typename> class Queue>
+   void AsyncQueueLatency( benchmark::State& aState )
+   {
+      Histogram aHistogram;
+      std::atomic<std::uint64_t> aDone{};
+      AsyncQueue<std::uint64_t, Measure, Queue> aQueue{ Measure{ &aHistogram, &aDone } };
+      std::uint64_t aCount = 0;
+      for( auto _ : aState )
+      {
+         aQueue.store( now() );
+         waitFor( aDone, ++aCount );
+      }
+
+      report( aState, aHistogram );
+   }
+
+   // Ráfagas de objetos: la espera con la cola cargada.
+   template<template<typename> class Queue>
+   void AsyncQueueBurst( benchmark::State& aState )
+   {
+      Histogram aHistogram;
+      std::atomic<std::uint64_t> aDone{};
+      AsyncQueue<std::uint64_t, Measure, Queue> aQueue{ Measure{ &aHistogram, &aDone } };
+      std::uint64_t aCount = 0;
+      for( auto _ : aState )
+      {
+         for( std::int64_t i = 0; i < aState.range( 0 ); ++i )
+         {
+            aQueue.store( now() );
+         }
+
+         aCount += static_cast<std::uint64_t>( aState.range( 0 ) );
+         waitFor( aDone, aCount );
+      }
+
+      aState.SetItemsProcessed( static_cast<std::int64_t>( aCount ) );
+      report( aState, aHistogram );
+   }
+
+   struct Probe;
+
+   // Un destinatario que mide la espera de los envíos.
+   struct Receiver
+   {
+      void receive( const Probe& aProbe );
+
+      Histogram theHistogram;
+      std::atomic<std::uint64_t> theDone{};
+   };
+
+   struct Probe : public Deliverable<Receiver&>
+   {
+      explicit Probe( std::uint64_t aStamp ) : theStamp{ aStamp } {}
+
+      void deliver( Receiver& aReceiver ) const override
+      {
+         aReceiver.receive( *this );
+      }
+
+      std::uint64_t theStamp;
+   };
+
+   void Receiver::receive( const Probe& aProbe )
+   {
+      theHistogram.record( now() - aProbe.theStamp );
+      theDone.fetch_add( 1, std::memory_order_release );
+   }
+
+   template<template<typename> class Queue>
+   void CourierLatency( benchmark::State& aState )
+   {
+      Receiver aReceiver;
+      Courier<Receiver&, Queue> aCourier{ aReceiver };
+      std::uint64_t aCount = 0;
+      for( auto _ : aState )
+      {
+         aCourier.deliver( std::make_shared<Probe>( now() ) );
+         waitFor( aReceiver.theDone, ++aCount );
+      }
+
+      report( aState, aReceiver.theHistogram );
+   }
+}
+
+BENCHMARK_TEMPLATE( AsyncQueueLatency, SafeQueue );
+BENCHMARK_TEMPLATE( AsyncQueueLatency, Waiting<SpinParkWait>::Queue );
+BENCHMARK_TEMPLATE( AsyncQueueLatency, SpscQueue );
+BENCHMARK_TEMPLATE( AsyncQueueBurst, SafeQueue )->Arg( 100 )->Arg( 10000 )->UseRealTime();
+BENCHMARK_TEMPLATE( AsyncQueueBurst, Waiting<SpinParkWait>::Queue )->Arg( 100 )->Arg( 10000 )->UseRealTime();
+BENCHMARK_TEMPLATE( AsyncQueueBurst, SpscQueue )->Arg( 100 )->Arg( 10000 )->UseRealTime();
+BENCHMARK_TEMPLATE( CourierLatency, SafeQueue );
+BENCHMARK_TEMPLATE( CourierLatency, SpscQueue );
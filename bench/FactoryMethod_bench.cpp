@@ -0,0 +1,135 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include "cpp14/AbstractFactory.hpp"
+#include "cpp14/FactoryMethod.hpp"
+
+namespace
+{
+   struct Product
+   {
+      virtual ~Product() {}
+      virtual int value() const = 0;
+   };
+
+   struct Ghibli : public Product
+   {
+      int value() const { return 1; }
+   };
+
+   // Una fábrica con <i>aSize</i> productos registrados con claves enteras.
+   void FactoryMethodCreate( benchmark::State& aState )
+   {
+      FactoryMethod<int, Product> aFactory;
+      for( int i = 0; i < aState.range( 0 ); ++i )
+      {
+         aFactory.registerType<Ghibli>( i );
+      }
+
+      const int aKey = static_cast<int>( aState.range( 0 ) / 2 );
+      for( auto _ : aState )
+      {
+         benchmark::DoNotOptimize( aFactory.create( aKey ) );
+      }
+   }
+
+   void FactoryMethodCreateByName( benchmark::State& aState )
+   {
+      FactoryMethod<std::string, Product> aFactory;
+      for( int i = 0; i < aState.range( 0 ); ++i )
+      {
+         aFactory.registerType<Ghibli>( "Producto" + std::to_string( i ) );
+      }
+
+      const std::string aKey = "Producto" + std::to_string( aState.range( 0 ) / 2 );
+      for( auto _ : aState )
+      {
+         benchmark::DoNotOptimize( aFactory.create( aKey ) );
+      }
+   }
+
+   void FactoryMethodEmplace( benchmark::State& aState )
+   {
+      FactoryMethod<int, Product> aFactory;
+      for( int i = 0; i < aState.range( 0 ); ++i )
+      {
+         aFactory.registerType<Ghibli>( i );
+      }
+
+      const int aKey = static_cast<int>( aState.range( 0 ) / 2 );
+      ProductSlot<Product, 16> aSlot;
+      for( auto _ : aState )
+      {
+         benchmark::DoNotOptimize( aFactory.emplace( aSlot, aKey ) );
+      }
+   }
+
+   struct Chassis
+   {
+      virtual ~Chassis() {}
+      virtual int make() = 0;
+   };
+
+   struct BodyWork
+   {
+      virtual ~BodyWork() {}
+      virtual int manufacture() = 0;
+   };
+
+   struct TotoroChassis : public Chassis
+   {
+      int make() { return 1; }
+   };
+
+   struct TotoroBodyWork : public BodyWork
+   {
+      int manufacture() { return 2; }
+   };
+
+   using CarFactory = AbstractFactory<Chassis, BodyWork>;
+
+   void AbstractFactoryCreate( benchmark::State& aState )
+   {
+      std::shared_ptr<CarFactory> aFactory = std::make_shared<ConcreteFactory<CarFactory, TotoroChassis, TotoroBodyWork>>();
+      for( auto _ : aState )
+      {
+         std::unique_ptr<Chassis> aChassis{ aFactory->create<Chassis>() };
+         benchmark::DoNotOptimize( aChassis.get() );
+      }
+   }
+
+   void StaticAbstractFactoryCreate( benchmark::State& aState )
+   {
+      StaticConcreteFactory<CarFactory, TotoroChassis, TotoroBodyWork> aFactory;
+      for( auto _ : aState )
+      {
+         std::unique_ptr<TotoroChassis> aChassis{ aFactory.create<Chassis>() };
+         benchmark::DoNotOptimize( aChassis.get() );
+      }
+   }
+
+   void AllocatingAbstractFactoryCreate( benchmark::State& aState )
+   {
+      using ArenaFactory = AllocatingAbstractFactory<Chassis, BodyWork>;
+      alignas( std::max_align_t ) unsigned char aBuffer[4096];
+      MonotonicBufferResource anArena{ aBuffer, sizeof( aBuffer ) };
+      std::shared_ptr<ArenaFactory> aFactory =
+         std::make_shared<AllocatingConcreteFactory<ArenaFactory, TotoroChassis, TotoroBodyWork>>( &anArena );
+      for( auto _ : aState )
+      {
+         {
+            ProductPtr<Chassis> aChassis{ aFactory->create<Chassis>() };
+            benchmark::DoNotOptimize( aChassis.get() );
+         }
+
+         anArena.release();
+      }
+   }
+}
+
+BENCHMARK( FactoryMethodCreate )->RangeMultiplier( 8 )->Range( 1, 4096 );
+BENCHMARK( FactoryMethodCreateByName )->RangeMultiplier( 8 )->Range( 1, 4096 );
+BENCHMARK( FactoryMethodEmplace )->RangeMultiplier( 8 )->Range( 1, 4096 );
+BENCHMARK( AbstractFactoryCreate );
+BENCHMARK( StaticAbstractFactoryCreate );
+BENCHMARK( AllocatingAbstractFactoryCreate );
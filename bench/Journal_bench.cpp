@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <dirent.h>
+#include <unistd.h>
+#include "cpp14/Journal.hpp"
+
+namespace
+{
+   struct Order
+   {
+      std::int64_t theProduct;
+      std::int64_t theUnits;
+   };
+
+   // Cuenta los pedidos procesados.
+   struct Count
+   {
+      void operator()( Order )
+      {
+         theDone->fetch_add( 1, std::memory_order_release );
+      }
+
+      std::atomic<std::uint64_t>* theDone;
+   };
+
+   // Un directorio temporal que se borra con su contenido.
+   struct Directory
+   {
+      Directory()
+      {
+         char aTemplate[] = "/tmp/generic-patterns-bench-XXXXXX";
+         theName = ::mkdtemp( aTemplate );
+      }
+
+      ~Directory()
+      {
+         DIR* aDirectory = ::opendir( theName.c_str() );
+         while( const dirent* anEntry = ::readdir( aDirectory ) )
+         {
+            if( anEntry->d_name[0] != '.' )
+            {
+               ::unlink( ( theName + "/" + anEntry->d_name ).c_str() );
+            }
+         }
+
+         ::closedir( aDirectory );
+         ::rmdir( theName.c_str() );
+      }
+
+      std::string theName;
+   };
+
+   // Ráfagas de pedidos almacenados en la cola persistente hasta que se procesan todos.
+   void DurableAsyncQueueStore( benchmark::State& aState )
+   {
+      Directory aDirectory;
+      std::atomic<std::uint64_t> aDone{};
+      DurableAsyncQueue<Order, Count> aQueue{ aDirectory.theName, Count{ &aDone } };
+      std::uint64_t aCount = 0;
+      for( auto _ : aState )
+      {
+         for( std::int64_t i = 0; i < aState.range( 0 ); ++i )
+         {
+            aQueue.store( Order{ i, 1 } );
+         }
+
+         aCount += static_cast<std::uint64_t>( aState.range( 0 ) );
+         while( aDone.load( std::memory_order_acquire ) < aCount )
+         {
+            std::this_thread::yield();
+         }
+      }
+
+      aState.SetItemsProcessed( static_cast<std::int64_t>( aCount ) );
+   }
+}
+
+BENCHMARK( DurableAsyncQueueStore )->Arg( 100 )->Arg( 10000 )->UseRealTime();
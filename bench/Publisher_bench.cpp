@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "cpp14/Publisher.hpp"
+
+namespace
+{
+   struct SyncModel : public SyncPublisher<SyncModel>
+   {
+      int theNumber{ 23 };
+   };
+
+   struct AsyncModel : public AsyncPublisher<AsyncModel>
+   {
+      int theNumber{ 23 };
+   };
+
+   struct SyncView : public Subscriber<SyncModel>
+   {
+      void update( const SyncModel& aSubject )
+      {
+         theSum += aSubject.theNumber;
+      }
+
+      long theSum{};
+   };
+
+   struct AsyncView : public Subscriber<AsyncModel>
+   {
+      void update( const AsyncModel& )
+      {
+         theUpdates.fetch_add( 1, std::memory_order_release );
+      }
+
+      std::atomic<std::int64_t> theUpdates{};
+   };
+
+   void SyncPublisherFanOut( benchmark::State& aState )
+   {
+      SyncModel aModel;
+      std::vector<std::shared_ptr<SyncView>> aViews;
+      for( std::int64_t i = 0; i < aState.range( 0 ); ++i )
+      {
+         aViews.push_back( std::make_shared<SyncView>() );
+         aModel.attach( aViews.back() );
+      }
+
+      for( auto _ : aState )
+      {
+         aModel.notify();
+      }
+
+      aState.SetItemsProcessed( aState.iterations() * aState.range( 0 ) );
+   }
+
+   // Cada iteración termina cuando el último suscriptor, que es el primero que se registró y por
+   // tanto el último que se notifica, ha recibido la notificación.
+   void AsyncPublisherFanOut( benchmark::State& aState )
+   {
+      AsyncModel aModel;
+      aModel.start();
+      std::vector<std::shared_ptr<AsyncView>> aViews;
+      for( std::int64_t i = 0; i < aState.range( 0 ); ++i )
+      {
+         aViews.push_back( std::make_shared<AsyncView>() );
+         aModel.attach( aViews.back() );
+      }
+
+      std::int64_t aCount = 0;
+      for( auto _ : aState )
+      {
+         aModel.notify();
+         ++aCount;
+         while( aViews.front()->theUpdates.load( std::memory_order_acquire ) < aCount )
+         {
+            std::this_thread::yield();
+         }
+      }
+
+      aState.SetItemsProcessed( aState.iterations() * aState.range( 0 ) );
+   }
+}
+
+BENCHMARK( SyncPublisherFanOut )->RangeMultiplier( 4 )->Range( 1, 256 );
+BENCHMARK( AsyncPublisherFanOut )->RangeMultiplier( 4 )->Range( 1, 256 )->UseRealTime();
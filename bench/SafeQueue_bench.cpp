@@ -0,0 +1,166 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cpp14/SafeQueue.hpp"
+#include "cpp14/SpscQueue.hpp"
+
+namespace
+{
+   // Número de enteros que atraviesan la cola en cada iteración.
+   constexpr int theItems = 100000;
+
+   // Tareas que, en cada ronda, reparten theItems enteros entre los productores y los extraen con
+   // los consumidores; cada consumidor termina la ronda al sacar un -1. Se crean antes de medir
+   // para que la medida no incluya arrancar ni esperar tareas.
+   template<typename Queue>
+   class Transfer
+   {
+   public:
+
+      Transfer( Queue& aQueue, int aProducers, int aConsumers )
+         :
+         theQueue( aQueue ),
+         theProducers{ aProducers },
+         theConsumers{ aConsumers }
+      {
+         for( int i = 0; i < aConsumers; ++i )
+         {
+            theThreads.emplace_back( [this] { consume(); } );
+         }
+
+         for( int i = 0; i < aProducers; ++i )
+         {
+            theThreads.emplace_back( [this] { produce(); } );
+         }
+      }
+
+      ~Transfer()
+      {
+         {
+            std::unique_lock<std::mutex> aLock( theMutex );
+            theStopped = true;
+         }
+
+         theStart.notify_all();
+         for( auto& aThread : theThreads )
+         {
+            aThread.join();
+         }
+      }
+
+      // Hace una ronda completa.
+      void run()
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theRunning = theProducers + theConsumers;
+         theProducing = theProducers;
+         ++theRound;
+         theStart.notify_all();
+         theFinish.wait( aLock, [this] { return theRunning == 0; } );
+      }
+
+   private:
+
+      // Espera a que empiece la ronda siguiente a <i>aRound</i>. Indica si hay que seguir.
+      bool await( std::uint64_t& aRound )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theStart.wait( aLock, [this, aRound] { return theStopped || theRound != aRound; } );
+         aRound = theRound;
+         return !theStopped;
+      }
+
+      void finish()
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         if( --theRunning == 0 )
+         {
+            theFinish.notify_one();
+         }
+      }
+
+      void consume()
+      {
+         for( std::uint64_t aRound = 0; await( aRound ); finish() )
+         {
+            int aValue = 0;
+            while( theQueue.pop( aValue ) && aValue != -1 )
+            {
+               benchmark::DoNotOptimize( aValue );
+            }
+         }
+      }
+
+      void produce()
+      {
+         for( std::uint64_t aRound = 0; await( aRound ); finish() )
+         {
+            for( int j = 0; j < theItems / theProducers; ++j )
+            {
+               theQueue.push( j );
+            }
+
+            // El último productor en terminar despide a los consumidores.
+            if( theProducing.fetch_sub( 1 ) == 1 )
+            {
+               for( int i = 0; i < theConsumers; ++i )
+               {
+                  theQueue.push( -1 );
+               }
+            }
+         }
+      }
+
+      Queue& theQueue;
+      const int theProducers;
+      const int theConsumers;
+
+      std::vector<std::thread> theThreads;
+      std::uint64_t theRound{};
+      int theRunning{};
+      std::atomic<int> theProducing{};
+      bool theStopped{};
+
+      std::mutex theMutex;
+      std::condition_variable theStart;
+      std::condition_variable theFinish;
+   };
+
+   template<typename Wait>
+   void SafeQueuePushPop( benchmark::State& aState )
+   {
+      const int aProducers = static_cast<int>( aState.range( 0 ) );
+      const int aConsumers = static_cast<int>( aState.range( 1 ) );
+      BasicSafeQueue<int, Wait> aQueue;
+      Transfer<BasicSafeQueue<int, Wait>> aTransfer( aQueue, aProducers, aConsumers );
+      for( auto _ : aState )
+      {
+         aTransfer.run();
+      }
+
+      aState.SetItemsProcessed( aState.iterations() * ( theItems / aProducers ) * aProducers );
+   }
+
+   void SpscQueuePushPop( benchmark::State& aState )
+   {
+      SpscQueue<int> aQueue( static_cast<std::size_t>( aState.range( 0 ) ) );
+      Transfer<SpscQueue<int>> aTransfer( aQueue, 1, 1 );
+      for( auto _ : aState )
+      {
+         aTransfer.run();
+      }
+
+      aState.SetItemsProcessed( aState.iterations() * theItems );
+   }
+}
+
+// La espera activa necesita un procesador por consumidor, así que se mide con uno solo.
+BENCHMARK_TEMPLATE( SafeQueuePushPop, BusySpinWait )->ArgsProduct( { { 1, 2, 4, 8 }, { 1 } } )->UseRealTime();
+BENCHMARK_TEMPLATE( SafeQueuePushPop, BlockingWait )->ArgsProduct( { { 1, 2, 4, 8 }, { 1, 2, 4 } } )->UseRealTime();
+BENCHMARK_TEMPLATE( SafeQueuePushPop, SpinParkWait )->ArgsProduct( { { 1, 2, 4, 8 }, { 1, 2, 4 } } )->UseRealTime();
+BENCHMARK_TEMPLATE( SafeQueuePushPop, SpinYieldWait )->ArgsProduct( { { 1, 2, 4, 8 }, { 1, 2, 4 } } )->UseRealTime();
+BENCHMARK( SpscQueuePushPop )->Arg( 64 )->Arg( 1024 )->Arg( 16384 )->UseRealTime();
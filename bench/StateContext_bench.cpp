@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+// El mismo código mide la máquina de estados de C++14 o la de C++17 según la norma con la que se
+// compile.
+#if __cplusplus >= 201703L
+#include "cpp17/State.hpp"
+#define STATE_BENCHMARK_NAME "StateContextDelegate/cpp17"
+#else
+#include "cpp14/StateContext.hpp"
+#define STATE_BENCHMARK_NAME "StateContextDelegate/cpp14"
+#endif
+
+namespace
+{
+   class Idle;
+
+   // Un estado que suma los enteros y pasa a Idle con cualquier carácter.
+   class Busy : public State<int, char>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, int n ) const
+      {
+         aContext.theSum += n;
+      }
+
+      template<typename C>
+      void handle( C& aContext, char c ) const;
+   };
+
+   // Un estado que resta los enteros y pasa a Busy con cualquier carácter.
+   class Idle : public State<int, char>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, int n ) const
+      {
+         aContext.theSum -= n;
+      }
+
+      template<typename C>
+      void handle( C& aContext, char ) const
+      {
+         aContext.changeState( Busy{} );
+      }
+   };
+
+   template<typename C>
+   void Busy::handle( C& aContext, char ) const
+   {
+      aContext.changeState( Idle{} );
+   }
+
+   struct Machine : public StateContext<Machine, Busy, Idle>
+   {
+      Machine()
+      {
+         changeState( Busy{} );
+      }
+
+      template<typename T>
+      void handle( T anInput )
+      {
+         delegate( anInput );
+      }
+
+      long theSum{};
+   };
+
+   // Cada iteración trata 16 enteros y un carácter que cambia de estado.
+   void StateContextDelegate( benchmark::State& aState )
+   {
+      Machine aMachine;
+      for( auto _ : aState )
+      {
+         for( int i = 0; i < 16; ++i )
+         {
+            aMachine.handle( i );
+         }
+
+         aMachine.handle( 'x' );
+      }
+
+      benchmark::DoNotOptimize( aMachine.theSum );
+      aState.SetItemsProcessed( aState.iterations() * 17 );
+   }
+}
+
+BENCHMARK( StateContextDelegate )->Name( STATE_BENCHMARK_NAME );
@@ -0,0 +1,318 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_RUN_TO_COMPLETION_HPP_
+#define INCLUDE_GENERIC_PATTERNS_RUN_TO_COMPLETION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** @cond */
+
+// Declaración adelantada de la cola de cpp14/SafeQueue.hpp, que solo necesita quien use feed.
+template<typename T, typename Wait>
+class BasicSafeQueue;
+
+/** @endcond */
+
+/**
+ * @brief Tratamiento hasta completar de las entradas de una máquina de estados.
+ *
+ * La plantilla RunToCompletion<Machine> es la parte común de los contextos de C++14 y C++17: sabe
+ * si la máquina está tratando una entrada y guarda las que se encolan mientras tanto, que se
+ * tratan en orden en cuanto termina la entrada en curso. La máquina debe tener una función
+ * dispatch( T&& ) que entregue la entrada al estado actual y declarar amiga a esta plantilla.
+ *
+ * Las entradas encoladas se construyen en bloques de memoria que se reutilizan cada vez que la
+ * cola se vacía, por lo que encolar no reserva memoria una vez que los bloques tienen el tamaño de
+ * la mayor ráfaga. Si una función handle lanza una excepción, la máquina vuelve a aceptar
+ * entradas, y las encoladas pendientes se tratan antes de la siguiente.
+ *
+ * Las copias empiezan sin entradas pendientes.
+ */
+template<typename Machine>
+class RunToCompletion
+{
+public:
+
+   RunToCompletion() = default;
+
+   RunToCompletion( const RunToCompletion& ) {}
+
+   RunToCompletion& operator=( const RunToCompletion& )
+   {
+      return *this;
+   }
+
+   ~RunToCompletion()
+   {
+      while( Record* aRecord = pop() )
+      {
+         aRecord->theDestroy( aRecord );
+      }
+   }
+
+   /**
+    * Trata la entrada <i>anInput</i> y después las que se encolen durante su tratamiento. Dentro de
+    * una función handle, la trata directamente.
+    */
+   template<typename T>
+   void delegate( Machine& aMachine, T&& anInput )
+   {
+      if( theDispatching )
+      {
+         aMachine.dispatch( std::forward<T>( anInput ) );
+         return;
+      }
+
+      Dispatching aGuard{ *this };
+      drain( aMachine );
+      aMachine.dispatch( std::forward<T>( anInput ) );
+      drain( aMachine );
+   }
+
+   /**
+    * Encola la entrada <i>anInput</i> si la máquina está tratando otra; si no, la trata.
+    */
+   template<typename T>
+   void post( Machine& aMachine, T&& anInput )
+   {
+      if( !theDispatching )
+      {
+         delegate( aMachine, std::forward<T>( anInput ) );
+         return;
+      }
+
+      using Input = std::decay_t<T>;
+      void* aBlock = allocate( sizeof( Posted<Input> ), alignof( Posted<Input> ) );
+      push( ::new( aBlock ) Posted<Input>( std::forward<T>( anInput ) ) );
+   }
+
+   /**
+    * Trata seguidas las entradas del rango [<i>aFirst</i>, <i>aLast</i>), cada una con las que se
+    * encolen durante su tratamiento.
+    */
+   template<typename Iterator>
+   void processBatch( Machine& aMachine, Iterator aFirst, Iterator aLast )
+   {
+      Dispatching aGuard{ *this };
+      drain( aMachine );
+      for( ; aFirst != aLast; ++aFirst )
+      {
+         aMachine.dispatch( *aFirst );
+         drain( aMachine );
+      }
+   }
+
+   /**
+    * Trata las entradas de la cola <i>aQueue</i>, extrayendo de una vez las que llegan en ráfaga,
+    * hasta que esta se detenga.
+    */
+   template<typename T, typename Wait>
+   void feed( Machine& aMachine, BasicSafeQueue<T, Wait>& aQueue )
+   {
+      std::queue<T> aBatch;
+      while( aQueue.popAll( aBatch ) )
+      {
+         Dispatching aGuard{ *this };
+         drain( aMachine );
+         for( ; !aBatch.empty(); aBatch.pop() )
+         {
+            aMachine.dispatch( std::move( aBatch.front() ) );
+            drain( aMachine );
+         }
+      }
+   }
+
+private:
+
+   /**
+    * Marca que la máquina está tratando entradas mientras existe y, al destruirse, recupera la
+    * marca anterior aunque el tratamiento termine con una excepción.
+    */
+   struct Dispatching
+   {
+      explicit Dispatching( RunToCompletion& anOwner )
+         :
+         theOwner( anOwner ),
+         theRestore( anOwner.theDispatching )
+      {
+         theOwner.theDispatching = true;
+      }
+
+      ~Dispatching()
+      {
+         theOwner.theDispatching = theRestore;
+      }
+
+      RunToCompletion& theOwner;
+
+      const bool theRestore;
+   };
+
+   /**
+    * Una entrada encolada. Las entradas forman una lista en el orden en que se encolan.
+    */
+   struct Record
+   {
+      Record* theNext;
+      void ( *theRun )( Machine&, Record* );
+      void ( *theDestroy )( Record* );
+   };
+
+   template<typename T>
+   struct Posted : public Record
+   {
+      template<typename U>
+      explicit Posted( U&& anInput )
+         :
+         Record{ nullptr, &run, &destroy },
+         theInput( std::forward<U>( anInput ) )
+      {
+
+      }
+
+      /**
+       * Saca la entrada del registro, que queda libre, y la trata.
+       */
+      static void run( Machine& aMachine, Record* aRecord )
+      {
+         Posted* aPosted = static_cast<Posted*>( aRecord );
+         T anInput( std::move( aPosted->theInput ) );
+         aPosted->~Posted();
+         aMachine.dispatch( std::move( anInput ) );
+      }
+
+      static void destroy( Record* aRecord )
+      {
+         static_cast<Posted*>( aRecord )->~Posted();
+      }
+
+      T theInput;
+   };
+
+   /**
+    * Trata las entradas encoladas, incluidas las que se encolan mientras tanto.
+    */
+   void drain( Machine& aMachine )
+   {
+      while( Record* aRecord = pop() )
+      {
+         aRecord->theRun( aMachine, aRecord );
+      }
+   }
+
+   void push( Record* aRecord )
+   {
+      if( theLast )
+      {
+         theLast->theNext = aRecord;
+      }
+      else
+      {
+         theFirst = aRecord;
+      }
+
+      theLast = aRecord;
+   }
+
+   /**
+    * Saca la primera entrada encolada. Si la cola se vacía, los bloques vuelven a usarse desde el
+    * principio: el registro devuelto debe liberarse antes de encolar otra entrada.
+    */
+   Record* pop()
+   {
+      Record* aRecord = theFirst;
+      if( aRecord )
+      {
+         theFirst = aRecord->theNext;
+         if( !theFirst )
+         {
+            theLast = nullptr;
+            theChunk = 0;
+            theUsed = 0;
+         }
+      }
+
+      return aRecord;
+   }
+
+   /**
+    * Reserva <i>aSize</i> bytes alineados a <i>anAlignment</i> en los bloques.
+    */
+   void* allocate( std::size_t aSize, std::size_t anAlignment )
+   {
+      for( ;; )
+      {
+         if( theChunk == theChunks.size() )
+         {
+            const std::size_t aChunkSize = aSize + anAlignment > theChunkSize ? aSize + anAlignment : theChunkSize;
+            theChunks.push_back( Chunk{ std::unique_ptr<unsigned char[]>( new unsigned char[aChunkSize] ), aChunkSize } );
+         }
+
+         Chunk& aChunk = theChunks[theChunk];
+         const std::uintptr_t anAddress = reinterpret_cast<std::uintptr_t>( aChunk.theBytes.get() ) + theUsed;
+         const std::size_t aPadding = ( anAlignment - anAddress % anAlignment ) % anAlignment;
+         if( theUsed + aPadding + aSize <= aChunk.theSize )
+         {
+            void* aBlock = aChunk.theBytes.get() + theUsed + aPadding;
+            theUsed += aPadding + aSize;
+            return aBlock;
+         }
+
+         ++theChunk;
+         theUsed = 0;
+      }
+   }
+
+   /**
+    * Tamaño mínimo de los bloques.
+    */
+   static constexpr std::size_t theChunkSize = 4096;
+
+   struct Chunk
+   {
+      std::unique_ptr<unsigned char[]> theBytes;
+      std::size_t theSize;
+   };
+
+   /**
+    * Los bloques en los que se construyen las entradas encoladas.
+    */
+   std::vector<Chunk> theChunks;
+
+   /**
+    * El bloque en uso y los bytes usados de él.
+    */
+   std::size_t theChunk{};
+   std::size_t theUsed{};
+
+   /**
+    * La primera y la última entrada encoladas.
+    */
+   Record* theFirst{};
+   Record* theLast{};
+
+   /**
+    * Indica si se está tratando una entrada.
+    */
+   bool theDispatching{};
+};
+
+#endif
@@ -0,0 +1,131 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_STATE_SNAPSHOT_HPP_
+#define INCLUDE_GENERIC_PATTERNS_STATE_SNAPSHOT_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+/**
+ * @brief Instantánea del estado de una máquina de estados.
+ *
+ * Guarda la posición del estado actual y una copia de sus bytes. Tiene un tamaño fijo, que depende
+ * solo de los estados de la máquina, por lo que las instantáneas de muchas máquinas pueden
+ * guardarse en un vector y escribirse o proyectarse en memoria de una vez. Se obtiene con la
+ * función snapshot del contexto y se recupera con la función restore.
+ *
+ * Solo pueden tomarse instantáneas de máquinas cuyos estados se copian trivialmente, es decir,
+ * cuyos bytes son todo su valor. Las instantáneas solo son válidas entre programas compilados con
+ * la misma disposición de los estados.
+ */
+template<typename... States>
+struct StateSnapshot
+{
+   /**
+    * La posición del estado actual.
+    */
+   std::uint32_t theIndex;
+
+   /**
+    * Los bytes del estado actual.
+    */
+   alignas( States... ) unsigned char thePayload[std::max( { sizeof( States )... } )];
+};
+
+/**
+ * @brief Cabecera de un fichero de instantáneas.
+ *
+ * Precede a las instantáneas escritas con writeSnapshots y permite comprobar, al leerlas, que
+ * corresponden a la misma máquina.
+ */
+struct SnapshotHeader
+{
+   /**
+    * Identificador del formato.
+    */
+   std::uint32_t theMagic;
+
+   /**
+    * Tamaño de cada instantánea.
+    */
+   std::uint32_t theRecordSize;
+
+   /**
+    * Número de estados de la máquina.
+    */
+   std::uint64_t theStateCount;
+
+   /**
+    * Número de instantáneas.
+    */
+   std::uint64_t theCount;
+
+   /**
+    * Reservado; completa la cabecera hasta 32 bytes.
+    */
+   std::uint64_t theReserved;
+
+   static constexpr std::uint32_t theFormat = 0x50414E53; // "SNAP"
+};
+
+/**
+ * Escribe en <i>anOutput</i> la cabecera y las <i>aCount</i> instantáneas que empiezan en
+ * <i>aSnapshots</i>.
+ */
+template<typename... States>
+void writeSnapshots( std::ostream& anOutput, const StateSnapshot<States...>* aSnapshots, std::size_t aCount )
+{
+   const SnapshotHeader aHeader{ SnapshotHeader::theFormat, sizeof( StateSnapshot<States...> ),
+                                 sizeof...( States ), aCount, 0 };
+   anOutput.write( reinterpret_cast<const char*>( &aHeader ), sizeof( aHeader ) );
+   anOutput.write( reinterpret_cast<const char*>( aSnapshots ),
+                   static_cast<std::streamsize>( aCount * sizeof( StateSnapshot<States...> ) ) );
+}
+
+/**
+ * Lee sin copias las instantáneas de la máquina de estados <i>States</i> escritas con
+ * writeSnapshots en los <i>aSize</i> bytes de <i>aData</i>, que normalmente será un fichero
+ * proyectado en memoria. Devuelve un puntero a la primera instantánea, dentro de <i>aData</i>, y
+ * su número en <i>aCount</i>, o nullptr si los datos no corresponden a la máquina. <i>aData</i>
+ * debe estar alineado como StateSnapshot.
+ */
+template<typename... States>
+const StateSnapshot<States...>* readSnapshots( const void* aData, std::size_t aSize, std::size_t& aCount )
+{
+   static_assert( alignof( StateSnapshot<States...> ) <= sizeof( SnapshotHeader ),
+                  "StateSnapshot: states are over-aligned for the snapshot format" );
+   SnapshotHeader aHeader;
+   if( aSize < sizeof( aHeader ) )
+   {
+      return nullptr;
+   }
+
+   std::memcpy( &aHeader, aData, sizeof( aHeader ) );
+   if( aHeader.theMagic != SnapshotHeader::theFormat ||
+       aHeader.theRecordSize != sizeof( StateSnapshot<States...> ) ||
+       aHeader.theStateCount != sizeof...( States ) ||
+       aHeader.theCount > ( aSize - sizeof( aHeader ) ) / sizeof( StateSnapshot<States...> ) )
+   {
+      return nullptr;
+   }
+
+   aCount = static_cast<std::size_t>( aHeader.theCount );
+   return reinterpret_cast<const StateSnapshot<States...>*>( static_cast<const unsigned char*>( aData ) +
+                                                             sizeof( aHeader ) );
+}
+
+#endif
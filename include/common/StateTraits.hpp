@@ -0,0 +1,121 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_STATE_TRAITS_HPP_
+#define INCLUDE_GENERIC_PATTERNS_STATE_TRAITS_HPP_
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "UnhandledInput.hpp"
+
+/** @cond */
+
+// Indica si el estado S define la función onEnter( Context& ).
+template <typename S, typename Context, typename = void>
+struct HasOnEnter : std::false_type {};
+
+template <typename S, typename Context>
+struct HasOnEnter<S, Context, decltype( std::declval<S&>().onEnter( std::declval<Context&>() ), void() )>
+   : std::true_type {};
+
+// Indica si el estado S define la función onExit( Context& ).
+template <typename S, typename Context, typename = void>
+struct HasOnExit : std::false_type {};
+
+template <typename S, typename Context>
+struct HasOnExit<S, Context, decltype( std::declval<S&>().onExit( std::declval<Context&>() ), void() )>
+   : std::true_type {};
+
+// Indica si alguno de los valores es cierto.
+template <bool... Values>
+struct AnyOf : std::integral_constant<bool, !std::is_same<std::integer_sequence<bool, Values...>,
+                                                          std::integer_sequence<bool, ( Values && false )...>>::value> {};
+
+// Indica si todos los valores son ciertos.
+template <bool... Values>
+struct AllOf : std::is_same<std::integer_sequence<bool, Values...>,
+                            std::integer_sequence<bool, ( Values || true )...>> {};
+
+// Indica si el estado S declara un estado padre.
+template <typename S, typename = void>
+struct HasParent : std::false_type {};
+
+template <typename S>
+struct HasParent<S, std::conditional_t<true, void, typename S::ParentState>> : std::true_type {};
+
+// Indica si el estado S trata por sí mismo la entrada Input.
+template <typename S, typename Input>
+struct HandlesInput
+   : std::integral_constant<bool, TupleIndex<Input, typename S::Types>::value <
+                                  std::tuple_size<typename S::Types>::value> {};
+
+// El primer estado de la cadena formada por S, su padre, el padre de este, etc., que trata la
+// entrada Input, o void si ninguno la trata.
+template <typename S, typename Input, typename = void>
+struct HandlerOf
+{
+   using Types = std::conditional_t<HandlesInput<S, Input>::value, S, void>;
+};
+
+template <typename S, typename Input>
+struct HandlerOf<S, Input, std::enable_if_t<!HandlesInput<S, Input>::value && HasParent<S>::value>>
+{
+   using Types = typename HandlerOf<typename S::ParentState, Input>::Types;
+};
+
+// Indica si el estado S, o alguno de sus antecesores, trata la entrada Input.
+template <typename S, typename Input>
+using CanHandle = std::integral_constant<bool, !std::is_void<typename HandlerOf<S, Input>::Types>::value>;
+
+// Base de las políticas que activan la traza de la máquina de estados.
+struct TracedPolicy {};
+
+/** @endcond */
+
+/**
+ * @brief Base para la creación de un subestado.
+ *
+ * La plantilla SubState crea un estado anidado en el estado <i>Parent</i>, que pasa a ser su
+ * superestado. Los parámetros siguientes son las entradas que trata el propio subestado; las demás
+ * se resuelven, en tiempo de compilación, subiendo por la cadena de superestados hasta el primero
+ * que las trate. De este modo, las entradas comunes se tratan una sola vez en el superestado:
+ *
+ * @code
+   class Powered : public State<PowerOff>
+   {
+   public:
+      void handle( Device& aDevice, const PowerOff& ) const;
+   };
+
+   class Running : public SubState<Powered, Tick>
+   {
+   public:
+      void handle( Device& aDevice, const Tick& ) const;
+   };
+   @endcode
+ *
+ * El subestado deriva de su superestado, así que hereda también sus datos miembro. Solo los
+ * subestados son estados de la máquina; los superestados no aparecen en la lista de estados del
+ * contexto.
+ */
+template<typename Parent, typename... Inputs>
+class SubState : public Parent
+{
+public:
+
+   using ParentState = Parent;
+   using Types = std::tuple<Inputs...>;
+};
+
+#endif
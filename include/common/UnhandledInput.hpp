@@ -0,0 +1,239 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_UNHANDLED_INPUT_HPP_
+#define INCLUDE_GENERIC_PATTERNS_UNHANDLED_INPUT_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+/** @cond */
+
+template<class T> struct always_false : std::false_type {};
+
+// Posición del tipo T en la tupla Tuple o tamaño de la tupla si no pertenece a ella.
+template <typename T, typename Tuple>
+struct TupleIndex;
+
+template <typename T>
+struct TupleIndex<T, std::tuple<>> : std::integral_constant<std::size_t, 0> {};
+
+template <typename T, typename... Ts>
+struct TupleIndex<T, std::tuple<T, Ts...>> : std::integral_constant<std::size_t, 0> {};
+
+template <typename T, typename U, typename... Ts>
+struct TupleIndex<T, std::tuple<U, Ts...>>
+   : std::integral_constant<std::size_t, 1 + TupleIndex<T, std::tuple<Ts...>>::value> {};
+
+// Las entradas que maneja el estado S, o ninguna si S no las declara, como los estados etiqueta de
+// TableStateContext.
+template <typename S, typename = void>
+struct InputsOfState
+{
+   using Types = std::tuple<>;
+};
+
+template <typename S>
+struct InputsOfState<S, decltype( void( std::declval<typename S::Types>() ) )>
+{
+   using Types = typename S::Types;
+};
+
+// Las entradas de todos los estados de la tupla Tuple.
+template <typename Tuple>
+struct InputsOf;
+
+template <typename... States>
+struct InputsOf<std::tuple<States...>>
+{
+   using Types = decltype( std::tuple_cat( std::declval<typename InputsOfState<States>::Types>()... ) );
+};
+
+/** @endcond */
+
+/**
+ * @brief Política que informa de las entradas no tratadas por la salida de error.
+ *
+ * Es la política predeterminada de StateContext. Escribe un mensaje en std::cerr por cada entrada
+ * que el estado actual no puede tratar, por lo que no es adecuada cuando estas son frecuentes.
+ */
+template<typename States>
+class ReportUnhandled
+{
+protected:
+
+   template<typename S, typename Input>
+   void unhandled()
+   {
+      std::cerr << "State can't handle this input type\n";
+   }
+};
+
+/**
+ * @brief Política que descarta las entradas no tratadas.
+ */
+template<typename States>
+class IgnoreUnhandled
+{
+protected:
+
+   template<typename S, typename Input>
+   void unhandled()
+   {
+
+   }
+};
+
+/**
+ * @brief Política que rechaza en tiempo de compilación las entradas no tratadas.
+ *
+ * Con esta política, delegar una entrada que algún estado de la máquina no maneja es un error de
+ * compilación.
+ */
+template<typename States>
+class RejectUnhandled
+{
+protected:
+
+   template<typename S, typename Input>
+   void unhandled()
+   {
+      static_assert( always_false<Input>::value, "State can't handle this input type" );
+   }
+};
+
+/**
+ * @brief Política que cuenta las entradas no tratadas.
+ *
+ * Lleva un contador por cada estado y cada tipo de entrada que manejan los estados de la máquina,
+ * más uno por estado para el resto de tipos. Los estados que no declaran sus entradas, como los de
+ * TableStateContext, cuentan todas en este último. Los contadores pueden leerse desde otras tareas
+ * mientras la máquina funciona.
+ */
+template<typename States>
+class CountUnhandled;
+
+template<typename... States>
+class CountUnhandled<std::tuple<States...>>
+{
+public:
+
+   /**
+    * Los tipos de entrada que manejan los estados de la máquina.
+    */
+   using Inputs = typename InputsOf<std::tuple<States...>>::Types;
+
+   /**
+    * Número de columnas de la tabla de contadores: una por cada tipo de entrada más una para los
+    * tipos que no maneja ningún estado.
+    */
+   static constexpr std::size_t theInputCount = std::tuple_size<Inputs>::value + 1;
+
+   /**
+    * Devuelve las veces que el estado <i>S</i> ha recibido una entrada de tipo <i>Input</i> que
+    * no trata.
+    */
+   template<typename S, typename Input>
+   std::uint64_t unhandledCount() const
+   {
+      return theCounters[indexOf<S, Input>()].load( std::memory_order_relaxed );
+   }
+
+   /**
+    * Devuelve de una vez todos los contadores. El contador del estado de posición <i>s</i> y la
+    * entrada de posición <i>i</i> en CountUnhandled::Inputs ocupa la posición
+    * <i>s * theInputCount + i</i>.
+    */
+   std::array<std::uint64_t, sizeof...( States ) * theInputCount> unhandledCounts() const
+   {
+      std::array<std::uint64_t, sizeof...( States ) * theInputCount> aCounts;
+      for( std::size_t i = 0; i < aCounts.size(); ++i )
+      {
+         aCounts[i] = theCounters[i].load( std::memory_order_relaxed );
+      }
+
+      return aCounts;
+   }
+
+protected:
+
+   template<typename S, typename Input>
+   void unhandled()
+   {
+      theCounters[indexOf<S, Input>()].fetch_add( 1, std::memory_order_relaxed );
+   }
+
+private:
+
+   template<typename S, typename Input>
+   static constexpr std::size_t indexOf()
+   {
+      return TupleIndex<S, std::tuple<States...>>::value * theInputCount +
+             TupleIndex<Input, Inputs>::value;
+   }
+
+   /**
+    * Los contadores de entradas no tratadas.
+    */
+   std::array<std::atomic<std::uint64_t>, sizeof...( States ) * theInputCount> theCounters{};
+};
+
+/**
+ * @brief Política que avisa a una función de las entradas no tratadas.
+ *
+ * La función recibe la posición del estado actual y el tipo de la entrada.
+ */
+template<typename States>
+class CallbackUnhandled;
+
+template<typename... States>
+class CallbackUnhandled<std::tuple<States...>>
+{
+public:
+
+   /**
+    * Establece la función <i>aCallback</i> a la que se avisa de las entradas no tratadas.
+    */
+   void onUnhandled( std::function<void( std::size_t, const std::type_info& )> aCallback )
+   {
+      theCallback = std::move( aCallback );
+   }
+
+protected:
+
+   template<typename S, typename Input>
+   void unhandled()
+   {
+      if( theCallback )
+      {
+         theCallback( TupleIndex<S, std::tuple<States...>>::value, typeid( Input ) );
+      }
+   }
+
+private:
+
+   /**
+    * La función a la que se avisa.
+    */
+   std::function<void( std::size_t, const std::type_info& )> theCallback;
+};
+
+#endif
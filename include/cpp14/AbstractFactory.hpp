@@ -16,6 +16,15 @@
 #ifndef INCLUDE_GENERIC_PATTERNS_ABSTRACT_FACTORY_HPP_
 #define INCLUDE_GENERIC_PATTERNS_ABSTRACT_FACTORY_HPP_
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "MemoryResource.hpp"
+
 namespace
 {
 
@@ -85,11 +94,91 @@ class LinearHierarchy;
 template<template <typename AtomicType, typename Base> typename Unit, typename Root, typename Head, typename... Tail>
 class LinearHierarchy<Unit, Root, TypeList<Head, Tail...>> : public Unit<Head, LinearHierarchy<Unit, Root, TypeList<Tail...>>>
 {
+  using Base = Unit<Head, LinearHierarchy<Unit, Root, TypeList<Tail...>>>;
+
+public:
 
+  using Base::Base;
 };
 
 template<template <typename AtomicType, typename Base> typename Unit, typename Root, typename T>
 class LinearHierarchy<Unit, Root, TypeList<T>> : public Unit<T, Root>
+{
+  using Base = Unit<T, Root>;
+
+public:
+
+  using Base::Base;
+};
+
+template<typename T, typename Hierarchy>
+struct UnitOf;
+
+template<typename T, template <typename AtomicType, typename Base> typename Unit, typename Root, typename Head, typename... Tail>
+struct UnitOf<T, LinearHierarchy<Unit, Root, TypeList<Head, Tail...>>>
+{
+  using Current = Unit<Head, LinearHierarchy<Unit, Root, TypeList<Tail...>>>;
+  using Types = std::conditional_t<std::is_same<typename Current::AbstractProduct, T>::value,
+                                   Current,
+                                   typename UnitOf<T, LinearHierarchy<Unit, Root, TypeList<Tail...>>>::Types>;
+};
+
+template<typename T, template <typename AtomicType, typename Base> typename Unit, typename Root, typename Head>
+struct UnitOf<T, LinearHierarchy<Unit, Root, TypeList<Head>>>
+{
+  using Current = Unit<Head, Root>;
+  using Types = std::conditional_t<std::is_same<typename Current::AbstractProduct, T>::value, Current, void>;
+};
+
+template<typename T>
+struct Signature
+{
+  using Types = T();
+};
+
+template<typename T, typename... Args>
+struct Signature<T(Args...)>
+{
+  using Types = T(Args...);
+};
+
+template<typename Signature>
+struct ProductOf;
+
+template<typename T, typename... Args>
+struct ProductOf<T(Args...)>
+{
+  using Types = T;
+};
+
+template<typename T, typename TypeList>
+struct SignatureOf;
+
+template<typename T, typename Head, typename... Tail>
+struct SignatureOf<T, TypeList<Head, Tail...>>
+{
+  using Types = std::conditional_t<std::is_same<typename ProductOf<Head>::Types, T>::value,
+                                   Head,
+                                   typename SignatureOf<T, TypeList<Tail...>>::Types>;
+};
+
+template<typename T>
+struct SignatureOf<T, TypeList<>>
+{
+  using Types = void;
+};
+
+template<typename T, typename TypeList>
+struct IndexOf;
+
+template<typename T, typename... Ts>
+struct IndexOf<T, TypeList<T, Ts...>> : std::integral_constant<std::size_t, 0>
+{
+
+};
+
+template<typename T, typename H, typename... Ts>
+struct IndexOf<T, TypeList<H, Ts...>> : std::integral_constant<std::size_t, 1 + IndexOf<T, TypeList<Ts...>>::value>
 {
 
 };
@@ -144,10 +233,338 @@ public:
 template<typename AbstractFactory, template<typename, typename> class Unit, typename... ConcreteProducts>
 struct ConcreteFactoryImpl : public LinearHierarchy<Unit, AbstractFactory, typename Reverse<TypeList<ConcreteProducts...>>::Types>
 {
-
+   using LinearHierarchy<Unit, AbstractFactory, typename Reverse<TypeList<ConcreteProducts...>>::Types>::LinearHierarchy;
 };
 
 template<typename AbstractFactory, typename... ConcreteProducts>
 using ConcreteFactory = ConcreteFactoryImpl<AbstractFactory, ConcreteFactoryUnit, ConcreteProducts...>;
 
+/**
+ * @brief Selector de la familia de productos en tiempo de ejecución.
+ *
+ * La plantilla FactorySelector permite elegir en tiempo de ejecución entre varias fábricas
+ * concretas, declaradas con ConcreteFactory, de una misma fábrica abstracta. Al seleccionar una
+ * familia, esta se resuelve una sola vez en una tabla plana con una función de creación por
+ * producto, indexada por la posición del producto en la lista de la fábrica abstracta. Crear un
+ * producto es, por tanto, una lectura de la tabla y una llamada directa, sin recorrer funciones
+ * virtuales.
+ *
+ * La familia puede cambiarse en cualquier momento, incluso mientras otras tareas crean productos:
+ * el cambio es atómico y cada creación usa por completo la familia anterior o la nueva.
+ *
+ * @code
+ * FactorySelector<CarFactory> aSelector{ Type2Type<TotoroFactory>() };
+ * std::unique_ptr<Chassis> aChassis{ aSelector.create<Chassis>() };
+ *
+ * aSelector.select<KikiFactory>();
+ * @endcode
+ */
+template<typename AbstractFactory, typename ProductList = typename AbstractFactory::ProductList>
+class FactorySelector;
+
+template<typename AbstractFactory, typename... Products>
+class FactorySelector<AbstractFactory, TypeList<Products...>>
+{
+public:
+
+   /**
+    * Crea el selector con la familia de la fábrica concreta <i>ConcreteFactory</i>.
+    */
+   template<typename ConcreteFactory>
+   FactorySelector( Type2Type<ConcreteFactory> )
+      :
+      theTable{ &tableOf( Type2Type<ConcreteFactory>() ) }
+   {
+
+   }
+
+   /**
+    * Selecciona la familia de la fábrica concreta <i>ConcreteFactory</i>.
+    */
+   template<typename ConcreteFactory>
+   void select()
+   {
+      theTable.store( &tableOf( Type2Type<ConcreteFactory>() ), std::memory_order_release );
+   }
+
+   /**
+    * Crea el producto concreto de la familia seleccionada que corresponde al producto abstracto
+    * <i>T</i>.
+    */
+   template<typename T>
+   T* create() const
+   {
+      const Table* aTable = theTable.load( std::memory_order_acquire );
+      return std::get<IndexOf<T, TypeList<Products...>>::value>( aTable->theCreators )();
+   }
+
+private:
+
+   /**
+    * Las funciones de creación de una familia, una por producto.
+    */
+   struct Table
+   {
+      std::tuple<Products* ( * )()...> theCreators;
+   };
+
+   /**
+    * Devuelve la tabla de la familia formada por los productos concretos <i>ConcreteProducts</i>.
+    */
+   template<template<typename, typename> class Unit, typename... ConcreteProducts>
+   static const Table& tableOf( Type2Type<ConcreteFactoryImpl<AbstractFactory, Unit, ConcreteProducts...>> )
+   {
+      static_assert( sizeof...( ConcreteProducts ) == sizeof...( Products ),
+                     "FactorySelector: the family doesn't make every product" );
+      static const Table theTable{ std::make_tuple( &createProduct<Products, ConcreteProducts>... ) };
+      return theTable;
+   }
+
+   /**
+    * Función plantilla para la creación de los productos concretos.
+    */
+   template<typename Product, typename ConcreteProduct>
+   static Product* createProduct()
+   {
+      return new ConcreteProduct();
+   }
+
+   /**
+    * La tabla de la familia seleccionada.
+    */
+   std::atomic<const Table*> theTable;
+};
+
+/**
+ * @brief Raíz de las fábricas concretas sin funciones virtuales.
+ *
+ * La plantilla StaticFactoryRoot es la base, mediante el patrón CRTP, de las fábricas de tipo
+ * StaticConcreteFactory. Solo toma de <i>AbstractFactory</i> la lista de productos, por lo que la
+ * fábrica concreta no hereda ninguna función virtual y StaticFactoryRoot::create se resuelve en
+ * tiempo de compilación.
+ */
+template<typename Derived, typename AbstractFactory>
+struct StaticFactoryRoot
+{
+   using ProductList = typename AbstractFactory::ProductList;
+
+   /**
+    * Crea el producto concreto que corresponde al producto abstracto <i>T</i> y devuelve un
+    * puntero de su tipo concreto.
+    */
+   template<typename T>
+   auto create()
+   {
+      using Unit = typename UnitOf<T, typename Derived::Hierarchy>::Types;
+      static_assert( !std::is_void<Unit>::value, "StaticFactoryRoot::create: unknown product" );
+      return static_cast<Derived&>( *this ).Unit::make( Type2Type<T>() );
+   }
+};
+
+template<typename AbstractFactory, template<typename, typename> class Unit, typename... ConcreteProducts>
+struct StaticConcreteFactoryImpl
+   : public LinearHierarchy<Unit, StaticFactoryRoot<StaticConcreteFactoryImpl<AbstractFactory, Unit, ConcreteProducts...>, AbstractFactory>,
+                            typename Reverse<TypeList<ConcreteProducts...>>::Types>
+{
+   using Hierarchy = LinearHierarchy<Unit, StaticFactoryRoot<StaticConcreteFactoryImpl, AbstractFactory>,
+                                     typename Reverse<TypeList<ConcreteProducts...>>::Types>;
+};
+
+/**
+ * @brief Fábrica concreta sin funciones virtuales.
+ *
+ * Se declara igual que ConcreteFactory, pero la fábrica resultante no deriva de la fábrica
+ * abstracta: la creación de los productos es una llamada directa que el compilador puede expandir
+ * en línea. Es la opción adecuada cuando la fábrica concreta se conoce en tiempo de compilación.
+ *
+ * @code
+ * using CarFactory = AbstractFactory<Chassis, BodyWork>;
+ * StaticConcreteFactory<CarFactory, TotoroChassis, TotoroBodyWork> aFactory;
+ * std::unique_ptr<TotoroChassis> aChassis{ aFactory.create<Chassis>() };
+ * @endcode
+ */
+template<typename AbstractFactory, typename... ConcreteProducts>
+using StaticConcreteFactory = StaticConcreteFactoryImpl<AbstractFactory, ConcreteFactoryUnit, ConcreteProducts...>;
+
+/**
+ * @brief Destructor de los productos creados con un recurso de memoria.
+ *
+ * Destruye el producto y devuelve su memoria al recurso del que salió. Conserva el bloque y el
+ * tamaño del producto concreto porque el puntero al producto abstracto no tiene por qué apuntar al
+ * comienzo del bloque.
+ */
+template<typename T>
+class ProductDeleter
+{
+public:
+
+   ProductDeleter() = default;
+
+   ProductDeleter( MemoryResource* aResource, void* aBlock, std::size_t aSize, std::size_t anAlignment )
+      :
+      theResource{ aResource },
+      theBlock{ aBlock },
+      theSize{ aSize },
+      theAlignment{ anAlignment }
+   {
+
+   }
+
+   void operator()( T* aProduct ) const
+   {
+      aProduct->~T();
+      theResource->deallocate( theBlock, theSize, theAlignment );
+   }
+
+private:
+
+   MemoryResource* theResource{};
+   void* theBlock{};
+   std::size_t theSize{};
+   std::size_t theAlignment{};
+};
+
+/**
+ * Puntero único a un producto creado con un recurso de memoria.
+ */
+template<typename T>
+using ProductPtr = std::unique_ptr<T, ProductDeleter<T>>;
+
+/**
+ * Construye un objeto de tipo <i>ConcreteProduct</i> con los argumentos <i>aArgs</i> en memoria
+ * del recurso <i>aResource</i> y lo devuelve como un producto de tipo <i>T</i>.
+ */
+template<typename T, typename ConcreteProduct, typename... Args>
+ProductPtr<T> makeProduct( MemoryResource* aResource, Args&&... aArgs )
+{
+   void* aBlock = aResource->allocate( sizeof( ConcreteProduct ), alignof( ConcreteProduct ) );
+   try
+   {
+      T* aProduct = ::new( aBlock ) ConcreteProduct( std::forward<Args>( aArgs )... );
+      return ProductPtr<T>{ aProduct, ProductDeleter<T>{ aResource, aBlock, sizeof( ConcreteProduct ),
+                                                         alignof( ConcreteProduct ) } };
+   }
+   catch( ... )
+   {
+      aResource->deallocate( aBlock, sizeof( ConcreteProduct ), alignof( ConcreteProduct ) );
+      throw;
+   }
+}
+
+template<typename Signature>
+struct AllocatingFactoryUnit;
+
+template<typename T, typename... Args>
+struct AllocatingFactoryUnit<T(Args...)>
+{
+   virtual ~AllocatingFactoryUnit() {}
+   virtual ProductPtr<T> make( Type2Type<T>, MemoryResource*, Args... ) = 0;
+};
+
+/**
+ * @brief Fábrica abstracta con recurso de memoria.
+ *
+ * Es la variante de AbstractFactory cuyos productos se construyen en la memoria de un recurso,
+ * indicado al construir la fábrica, y se devuelven como ProductPtr, un std::unique_ptr cuyo
+ * destructor devuelve la memoria al recurso. Un producto puede declararse con los argumentos de su
+ * constructor usando la sintaxis de los tipos función:
+ *
+ * @code
+ * using CarFactory = AllocatingAbstractFactory<Chassis, BodyWork( const std::string& )>;
+ * ProductPtr<BodyWork> aBodyWork{ aFactory.create<BodyWork>( "Rojo" ) };
+ * @endcode
+ *
+ * Si el recurso es un MonotonicBufferResource, toda una familia de productos sale de un mismo
+ * búfer que se recupera de una vez al terminar, por ejemplo, un fotograma o una petición.
+ */
+template<typename... Products>
+class AllocatingAbstractFactory : public AllocatingFactoryUnit<typename Signature<Products>::Types>...
+{
+public:
+
+   using ProductList = TypeList<typename Signature<Products>::Types...>;
+
+   AllocatingAbstractFactory( MemoryResource* aResource = newDeleteResource() )
+      :
+      theResource{ aResource }
+   {
+
+   }
+
+   /**
+    * Crea el producto concreto que corresponde al producto abstracto <i>T</i> pasándole al
+    * constructor los argumentos <i>aArgs</i>.
+    */
+   template<typename T, typename... Args>
+   ProductPtr<T> create( Args&&... aArgs )
+   {
+      using S = typename SignatureOf<T, ProductList>::Types;
+      static_assert( !std::is_void<S>::value, "AllocatingAbstractFactory::create: unknown product" );
+      AllocatingFactoryUnit<S>& aUnit = *this;
+      return aUnit.make( Type2Type<T>(), theResource, std::forward<Args>( aArgs )... );
+   }
+
+   /**
+    * Devuelve el recurso de memoria de la fábrica.
+    */
+   MemoryResource* resource() const
+   {
+      return theResource;
+   }
+
+private:
+
+   /**
+    * El recurso del que sale la memoria de los productos.
+    */
+   MemoryResource* theResource;
+};
+
+template<typename ConcreteProduct, typename Base, typename Signature>
+class AllocatingConcreteMaker;
+
+template<typename ConcreteProduct, typename Base, typename T, typename... Args>
+class AllocatingConcreteMaker<ConcreteProduct, Base, T(Args...)> : public Base
+{
+public:
+
+   using Base::Base;
+
+   ProductPtr<T> make( Type2Type<T>, MemoryResource* aResource, Args... aArgs ) override
+   {
+      return makeProduct<T, ConcreteProduct>( aResource, std::forward<Args>( aArgs )... );
+   }
+};
+
+template<typename ConcreteProduct, typename Base>
+class AllocatingConcreteFactoryUnit
+   : public AllocatingConcreteMaker<ConcreteProduct, Base, typename Head<typename Base::ProductList>::Types>
+{
+private:
+
+   using Maker = AllocatingConcreteMaker<ConcreteProduct, Base, typename Head<typename Base::ProductList>::Types>;
+
+public:
+
+   using Maker::Maker;
+
+   using ProductList = typename Tail<typename Base::ProductList>::Types;
+
+   using AbstractProduct = typename ProductOf<typename Head<typename Base::ProductList>::Types>::Types;
+};
+
+/**
+ * @brief Fábrica concreta con recurso de memoria.
+ *
+ * Se declara igual que ConcreteFactory a partir de una AllocatingAbstractFactory y se construye
+ * con el recurso de memoria de sus productos.
+ *
+ * @code
+ * MonotonicBufferResource anArena{ aBuffer, sizeof( aBuffer ) };
+ * AllocatingConcreteFactory<CarFactory, TotoroChassis, TotoroBodyWork> aFactory{ &anArena };
+ * @endcode
+ */
+template<typename AbstractFactory, typename... ConcreteProducts>
+using AllocatingConcreteFactory = ConcreteFactoryImpl<AbstractFactory, AllocatingConcreteFactoryUnit, ConcreteProducts...>;
+
 #endif
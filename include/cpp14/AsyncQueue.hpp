@@ -15,8 +15,27 @@
 #define INCLUDE_GENERIC_PATTERNS_ASYNC_QUEUE_HPP_
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "QueueMetrics.hpp"
 #include "SafeQueue.hpp"
+#include "SpscQueue.hpp"
+#include "TimingWheel.hpp"
+
+/**
+ * La función de procesamiento por defecto de AsyncQueue, que recibe los objetos mediante punteros
+ * compartidos.
+ */
+template<typename T>
+using SharedCallback = std::function<void( std::shared_ptr<T> )>;
 
 /**
  * @brief Cola que desacopla el procesamiento de objetos.
@@ -28,21 +47,69 @@
  * AsyncQueue<Object> aQueue{ []( std::shared_ptr<Object> obj ) { obj->function(); } };
  * @endcode
  *
- * Esta clase es concurrentemente segura.
+ * Con la función por defecto, los objetos se almacenan mediante punteros compartidos. Si
+ * <i>Callback</i> es otro tipo, como el de una lambda, la cola almacena directamente los objetos
+ * de tipo T, que se mueven hasta la función, y la llamada puede expandirse en línea. T debe
+ * poder construirse por defecto y moverse.
+ *
+ * @code
+ * auto aCallback = []( Point aPoint ) { draw( aPoint ); };
+ * AsyncQueue<Point, decltype( aCallback )> aQueue{ aCallback };
+ * aQueue.store( Point{ 1, 2 } );
+ * @endcode
+ *
+ * Esta clase es concurrentemente segura. El parámetro <i>Queue</i> elige la cola que almacena los
+ * objetos; si solo una tarea va a almacenarlos, SpscAsyncQueue evita los mútex de SafeQueue. La
+ * estrategia con la que la tarea espera los objetos se elige con Waiting:
+ *
+ * @code
+ * AsyncQueue<Object, SharedCallback<Object>, Waiting<SpinParkWait>::Queue> aQueue{ ... };
+ * @endcode
+ *
+ * Los objetos también pueden almacenarse para procesarlos en un instante futuro, con storeAt y
+ * storeAfter, y cancelarse antes de que llegue. Se guardan en una rueda de temporizadores con una
+ * resolución de un milisegundo que la propia tarea de la cola hace avanzar, por lo que añadirlos y
+ * cancelarlos cuesta un tiempo constante, sin tareas adicionales, aunque haya millones pendientes.
+ * Un objeto programado nunca se procesa antes de su instante, pero puede hacerlo hasta un
+ * milisegundo después, además del tiempo que tarde la tarea en despertar.
+ *
+ * Cada cola tiene sus propias QueueMetrics, que se obtienen con AsyncQueue::metrics o, para todas
+ * las colas, con QueueMetrics::collect.
  */
-template<typename T>
+template<typename T, typename Callback = SharedCallback<T>, template<typename> class Queue = SafeQueue>
 class AsyncQueue
 {
 public:
 
+   /**
+    * El tipo de los elementos de la cola.
+    */
+   using Element = std::conditional_t<std::is_same<Callback, SharedCallback<T>>::value, std::shared_ptr<T>, T>;
+
+   /**
+    * El reloj de los objetos programados.
+    */
+   using Clock = std::chrono::steady_clock;
+
    /**
     * Crea la cola poniendo en marcha la tarea encargada de sacar los objetos de la cola y
-    * procesarlos mediante la llamada a la función <i>aCallback</i>.
+    * procesarlos mediante la llamada a la función <i>aCallback</i>. Las métricas de la cola se
+    * registran con el nombre <i>aName</i>.
+    */
+   AsyncQueue( Callback aCallback, std::string aName = "AsyncQueue" )
+      :
+      AsyncQueue( std::move( aCallback ), QueueMetrics::create( std::move( aName ) ) )
+   {
+
+   }
+
+   /**
+    * Crea la cola como el constructor anterior, pero con las métricas <i>aMetrics</i>.
     */
-   AsyncQueue( std::function<void( std::shared_ptr<T> )> aCallback )
+   AsyncQueue( Callback aCallback, std::shared_ptr<QueueMetrics> aMetrics )
       :
-      theRunning{ true },
-      theCallback{ aCallback },
+      theCallback{ std::move( aCallback ) },
+      theMetrics{ std::move( aMetrics ) },
       theDispatcher{ std::thread( [this] { dispatcher(); } ) }
    {
 
@@ -51,31 +118,33 @@ public:
    /**
     * Esta clase no se puede copiar.
     */
-   AsyncQueue( const AsyncQueue<T>& ) = delete;
+   AsyncQueue( const AsyncQueue& ) = delete;
 
    /**
     * Esta clase no se puede copiar.
     */
-   AsyncQueue& operator=( const AsyncQueue<T>& ) = delete;
+   AsyncQueue& operator=( const AsyncQueue& ) = delete;
 
    /**
     * Esta clase no se puede mover.
     */
-   AsyncQueue( AsyncQueue<T>&& ) = delete;
+   AsyncQueue( AsyncQueue&& ) = delete;
 
    /**
     * Esta clase no se puede mover.
     */
-   AsyncQueue& operator=( AsyncQueue<T>&& ) = delete;
+   AsyncQueue& operator=( AsyncQueue&& ) = delete;
 
    /**
-    * Detiene la tarea que procesa los objetos. Si quedan objetos en la cola, no se procesarán.
+    * Detiene la tarea que procesa los objetos. Si quedan objetos en la cola o programados, no se
+    * procesarán.
     */
    ~AsyncQueue()
    {
       theRunning.store( false );
       theQueue.stop();
       theDispatcher.join();
+      theMetrics->onDrop( theQueue.size() + theTimers.size() );
    }
 
    /**
@@ -83,45 +152,192 @@ public:
     * procesamiento depende del número de objetos existentes en la cola, aunque en condiciones
     * normales debería ser despreciable.
     */
-   void store( std::shared_ptr<T> aObject )
+   void store( Element aObject )
    {
+      theMetrics->onStore();
       theQueue.emplace( std::move( aObject ) );
    }
 
+   /**
+    * Almacena un objeto para procesarlo en el instante <i>aTime</i>. Devuelve el identificador con
+    * el que puede cancelarse.
+    */
+   TimerHandle storeAt( Clock::time_point aTime, Element aObject )
+   {
+      std::unique_lock<std::mutex> aLock( theTimerMutex );
+      const std::uint64_t aTick = toTick( aTime );
+      const TimerHandle aHandle = theTimers.insert( aTick, std::move( aObject ) );
+      theMetrics->onSchedule();
+      theTimerCount.store( theTimers.size(), std::memory_order_relaxed );
+      const bool isSooner = aTick < theWakeTick;
+      aLock.unlock();
+
+      // La tarea duerme hasta un instante posterior, o sin límite, y debe recalcularlo.
+      if( isSooner )
+      {
+         theQueue.interrupt();
+      }
+
+      return aHandle;
+   }
+
+   /**
+    * Almacena un objeto para procesarlo cuando transcurra el tiempo <i>aDelay</i>. Devuelve el
+    * identificador con el que puede cancelarse.
+    */
+   TimerHandle storeAfter( Clock::duration aDelay, Element aObject )
+   {
+      return storeAt( Clock::now() + aDelay, std::move( aObject ) );
+   }
+
+   /**
+    * Cancela el procesamiento del objeto programado <i>aHandle</i>. Devuelve falso si ya se ha
+    * procesado o cancelado.
+    */
+   bool cancel( TimerHandle aHandle )
+   {
+      std::unique_lock<std::mutex> aLock( theTimerMutex );
+      const bool isCancelled = theTimers.cancel( aHandle );
+      if( isCancelled )
+      {
+         theMetrics->onDrop();
+      }
+
+      theTimerCount.store( theTimers.size(), std::memory_order_relaxed );
+      if( theTimers.empty() )
+      {
+         theWakeTick = theNever;
+      }
+
+      return isCancelled;
+   }
+
+   /**
+    * Devuelve las métricas de la cola.
+    */
+   const QueueMetrics& metrics() const
+   {
+      return *theMetrics;
+   }
+
 private:
 
    /**
-    * Tarea encargada de procesar los objetos almacenados en la cola.
+    * Tarea encargada de procesar los objetos almacenados en la cola y los programados que vencen.
+    * Mientras no hay objetos programados, espera a la cola sin límite; en caso contrario, como
+    * mucho hasta el siguiente paso ocupado de la rueda.
     */
    void dispatcher()
    {
+      Element aObject{};
       while( theRunning.load() )
       {
-         std::shared_ptr<T> aObject{ theQueue.front() };
-         if( theRunning.load() )
+         const std::uint64_t aWakeTick = theTimerCount.load( std::memory_order_relaxed ) != 0 ? expire() : theNever;
+         const bool isReceived = aWakeTick == theNever ? theQueue.pop( aObject )
+                                                       : theQueue.pop( aObject, theOrigin + aWakeTick * theTick );
+         if( isReceived )
          {
-            theQueue.pop();
-            theCallback( aObject );
+            theMetrics->onTake();
+            theCallback( std::move( aObject ) );
          }
       }
    }
 
+   /**
+    * Procesa los objetos programados que han vencido y devuelve el paso hasta el que la tarea
+    * puede dormir. Solo avanza la rueda hasta el paso en curso, que ya ha empezado: los objetos
+    * de un paso se guardan en el primero que empieza en su instante o después.
+    */
+   std::uint64_t expire()
+   {
+      std::unique_lock<std::mutex> aLock( theTimerMutex );
+      theTimers.advance( static_cast<std::uint64_t>( ( Clock::now() - theOrigin ) / theTick ), [this]( Element&& anObject ) {
+                            theExpired.push_back( std::move( anObject ) );
+                         } );
+      theTimerCount.store( theTimers.size(), std::memory_order_relaxed );
+      theWakeTick = theTimers.empty() ? theNever : theTimers.next();
+      const std::uint64_t aWakeTick = theWakeTick;
+      aLock.unlock();
+
+      theMetrics->onExpire( theExpired.size() );
+      for( auto& anExpired : theExpired )
+      {
+         theCallback( std::move( anExpired ) );
+      }
+
+      theExpired.clear();
+      return aWakeTick;
+   }
+
+   /**
+    * Devuelve el primer paso de la rueda que empieza en el instante <i>aTime</i> o después.
+    */
+   std::uint64_t toTick( Clock::time_point aTime ) const
+   {
+      return aTime <= theOrigin ? 0 : static_cast<std::uint64_t>( ( aTime - theOrigin + theTick - Clock::duration{ 1 } ) / theTick );
+   }
+
+   /**
+    * La resolución de la rueda de temporizadores.
+    */
+   static constexpr Clock::duration theTick = std::chrono::milliseconds{ 1 };
+
+   /**
+    * El paso de espera de la tarea cuando no hay objetos programados.
+    */
+   static constexpr std::uint64_t theNever = UINT64_MAX;
+
 private:
 
    /**
     * Indica si la cola está en marcha.
     */
-   std::atomic<bool> theRunning;
+   std::atomic<bool> theRunning{ true };
 
    /**
     * La cola que almacena los objetos.
     */
-   SafeQueue<std::shared_ptr<T>> theQueue;
+   Queue<Element> theQueue;
 
    /**
     * La función que se invoca al despachar los objetos.
     */
-   std::function<void( std::shared_ptr<T> )> theCallback;
+   Callback theCallback;
+
+   /**
+    * Las métricas de la cola.
+    */
+   std::shared_ptr<QueueMetrics> theMetrics;
+
+   /**
+    * El instante del paso 0 de la rueda.
+    */
+   const Clock::time_point theOrigin{ Clock::now() };
+
+   /**
+    * El mútex que protege la rueda y el paso de espera de la tarea.
+    */
+   std::mutex theTimerMutex;
+
+   /**
+    * La rueda con los objetos programados.
+    */
+   TimingWheel<Element> theTimers;
+
+   /**
+    * El número de objetos programados, que la tarea consulta sin cerrojo.
+    */
+   std::atomic<std::size_t> theTimerCount{};
+
+   /**
+    * El paso hasta el que duerme la tarea.
+    */
+   std::uint64_t theWakeTick{ theNever };
+
+   /**
+    * Los objetos programados vencidos, que la tarea procesa tras soltar el cerrojo.
+    */
+   std::vector<Element> theExpired;
 
    /**
     * La tarea que extrae los objetos de la cola y los procesa.
@@ -129,4 +345,16 @@ private:
    std::thread theDispatcher;
 };
 
+template<typename T, typename Callback, template<typename> class Queue>
+constexpr std::chrono::steady_clock::duration AsyncQueue<T, Callback, Queue>::theTick;
+
+template<typename T, typename Callback, template<typename> class Queue>
+constexpr std::uint64_t AsyncQueue<T, Callback, Queue>::theNever;
+
+/**
+ * Cola asíncrona para un único productor: solo una tarea puede invocar a la función store.
+ */
+template<typename T, typename Callback = SharedCallback<T>>
+using SpscAsyncQueue = AsyncQueue<T, Callback, SpscQueue>;
+
 #endif
@@ -16,6 +16,23 @@
 
 #include "AsyncQueue.hpp"
 #include "Deliverable.hpp"
+#include "Request.hpp"
+
+/** @cond */
+// Función de la cola del mensajero: entrega los objetos al destinatario. A diferencia de una
+// lambda, puede nombrarse como tipo de la cola y guarda el destinatario en lugar de una
+// referencia al argumento del constructor.
+template<typename T>
+struct DeliverTo
+{
+   void operator()( std::shared_ptr<Deliverable<T>> aDeliverable )
+   {
+      aDeliverable->deliver( theDestination );
+   }
+
+   T theDestination;
+};
+/** @endcond */
 
 /**
  * @brief El patrón Mensajero
@@ -26,30 +43,92 @@
  *
  * Véase la documentación del patrón Mensajero para más información.
  *
+ * Las peticiones derivadas de Request se envían con Courier::deliverWithReply, que devuelve la
+ * respuesta futura del destinatario.
+ *
+ * Los envíos pueden programarse para un instante futuro con Courier::deliverAt y
+ * Courier::deliverAfter, y cancelarse con Courier::cancel.
+ *
+ * El parámetro <i>Queue</i> elige la cola de la clase AsyncQueue. Si solo una tarea va a enviar
+ * objetos, SpscCourier usa una cola sin mútex para un único productor.
+ *
  * @see Deliverable
  */
-template<typename T>
+template<typename T, template<typename> class Queue = SafeQueue>
 class Courier
 {
 public:
 
-   Courier( T aDestination )
+   /**
+    * Crea el mensajero del destinatario <i>aDestination</i>. Las métricas de su cola se registran
+    * con el nombre <i>aName</i>.
+    */
+   Courier( T aDestination, std::string aName = "Courier" )
       :
-      theQueue( [&aDestination]( std::shared_ptr<Deliverable<T>> aDeriverable ) {
-                    aDeriverable->deliver( aDestination );
-                } )
+      theQueue( DeliverTo<T>{ std::forward<T>( aDestination ) }, std::move( aName ) )
    {
 
    }
 
    void deliver( std::shared_ptr<Deliverable<T>> aDeliverable )
    {
-      theQueue.store( aDeliverable );
+      theQueue.store( std::move( aDeliverable ) );
+   }
+
+   /**
+    * Envía la petición <i>aRequest</i> y devuelve la respuesta futura del destinatario.
+    */
+   template<typename R>
+   ReplyFuture<R> deliverWithReply( std::shared_ptr<Request<T, R>> aRequest )
+   {
+      ReplyFuture<R> aFuture( aRequest );
+      theQueue.store( std::move( aRequest ) );
+      return aFuture;
+   }
+
+   /**
+    * Envía el objeto <i>aDeliverable</i> en el instante <i>aTime</i>. Devuelve el identificador con
+    * el que puede cancelarse el envío.
+    */
+   TimerHandle deliverAt( std::chrono::steady_clock::time_point aTime, std::shared_ptr<Deliverable<T>> aDeliverable )
+   {
+      return theQueue.storeAt( aTime, std::move( aDeliverable ) );
+   }
+
+   /**
+    * Envía el objeto <i>aDeliverable</i> cuando transcurra el tiempo <i>aDelay</i>. Devuelve el
+    * identificador con el que puede cancelarse el envío.
+    */
+   TimerHandle deliverAfter( std::chrono::steady_clock::duration aDelay, std::shared_ptr<Deliverable<T>> aDeliverable )
+   {
+      return theQueue.storeAfter( aDelay, std::move( aDeliverable ) );
+   }
+
+   /**
+    * Cancela el envío programado <i>aHandle</i>. Devuelve falso si ya se ha enviado o cancelado.
+    */
+   bool cancel( TimerHandle aHandle )
+   {
+      return theQueue.cancel( aHandle );
+   }
+
+   /**
+    * Devuelve las métricas de la cola del mensajero.
+    */
+   const QueueMetrics& metrics() const
+   {
+      return theQueue.metrics();
    }
 
 private:
 
-   AsyncQueue<Deliverable<T>> theQueue;
+   AsyncQueue<std::shared_ptr<Deliverable<T>>, DeliverTo<T>, Queue> theQueue;
 };
 
+/**
+ * Mensajero para un único remitente: solo una tarea puede invocar a la función deliver.
+ */
+template<typename T>
+using SpscCourier = Courier<T, SpscQueue>;
+
 #endif
@@ -14,12 +14,113 @@
 #ifndef INCLUDE_GENERIC_PATTERNS_FACTORY_METHOD_HPP_
 #define INCLUDE_GENERIC_PATTERNS_FACTORY_METHOD_HPP_
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
+#include <new>
 #include <string>
 #include <memory>
-#include <functional>
+#include <type_traits>
 #include <utility>
 
+/**
+ * @brief Almacenamiento para construir un producto sin reservar memoria dinámica.
+ *
+ * La plantilla ProductSlot es un hueco de <i>Size</i> bytes, alineado a <i>Alignment</i>, en el que
+ * FactoryMethod::emplace construye un producto concreto. Se comporta como un std::optional de un
+ * objeto polimórfico: el producto se destruye al vaciar el hueco, al construir otro en su lugar o
+ * al destruir el propio hueco.
+ *
+ * @code
+ * ProductSlot<Product, 64> aSlot;
+ * Product* aProduct = aFactory.emplace( aSlot, "PTO1" );
+ * @endcode
+ *
+ * El producto se destruye a través de un puntero a la base, por lo que esta debe tener un
+ * destructor virtual.
+ */
+template<class Base, std::size_t Size, std::size_t Alignment = alignof( std::max_align_t )>
+class ProductSlot
+{
+public:
+
+   ProductSlot() = default;
+
+   /**
+    * Esta clase no se puede copiar.
+    */
+   ProductSlot( const ProductSlot& ) = delete;
+
+   /**
+    * Esta clase no se puede copiar.
+    */
+   ProductSlot& operator=( const ProductSlot& ) = delete;
+
+   /**
+    * Destruye el producto contenido, si lo hay.
+    */
+   ~ProductSlot()
+   {
+      reset();
+   }
+
+   /**
+    * Destruye el producto contenido, si lo hay, y deja el hueco vacío.
+    */
+   void reset()
+   {
+      if( theProduct != nullptr )
+      {
+         theProduct->~Base();
+         theProduct = nullptr;
+      }
+   }
+
+   /**
+    * Devuelve el producto contenido o nulo si el hueco está vacío.
+    */
+   Base* get() const
+   {
+      return theProduct;
+   }
+
+   Base* operator->() const
+   {
+      return theProduct;
+   }
+
+   Base& operator*() const
+   {
+      return *theProduct;
+   }
+
+   /**
+    * Indica si el hueco contiene un producto.
+    */
+   explicit operator bool() const
+   {
+      return theProduct != nullptr;
+   }
+
+private:
+
+   template<typename, class, typename...>
+   friend class FactoryMethod;
+
+   template<typename, class>
+   friend class PrototypeFactory;
+
+   /**
+    * La memoria en la que se construye el producto.
+    */
+   alignas( Alignment ) unsigned char theStorage[Size];
+
+   /**
+    * El producto construido en la memoria del hueco.
+    */
+   Base* theProduct{};
+};
+
 /**
  * @brief El método de fabricación o constructor virtual.
  *
@@ -41,7 +142,11 @@
  *    - Base, la clase base de la jerarquía de los objetos a crear.
  *
  * Si el constructor de los objetos requiere de argumentos, habrá que especificar sus tipos como
- * el tercer argumento y siguientes de la plantilla.
+ * el tercer argumento y siguientes de la plantilla. Los argumentos se reenvían hasta el
+ * constructor del objeto sin copias intermedias: un argumento declarado por valor (por ejemplo,
+ * std::string) se mueve si se pasa como r-valor y se copia una única vez si se pasa como l-valor;
+ * uno declarado como referencia constante (const std::string&) nunca se copia antes de llegar al
+ * constructor.
  *
  * Un ejemplo típico de uso es la creación de un objeto a partir de un identificador:
  *
@@ -65,9 +170,20 @@ class FactoryMethod
 public:
 
    /**
-    * Alias para un mapa que vincula una clave con una función que devuelve un puntero a una base.
+    * Las funciones que crean un producto concreto y los requisitos de memoria de este.
+    */
+   struct Creator
+   {
+      std::shared_ptr<Base> ( *create )( Args&&... );
+      Base* ( *construct )( void*, Args&&... );
+      std::size_t size;
+      std::size_t alignment;
+   };
+
+   /**
+    * Alias para un mapa que vincula una clave con las funciones que crean un producto concreto.
     */
-   using Table = std::map<Key, std::function<std::shared_ptr<Base>( Args&&... )>>;
+   using Table = std::map<Key, Creator>;
 
    /**
     * Registra el tipo <i>Derived</i> para su creación a partir del identificador <i>aKey</i>.
@@ -77,16 +193,56 @@ public:
    {
       static_assert( std::is_base_of<Base, Derived>::value,
                      "FactoryMethod::registerType: type doesn't derive from base class" );
-      theProducts[aKey] = &createProduct<Derived>;
+      theProducts[aKey] = Creator{ &createProduct<Derived>, &constructProduct<Derived>,
+                                   sizeof( Derived ), alignof( Derived ) };
+   }
+
+   /**
+    * Crea el objeto vinculado al identificador <i>aKey</i> y devuelve un puntero a su base. Los
+    * argumentos <i>aArgs</i> se reenvían al constructor del objeto.
+    */
+   template<typename... Ts>
+   std::shared_ptr<Base> create( const Key& aKey, Ts&&... aArgs )
+   {
+      static_assert( sizeof...( Ts ) == sizeof...( Args ),
+                     "FactoryMethod::create: wrong number of arguments" );
+      typename Table::const_iterator it = theProducts.find( aKey );
+      return it != theProducts.end() ?
+             it->second.create( pass<Args>( std::forward<Ts>( aArgs ) )... ) : nullptr;
    }
 
    /**
-    * Crea el objeto vinculado al identificador <i>aKey</i> y devuelve un puntero a su base.
+    * Construye el objeto vinculado al identificador <i>aKey</i> en la memoria <i>aStorage</i> de
+    * <i>aSize</i> bytes, sin reservar memoria dinámica, y devuelve un puntero a su base. Devuelve
+    * nulo si el identificador no está registrado o si el objeto no cabe en la memoria o no respeta
+    * su alineación. El llamante es responsable de destruir el objeto.
     */
-   std::shared_ptr<Base> create( const Key& aKey, Args... aArgs )
+   template<typename... Ts>
+   Base* emplace( const Key& aKey, void* aStorage, std::size_t aSize, Ts&&... aArgs )
    {
+      static_assert( sizeof...( Ts ) == sizeof...( Args ),
+                     "FactoryMethod::emplace: wrong number of arguments" );
       typename Table::const_iterator it = theProducts.find( aKey );
-      return it != theProducts.end() ? it->second( std::forward<Args>( aArgs )... ) : nullptr;
+      if( it == theProducts.end() || it->second.size > aSize ||
+          reinterpret_cast<std::uintptr_t>( aStorage ) % it->second.alignment != 0 )
+      {
+         return nullptr;
+      }
+
+      return it->second.construct( aStorage, pass<Args>( std::forward<Ts>( aArgs ) )... );
+   }
+
+   /**
+    * Construye el objeto vinculado al identificador <i>aKey</i> en el hueco <i>aSlot</i>,
+    * destruyendo el objeto que este contuviera, y devuelve un puntero a su base. Devuelve nulo, y
+    * deja el hueco vacío, si no es posible construirlo.
+    */
+   template<std::size_t Size, std::size_t Alignment, typename... Ts>
+   Base* emplace( ProductSlot<Base, Size, Alignment>& aSlot, const Key& aKey, Ts&&... aArgs )
+   {
+      aSlot.reset();
+      aSlot.theProduct = emplace( aKey, aSlot.theStorage, Size, std::forward<Ts>( aArgs )... );
+      return aSlot.theProduct;
    }
 
    /**
@@ -99,6 +255,20 @@ public:
 
 private:
 
+   /**
+    * Adapta el argumento <i>anArg</i> al parámetro de tipo <i>A&&</i> de las funciones de
+    * creación. Si el parámetro puede referirse al propio argumento, como una referencia a su base,
+    * se pasa la propia referencia; en caso contrario, se construye un temporal convertido que vive
+    * hasta el final de la creación.
+    */
+   template<typename A, typename T>
+   static std::conditional_t<std::is_convertible<std::remove_reference_t<T>*, std::remove_reference_t<A>*>::value &&
+                             std::is_convertible<T&&, A&&>::value, T&&, std::decay_t<A>>
+   pass( T&& anArg )
+   {
+      return std::forward<T>( anArg );
+   }
+
    /**
     * Función plantilla para la creación explícita de los distintos tipos de objetos que puede crear
     * la factoría.
@@ -111,7 +281,17 @@ private:
    }
 
    /**
-    * La tabla que vincula los identificadores con la función que crea los objetos.
+    * Función plantilla para la construcción de los distintos tipos de objetos que puede crear la
+    * factoría en una memoria proporcionada por el llamante.
+    */
+   template<class Derived>
+   static Base* constructProduct( void* aStorage, Args&&... aArgs )
+   {
+      return ::new( aStorage ) Derived( std::forward<Args>( aArgs )... );
+   }
+
+   /**
+    * La tabla que vincula los identificadores con las funciones que crean los objetos.
     */
    Table theProducts;
 };
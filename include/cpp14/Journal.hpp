@@ -0,0 +1,716 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2020 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_JOURNAL_HPP_
+#define INCLUDE_GENERIC_PATTERNS_JOURNAL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AsyncQueue.hpp"
+
+/**
+ * @brief Registro persistente de objetos.
+ *
+ * La clase Journal añade objetos de tipo T, que deben copiarse trivialmente, al final de un
+ * registro guardado en un directorio y les asigna números de secuencia consecutivos a partir de 1.
+ * El registro se divide en segmentos de tamaño fijo proyectados en memoria, por lo que añadir un
+ * objeto solo copia sus bytes, sin llamadas al sistema salvo al empezar un segmento.
+ *
+ * Los objetos añadidos sobreviven a la terminación del proceso en cuanto se copian, porque las
+ * páginas proyectadas pertenecen al fichero. Para que sobrevivan a una caída del sistema, una
+ * tarea propia vuelca al disco todos los objetos pendientes cada intervalo de confirmación, de
+ * modo que una única sincronización confirma muchos objetos; Journal::sync la fuerza.
+ *
+ * Quien procesa los objetos confirma su procesamiento, en orden, con Journal::acknowledge, y los
+ * segmentos cuyos objetos están todos confirmados y volcados se borran. Al abrir un registro
+ * existente, Journal::replay entrega los objetos sin confirmar; cada objeto se comprueba con una
+ * suma de verificación, y el registro termina en el primero incompleto. Como la confirmación
+ * también se vuelca periódicamente, tras una caída del sistema algún objeto puede entregarse dos
+ * veces, pero ninguno se pierde si estaba volcado.
+ *
+ * Esta clase es concurrentemente segura. Si no puede abrir el directorio, si sus segmentos son
+ * de otro tipo de objeto o si en un segmento no cabe ni un objeto, Journal::isOpen devuelve falso
+ * y el resto de funciones no hacen nada.
+ */
+template<typename T>
+class Journal
+{
+public:
+
+   static_assert( std::is_trivially_copyable<T>::value, "Journal: T must be trivially copyable" );
+
+   /**
+    * Abre o crea el registro del directorio <i>aDirectory</i> con segmentos de <i>aSegmentSize</i>
+    * bytes, que deben dar cabida a la cabecera y al menos un objeto, y que vuelca al disco cada
+    * <i>aCommitInterval</i>.
+    */
+   explicit Journal( std::string aDirectory, std::size_t aSegmentSize = std::size_t{ 64 } << 20,
+                     std::chrono::microseconds aCommitInterval = std::chrono::milliseconds{ 1 } )
+      :
+      theDirectory{ std::move( aDirectory ) },
+      theSegmentSize{ aSegmentSize },
+      theCapacity{ aSegmentSize >= theHeaderSize + sizeof( Record ) ? ( aSegmentSize - theHeaderSize ) / sizeof( Record ) : 0 },
+      theCommitInterval{ aCommitInterval }
+   {
+      if( theCapacity != 0 && open() )
+      {
+         theCommitter = std::thread( [this] { committer(); } );
+      }
+   }
+
+   Journal( const Journal& ) = delete;
+
+   Journal& operator=( const Journal& ) = delete;
+
+   /**
+    * Vuelca al disco los objetos pendientes y cierra el registro.
+    */
+   ~Journal()
+   {
+      if( theCommitter.joinable() )
+      {
+         {
+            std::unique_lock<std::mutex> aLock( theCommitMutex );
+            theStopped = true;
+         }
+
+         theCommitCondition.notify_one();
+         theCommitter.join();
+         sync();
+      }
+
+      for( auto& aSegment : theSegments )
+      {
+         ::munmap( aSegment.theData, theSegmentSize );
+      }
+
+      if( theCheckpoint )
+      {
+         ::munmap( theCheckpoint, sizeof( std::uint64_t ) );
+      }
+   }
+
+   /**
+    * Indica si el registro está abierto.
+    */
+   bool isOpen() const
+   {
+      return theCheckpoint != nullptr;
+   }
+
+   /**
+    * Entrega a <i>aHandler</i>, en orden, el número de secuencia y el contenido de cada objeto sin
+    * confirmar. Debe invocarse antes de añadir objetos.
+    */
+   template<typename Handler>
+   void replay( Handler&& aHandler )
+   {
+      if( !isOpen() )
+      {
+         return;
+      }
+
+      std::unique_lock<std::mutex> aLock( theMutex );
+      for( const auto& aSegment : theSegments )
+      {
+         for( std::uint64_t aSequence = std::max( aSegment.theFirst, theCheckpoint->load() + 1 );
+              aSequence < theNext && aSequence < aSegment.theFirst + theCapacity; ++aSequence )
+         {
+            aHandler( aSequence, record( aSegment, aSequence )->theObject );
+         }
+      }
+   }
+
+   /**
+    * Añade <i>anObject</i> al registro y devuelve su número de secuencia, o 0 si no puede
+    * añadirlo.
+    */
+   std::uint64_t append( const T& anObject )
+   {
+      if( !isOpen() )
+      {
+         return 0;
+      }
+
+      std::unique_lock<std::mutex> aLock( theMutex );
+      if( ( theSegments.empty() || theNext - theSegments.back().theFirst == theCapacity ) && !roll() )
+      {
+         return 0;
+      }
+
+      Record* aRecord = record( theSegments.back(), theNext );
+      std::memcpy( &aRecord->theObject, &anObject, sizeof( T ) );
+      aRecord->theChecksum = checksum( theNext, anObject );
+      aRecord->theSequence = theNext;
+      theAppended.store( theNext, std::memory_order_release );
+      return theNext++;
+   }
+
+   /**
+    * Confirma el procesamiento de todos los objetos hasta el número de secuencia
+    * <i>aSequence</i>, inclusive.
+    */
+   void acknowledge( std::uint64_t aSequence )
+   {
+      if( !isOpen() )
+      {
+         return;
+      }
+
+      theCheckpoint->store( aSequence, std::memory_order_relaxed );
+      const std::uint64_t aRetirement = theRetirement.load( std::memory_order_relaxed );
+      if( aSequence >= aRetirement && theSynced.load( std::memory_order_acquire ) >= aRetirement )
+      {
+         retire();
+      }
+   }
+
+   /**
+    * Vuelca al disco todos los objetos añadidos y la última confirmación. No hace llamadas al
+    * sistema si nada ha cambiado desde el volcado anterior.
+    */
+   void sync()
+   {
+      if( !isOpen() )
+      {
+         return;
+      }
+
+      std::unique_lock<std::mutex> aSyncLock( theSyncMutex );
+      const std::uint64_t aTarget = theAppended.load( std::memory_order_acquire );
+      const std::uint64_t aSynced = theSynced.load( std::memory_order_relaxed );
+      const std::uint64_t aCheckpoint = theCheckpoint->load( std::memory_order_relaxed );
+      if( aTarget == aSynced && aCheckpoint == theSyncedCheckpoint )
+      {
+         return;
+      }
+
+      if( aTarget > aSynced )
+      {
+         theRanges.clear();
+         {
+            std::unique_lock<std::mutex> aLock( theMutex );
+            for( const auto& aSegment : theSegments )
+            {
+               const std::uint64_t aFirst = std::max( aSegment.theFirst, aSynced + 1 );
+               const std::uint64_t aLast = std::min( aSegment.theFirst + theCapacity - 1, aTarget );
+               if( aFirst <= aLast )
+               {
+                  const auto aBegin = reinterpret_cast<std::uintptr_t>( record( aSegment, aFirst ) ) & ~( thePageSize - 1 );
+                  const auto anEnd = reinterpret_cast<std::uintptr_t>( record( aSegment, aLast ) + 1 );
+                  theRanges.emplace_back( reinterpret_cast<void*>( aBegin ), anEnd - aBegin );
+               }
+            }
+         }
+
+         // Los segmentos con objetos sin volcar no se borran, así que los rangos siguen
+         // proyectados mientras se sincronizan sin el cerrojo.
+         for( const auto& aRange : theRanges )
+         {
+            ::msync( aRange.first, aRange.second, MS_SYNC );
+         }
+      }
+
+      if( aCheckpoint != theSyncedCheckpoint )
+      {
+         ::msync( theCheckpoint, sizeof( std::uint64_t ), MS_SYNC );
+         theSyncedCheckpoint = aCheckpoint;
+      }
+
+      theSynced.store( aTarget, std::memory_order_release );
+      if( theCheckpoint->load( std::memory_order_relaxed ) >= theRetirement.load( std::memory_order_relaxed ) )
+      {
+         retire();
+      }
+   }
+
+   /**
+    * Devuelve el número de secuencia del último objeto volcado al disco.
+    */
+   std::uint64_t durable() const
+   {
+      return theSynced.load( std::memory_order_acquire );
+   }
+
+private:
+
+   static constexpr std::uint64_t theMagic = 0x4C414E52554F4A47; // "GJOURNAL"
+
+   /**
+    * El tamaño de la cabecera de cada segmento.
+    */
+   static constexpr std::size_t theHeaderSize = 64;
+
+   /**
+    * Un objeto del registro. El número de secuencia se escribe el último, de modo que un registro
+    * incompleto no coincide con su posición.
+    */
+   struct Record
+   {
+      std::uint64_t theSequence;
+      std::uint64_t theChecksum;
+      T theObject;
+   };
+
+   /**
+    * La cabecera de un segmento.
+    */
+   struct Header
+   {
+      std::uint64_t theMagic;
+      std::uint64_t theRecordSize;
+      std::uint64_t theFirst;
+   };
+
+   /**
+    * Un segmento proyectado.
+    */
+   struct Segment
+   {
+      std::uint64_t theFirst;
+      unsigned char* theData;
+   };
+
+   /**
+    * Devuelve el objeto con número de secuencia <i>aSequence</i> del segmento <i>aSegment</i>.
+    */
+   Record* record( const Segment& aSegment, std::uint64_t aSequence ) const
+   {
+      return reinterpret_cast<Record*>( aSegment.theData + theHeaderSize ) + ( aSequence - aSegment.theFirst );
+   }
+
+   /**
+    * Devuelve la suma de verificación FNV-1a del objeto <i>anObject</i> con número de secuencia
+    * <i>aSequence</i>.
+    */
+   static std::uint64_t checksum( std::uint64_t aSequence, const T& anObject )
+   {
+      std::uint64_t aHash = 0xCBF29CE484222325 ^ aSequence;
+      const auto* aByte = reinterpret_cast<const unsigned char*>( &anObject );
+      for( std::size_t i = 0; i < sizeof( T ); ++i )
+      {
+         aHash = ( aHash ^ aByte[i] ) * 0x100000001B3;
+      }
+
+      return aHash;
+   }
+
+   /**
+    * Devuelve la ruta del segmento que empieza en el número de secuencia <i>aFirst</i>.
+    */
+   std::string path( std::uint64_t aFirst ) const
+   {
+      char aName[32];
+      std::snprintf( aName, sizeof( aName ), "/%016llx.log", static_cast<unsigned long long>( aFirst ) );
+      return theDirectory + aName;
+   }
+
+   /**
+    * Proyecta el fichero <i>aPath</i> de <i>aSize</i> bytes, creándolo si no existe. Devuelve
+    * nullptr si falla o si el fichero existe con otro tamaño.
+    */
+   static unsigned char* map( const std::string& aPath, std::size_t aSize )
+   {
+      const int aDescriptor = ::open( aPath.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600 );
+      if( aDescriptor < 0 )
+      {
+         return nullptr;
+      }
+
+      void* aData = MAP_FAILED;
+      struct stat aStatus;
+      if( ::fstat( aDescriptor, &aStatus ) == 0 &&
+          ( static_cast<std::size_t>( aStatus.st_size ) == aSize ||
+            ( aStatus.st_size == 0 && ::ftruncate( aDescriptor, static_cast<off_t>( aSize ) ) == 0 ) ) )
+      {
+         aData = ::mmap( nullptr, aSize, PROT_READ | PROT_WRITE, MAP_SHARED, aDescriptor, 0 );
+      }
+
+      ::close( aDescriptor );
+      return aData == MAP_FAILED ? nullptr : static_cast<unsigned char*>( aData );
+   }
+
+   /**
+    * Abre el directorio, la confirmación y los segmentos existentes, y busca el final del
+    * registro. Los segmentos posteriores a un objeto incompleto se descartan. Falla si algún
+    * segmento no puede proyectarse o es de otro tipo de objeto; en ese caso no borra ni proyecta
+    * nada, y el registro queda cerrado.
+    */
+   bool open()
+   {
+      ::mkdir( theDirectory.c_str(), 0700 );
+      auto* aData = map( theDirectory + "/checkpoint", sizeof( std::uint64_t ) );
+      if( !aData )
+      {
+         return false;
+      }
+
+      auto* aCheckpoint = reinterpret_cast<std::atomic<std::uint64_t>*>( aData );
+      std::vector<std::uint64_t> aFirsts;
+      if( DIR* aDirectory = ::opendir( theDirectory.c_str() ) )
+      {
+         while( const dirent* anEntry = ::readdir( aDirectory ) )
+         {
+            char* anEnd;
+            const std::uint64_t aFirst = std::strtoull( anEntry->d_name, &anEnd, 16 );
+            if( anEnd != anEntry->d_name && std::strcmp( anEnd, ".log" ) == 0 )
+            {
+               aFirsts.push_back( aFirst );
+            }
+         }
+
+         ::closedir( aDirectory );
+      }
+
+      std::sort( aFirsts.begin(), aFirsts.end() );
+      theNext = aCheckpoint->load() + 1;
+      bool isComplete = true;
+      std::vector<std::uint64_t> aDiscarded;
+      for( const std::uint64_t aFirst : aFirsts )
+      {
+         if( !isComplete || ( !theSegments.empty() && aFirst != theNext ) )
+         {
+            aDiscarded.push_back( aFirst );
+            isComplete = false;
+            continue;
+         }
+
+         unsigned char* aSegment = map( path( aFirst ), theSegmentSize );
+         const auto* aHeader = reinterpret_cast<const Header*>( aSegment );
+         if( !aSegment || aHeader->theMagic != theMagic || aHeader->theRecordSize != sizeof( Record ) ||
+             aHeader->theFirst != aFirst )
+         {
+            if( aSegment )
+            {
+               ::munmap( aSegment, theSegmentSize );
+            }
+
+            for( const auto& aMapped : theSegments )
+            {
+               ::munmap( aMapped.theData, theSegmentSize );
+            }
+
+            theSegments.clear();
+            theNext = 1;
+            ::munmap( aCheckpoint, sizeof( std::uint64_t ) );
+            return false;
+         }
+
+         theSegments.push_back( Segment{ aFirst, aSegment } );
+         theNext = aFirst;
+         const Record* aRecord = record( theSegments.back(), aFirst );
+         while( theNext - aFirst < theCapacity && aRecord->theSequence == theNext &&
+                aRecord->theChecksum == checksum( theNext, aRecord->theObject ) )
+         {
+            ++theNext;
+            ++aRecord;
+         }
+
+         isComplete = theNext - aFirst == theCapacity;
+      }
+
+      for( const std::uint64_t aFirst : aDiscarded )
+      {
+         ::unlink( path( aFirst ).c_str() );
+      }
+
+      theCheckpoint = aCheckpoint;
+      theSyncedCheckpoint = aCheckpoint->load();
+      theAppended.store( theNext - 1 );
+      theSynced.store( theNext - 1 );
+      theRetirement.store( theSegments.empty() ? UINT64_MAX : theSegments.front().theFirst + theCapacity - 1 );
+      return true;
+   }
+
+   /**
+    * Empieza un segmento nuevo. Debe invocarse con el cerrojo del registro.
+    */
+   bool roll()
+   {
+      // Un fichero descartado tras una caída puede conservar objetos antiguos.
+      ::unlink( path( theNext ).c_str() );
+      unsigned char* aData = map( path( theNext ), theSegmentSize );
+      if( !aData )
+      {
+         return false;
+      }
+
+      auto* aHeader = reinterpret_cast<Header*>( aData );
+      aHeader->theMagic = theMagic;
+      aHeader->theRecordSize = sizeof( Record );
+      aHeader->theFirst = theNext;
+      theSegments.push_back( Segment{ theNext, aData } );
+      if( theSegments.size() == 1 )
+      {
+         theRetirement.store( theNext + theCapacity - 1, std::memory_order_relaxed );
+      }
+
+      return true;
+   }
+
+   /**
+    * Borra los segmentos cuyos objetos están todos confirmados y volcados, salvo el último.
+    */
+   void retire()
+   {
+      std::unique_lock<std::mutex> aLock( theMutex );
+      const std::uint64_t aLimit =
+         std::min( theCheckpoint->load( std::memory_order_relaxed ), theSynced.load( std::memory_order_acquire ) );
+      while( theSegments.size() > 1 && theSegments.front().theFirst + theCapacity - 1 <= aLimit )
+      {
+         ::munmap( theSegments.front().theData, theSegmentSize );
+         ::unlink( path( theSegments.front().theFirst ).c_str() );
+         theSegments.pop_front();
+      }
+
+      theRetirement.store( theSegments.front().theFirst + theCapacity - 1, std::memory_order_relaxed );
+   }
+
+   /**
+    * Tarea encargada de volcar los objetos al disco cada intervalo de confirmación.
+    */
+   void committer()
+   {
+      std::unique_lock<std::mutex> aLock( theCommitMutex );
+      while( !theStopped )
+      {
+         theCommitCondition.wait_for( aLock, theCommitInterval );
+         aLock.unlock();
+         sync();
+         aLock.lock();
+      }
+   }
+
+   static constexpr std::uintptr_t thePageSize = 4096;
+
+   /**
+    * El directorio del registro.
+    */
+   const std::string theDirectory;
+
+   /**
+    * El tamaño de cada segmento.
+    */
+   const std::size_t theSegmentSize;
+
+   /**
+    * El número de objetos de cada segmento.
+    */
+   const std::size_t theCapacity;
+
+   /**
+    * El intervalo entre volcados.
+    */
+   const std::chrono::microseconds theCommitInterval;
+
+   /**
+    * El mútex que protege los segmentos y el siguiente número de secuencia.
+    */
+   std::mutex theMutex;
+
+   /**
+    * Los segmentos proyectados, del más antiguo al más reciente.
+    */
+   std::deque<Segment> theSegments;
+
+   /**
+    * El número de secuencia del siguiente objeto.
+    */
+   std::uint64_t theNext{ 1 };
+
+   /**
+    * El número de secuencia del último objeto añadido.
+    */
+   std::atomic<std::uint64_t> theAppended{};
+
+   /**
+    * El número de secuencia del último objeto volcado.
+    */
+   std::atomic<std::uint64_t> theSynced{};
+
+   /**
+    * La confirmación a partir de la cual puede borrarse el segmento más antiguo.
+    */
+   std::atomic<std::uint64_t> theRetirement{ UINT64_MAX };
+
+   /**
+    * El último número de secuencia confirmado, proyectado desde su fichero.
+    */
+   std::atomic<std::uint64_t>* theCheckpoint{};
+
+   /**
+    * La última confirmación volcada. Se protege con el mútex de los volcados.
+    */
+   std::uint64_t theSyncedCheckpoint{};
+
+   /**
+    * El mútex que serializa los volcados.
+    */
+   std::mutex theSyncMutex;
+
+   /**
+    * Los rangos de memoria de un volcado.
+    */
+   std::vector<std::pair<void*, std::size_t>> theRanges;
+
+   std::mutex theCommitMutex;
+
+   std::condition_variable theCommitCondition;
+
+   bool theStopped{};
+
+   /**
+    * La tarea que vuelca los objetos al disco.
+    */
+   std::thread theCommitter;
+};
+
+/**
+ * @brief Cola asíncrona persistente.
+ *
+ * La clase DurableAsyncQueue es una AsyncQueue cuyos objetos, que deben copiarse trivialmente,
+ * se añaden a un Journal antes de almacenarse en la cola. Tras procesar cada objeto, la tarea de
+ * la cola confirma su procesamiento, y al crear la cola sobre el mismo directorio se vuelven a
+ * almacenar los objetos que no llegaron a procesarse, antes que los nuevos.
+ *
+ * @code
+ * DurableAsyncQueue<Order> aQueue{ "/var/lib/shop/orders", []( Order anOrder ) { ship( anOrder ); } };
+ * aQueue.store( Order{ 12, 3 } );
+ * @endcode
+ *
+ * A diferencia de AsyncQueue, los objetos pendientes al destruir la cola no se pierden: se
+ * procesarán en la siguiente. Cada objeto se procesa al menos una vez; solo una caída del sistema
+ * entre dos volcados puede hacer que alguno se procese de nuevo.
+ */
+template<typename T, typename Callback = std::function<void( T )>>
+class DurableAsyncQueue
+{
+public:
+
+   /**
+    * Crea la cola sobre el registro del directorio <i>aDirectory</i>, con segmentos de
+    * <i>aSegmentSize</i> bytes, y vuelve a almacenar los objetos sin procesar, que se procesarán
+    * mediante la llamada a la función <i>aCallback</i>.
+    */
+   DurableAsyncQueue( std::string aDirectory, Callback aCallback, std::size_t aSegmentSize = std::size_t{ 64 } << 20 )
+      :
+      theJournal{ std::move( aDirectory ), aSegmentSize },
+      theQueue{ Acknowledge{ std::move( aCallback ), &theJournal }, "DurableAsyncQueue" }
+   {
+      theJournal.replay( [this]( std::uint64_t aSequence, const T& anObject ) {
+                            theQueue.store( Entry{ aSequence, anObject } );
+                         } );
+   }
+
+   /**
+    * Indica si el registro está abierto.
+    */
+   bool isOpen() const
+   {
+      return theJournal.isOpen();
+   }
+
+   /**
+    * Añade un objeto al registro y lo almacena para su procesamiento posterior. Devuelve falso si
+    * no puede añadirlo.
+    */
+   bool store( const T& anObject )
+   {
+      // El cerrojo mantiene en la cola el orden de los números de secuencia, que la tarea
+      // confirma de uno en uno.
+      std::unique_lock<std::mutex> aLock( theMutex );
+      const std::uint64_t aSequence = theJournal.append( anObject );
+      if( aSequence == 0 )
+      {
+         return false;
+      }
+
+      theQueue.store( Entry{ aSequence, anObject } );
+      return true;
+   }
+
+   /**
+    * Vuelca al disco los objetos almacenados.
+    */
+   void sync()
+   {
+      theJournal.sync();
+   }
+
+   /**
+    * Devuelve las métricas de la cola.
+    */
+   const QueueMetrics& metrics() const
+   {
+      return theQueue.metrics();
+   }
+
+private:
+
+   /**
+    * Un objeto almacenado y su número de secuencia.
+    */
+   struct Entry
+   {
+      std::uint64_t theSequence;
+      T theObject;
+   };
+
+   /**
+    * La función de la cola, que procesa cada objeto y confirma su procesamiento.
+    */
+   struct Acknowledge
+   {
+      void operator()( Entry anEntry )
+      {
+         theCallback( std::move( anEntry.theObject ) );
+         theJournal->acknowledge( anEntry.theSequence );
+      }
+
+      Callback theCallback;
+      Journal<T>* theJournal;
+   };
+
+   std::mutex theMutex;
+
+   /**
+    * El registro de los objetos.
+    */
+   Journal<T> theJournal;
+
+   /**
+    * La cola, que se destruye antes que el registro.
+    */
+   AsyncQueue<Entry, Acknowledge> theQueue;
+};
+
+#endif
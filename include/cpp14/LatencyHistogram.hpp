@@ -0,0 +1,143 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_LATENCY_HISTOGRAM_HPP_
+#define INCLUDE_GENERIC_PATTERNS_LATENCY_HISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Histograma de duraciones.
+ *
+ * Reparte las duraciones, en nanosegundos, en intervalos de potencias de dos, cada uno dividido
+ * a su vez en 2^<i>Precision</i> intervalos iguales, como los histogramas HDR: el error relativo
+ * de cada duración es como mucho 2^-<i>Precision</i>, con un número fijo de intervalos y sin
+ * reservar memoria. Las duraciones menores que 2^<i>Precision</i> se guardan exactamente. Puede
+ * leerse desde otras tareas mientras se actualiza.
+ *
+ * LatencyHistogram tiene precisión 0: el intervalo <i>i</i> contiene las duraciones entre
+ * 2^(i-1) y 2^i - 1, y el intervalo 0 las nulas.
+ */
+template<unsigned Precision>
+class BasicLatencyHistogram
+{
+public:
+
+   /**
+    * Número de intervalos del histograma.
+    */
+   static constexpr std::size_t theBucketCount = ( std::size_t{ 65 } - Precision ) << Precision;
+
+   /**
+    * Añade la duración <i>aNanoseconds</i>.
+    */
+   void record( std::uint64_t aNanoseconds )
+   {
+      theBuckets[bucketOf( aNanoseconds )].fetch_add( 1, std::memory_order_relaxed );
+   }
+
+   /**
+    * Devuelve el número de duraciones del intervalo <i>aBucket</i>.
+    */
+   std::uint64_t bucket( std::size_t aBucket ) const
+   {
+      return theBuckets[aBucket].load( std::memory_order_relaxed );
+   }
+
+   /**
+    * Devuelve la mayor duración del intervalo <i>aBucket</i>.
+    */
+   static std::uint64_t upperBound( std::size_t aBucket )
+   {
+      if( aBucket < theSubBuckets )
+      {
+         return aBucket;
+      }
+
+      const std::size_t aShift = ( aBucket - theSubBuckets ) / theSubBuckets;
+      const std::uint64_t aLower = std::uint64_t{ theSubBuckets + aBucket % theSubBuckets } << aShift;
+      return aLower + ( ( std::uint64_t{ 1 } << aShift ) - 1 );
+   }
+
+   /**
+    * Devuelve el número de duraciones añadidas.
+    */
+   std::uint64_t count() const
+   {
+      std::uint64_t aCount = 0;
+      for( const std::atomic<std::uint64_t>& aBucket : theBuckets )
+      {
+         aCount += aBucket.load( std::memory_order_relaxed );
+      }
+
+      return aCount;
+   }
+
+   /**
+    * Devuelve una cota superior, en nanosegundos, de la fracción <i>aFraction</i> de las
+    * duraciones añadidas; por ejemplo, 0.99 para el percentil 99.
+    */
+   std::uint64_t quantile( double aFraction ) const
+   {
+      const std::uint64_t aTarget = static_cast<std::uint64_t>( aFraction * count() );
+      std::uint64_t aCount = 0;
+      for( std::size_t i = 0; i < theBucketCount; ++i )
+      {
+         aCount += bucket( i );
+         if( aCount > aTarget || ( aCount == aTarget && aCount != 0 ) )
+         {
+            return upperBound( i );
+         }
+      }
+
+      return 0;
+   }
+
+private:
+
+   static constexpr std::size_t theSubBuckets = std::size_t{ 1 } << Precision;
+
+   /**
+    * Devuelve el intervalo de la duración <i>aNanoseconds</i>.
+    */
+   static std::size_t bucketOf( std::uint64_t aNanoseconds )
+   {
+      if( aNanoseconds < theSubBuckets )
+      {
+         return static_cast<std::size_t>( aNanoseconds );
+      }
+
+      std::size_t aShift = 0;
+      for( std::uint64_t aValue = aNanoseconds >> Precision; aValue > 1; aValue >>= 1 )
+      {
+         ++aShift;
+      }
+
+      return theSubBuckets + aShift * theSubBuckets + static_cast<std::size_t>( ( aNanoseconds >> aShift ) - theSubBuckets );
+   }
+
+   std::array<std::atomic<std::uint64_t>, theBucketCount> theBuckets{};
+};
+
+template<unsigned Precision>
+constexpr std::size_t BasicLatencyHistogram<Precision>::theBucketCount;
+
+/**
+ * Histograma de duraciones con un intervalo por potencia de dos.
+ */
+using LatencyHistogram = BasicLatencyHistogram<0>;
+
+#endif
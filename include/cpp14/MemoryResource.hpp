@@ -0,0 +1,197 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2020 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_MEMORY_RESOURCE_HPP_
+#define INCLUDE_GENERIC_PATTERNS_MEMORY_RESOURCE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+
+/**
+ * @brief Interfaz de los recursos de memoria.
+ *
+ * La clase MemoryResource es el equivalente en C++14 de std::pmr::memory_resource: abstrae de
+ * dónde sale la memoria con la que se construyen los objetos.
+ */
+class MemoryResource
+{
+public:
+
+   virtual ~MemoryResource() {}
+
+   /**
+    * Reserva <i>aSize</i> bytes alineados a <i>anAlignment</i>.
+    */
+   virtual void* allocate( std::size_t aSize, std::size_t anAlignment ) = 0;
+
+   /**
+    * Libera la memoria <i>aBlock</i> reservada con MemoryResource::allocate.
+    */
+   virtual void deallocate( void* aBlock, std::size_t aSize, std::size_t anAlignment ) = 0;
+};
+
+/**
+ * @brief Recurso de memoria que usa los operadores globales new y delete.
+ *
+ * En C++14, new no respeta alineamientos mayores que el de std::max_align_t; para ellos se reserva
+ * un bloque mayor, se devuelve la primera dirección alineada y se guarda delante la dirección del
+ * bloque reservado.
+ */
+class NewDeleteResource : public MemoryResource
+{
+public:
+
+   void* allocate( std::size_t aSize, std::size_t anAlignment ) override
+   {
+      if( anAlignment <= alignof( std::max_align_t ) )
+      {
+         return ::operator new( aSize );
+      }
+
+      void* aRaw = ::operator new( aSize + anAlignment - 1 + sizeof( void* ) );
+      const std::uintptr_t anAddress = reinterpret_cast<std::uintptr_t>( aRaw ) + sizeof( void* );
+      void** aBlock = reinterpret_cast<void**>( ( anAddress + anAlignment - 1 ) & ~( anAlignment - 1 ) );
+      aBlock[-1] = aRaw;
+      return aBlock;
+   }
+
+   void deallocate( void* aBlock, std::size_t, std::size_t anAlignment ) override
+   {
+      if( anAlignment <= alignof( std::max_align_t ) )
+      {
+         ::operator delete( aBlock );
+      }
+      else
+      {
+         ::operator delete( static_cast<void**>( aBlock )[-1] );
+      }
+   }
+};
+
+/**
+ * Devuelve el recurso de memoria predeterminado, que usa los operadores globales new y delete.
+ */
+inline MemoryResource* newDeleteResource()
+{
+   static NewDeleteResource theResource;
+   return &theResource;
+}
+
+/**
+ * @brief Recurso de memoria monótono.
+ *
+ * La clase MonotonicBufferResource reparte la memoria de un búfer proporcionado por el llamante
+ * avanzando un puntero. Liberar un bloque no hace nada; toda la memoria se recupera de una vez, en
+ * tiempo constante, con MonotonicBufferResource::release. Cuando el búfer se agota, la reserva se
+ * delega en el recurso <i>anUpstream</i>.
+ *
+ * Es adecuado para crear una familia de objetos que viven lo mismo, por ejemplo, un fotograma o
+ * una petición, y que se destruyen juntos. Esta clase no es concurrentemente segura.
+ *
+ * @code
+ * unsigned char aBuffer[4096];
+ * MonotonicBufferResource anArena{ aBuffer, sizeof( aBuffer ) };
+ * ...
+ * anArena.release();
+ * @endcode
+ */
+class MonotonicBufferResource : public MemoryResource
+{
+public:
+
+   MonotonicBufferResource( void* aBuffer, std::size_t aSize,
+                            MemoryResource* anUpstream = newDeleteResource() )
+      :
+      theBuffer{ static_cast<unsigned char*>( aBuffer ) },
+      theSize{ aSize },
+      theUsed{},
+      theUpstream{ anUpstream }
+   {
+
+   }
+
+   /**
+    * Esta clase no se puede copiar.
+    */
+   MonotonicBufferResource( const MonotonicBufferResource& ) = delete;
+
+   /**
+    * Esta clase no se puede copiar.
+    */
+   MonotonicBufferResource& operator=( const MonotonicBufferResource& ) = delete;
+
+   void* allocate( std::size_t aSize, std::size_t anAlignment ) override
+   {
+      const std::uintptr_t aCurrent = reinterpret_cast<std::uintptr_t>( theBuffer + theUsed );
+      const std::size_t aPadding = ( anAlignment - aCurrent % anAlignment ) % anAlignment;
+      if( theUsed + aPadding + aSize > theSize )
+      {
+         return theUpstream->allocate( aSize, anAlignment );
+      }
+
+      void* aBlock = theBuffer + theUsed + aPadding;
+      theUsed += aPadding + aSize;
+      return aBlock;
+   }
+
+   void deallocate( void* aBlock, std::size_t aSize, std::size_t anAlignment ) override
+   {
+      std::less<const void*> isBefore;
+      if( isBefore( aBlock, theBuffer ) || !isBefore( aBlock, theBuffer + theSize ) )
+      {
+         theUpstream->deallocate( aBlock, aSize, anAlignment );
+      }
+   }
+
+   /**
+    * Recupera toda la memoria del búfer. Los objetos construidos en él deben estar ya destruidos.
+    */
+   void release()
+   {
+      theUsed = 0;
+   }
+
+   /**
+    * Devuelve los bytes del búfer en uso.
+    */
+   std::size_t used() const
+   {
+      return theUsed;
+   }
+
+private:
+
+   /**
+    * El búfer del que se reparte la memoria.
+    */
+   unsigned char* theBuffer;
+
+   /**
+    * El tamaño del búfer.
+    */
+   std::size_t theSize;
+
+   /**
+    * Los bytes del búfer repartidos.
+    */
+   std::size_t theUsed;
+
+   /**
+    * El recurso en el que se delega cuando el búfer se agota.
+    */
+   MemoryResource* theUpstream;
+};
+
+#endif
@@ -0,0 +1,124 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_ORTHOGONAL_REGIONS_HPP_
+#define INCLUDE_GENERIC_PATTERNS_ORTHOGONAL_REGIONS_HPP_
+
+#include <type_traits>
+#include "../common/StateTraits.hpp"
+
+/** @cond */
+
+// Declaración adelantada.
+template<template<typename> class UnhandledPolicy, typename Context, typename... States>
+class BasicStateContext;
+
+// Una región de OrthogonalRegions, que la contiene sin necesidad de copiarla ni moverla.
+template<typename R>
+struct OrthogonalRegion
+{
+   template<typename... Args>
+   explicit OrthogonalRegion( Args&... aShared )
+      :
+      theRegion( aShared... )
+   {
+
+   }
+
+   R theRegion;
+};
+
+/** @endcond */
+
+/**
+ * @brief Regiones ortogonales de una máquina de estados.
+ *
+ * La plantilla OrthogonalRegions agrupa varias máquinas de estados, las regiones, que funcionan a
+ * la vez e independientemente: cada una es un contexto derivado de StateContext con sus propios
+ * estados. Una sola llamada a OrthogonalRegions::delegate entrega la entrada a todas las regiones
+ * con algún estado que la trate; las demás se descartan en tiempo de compilación, sin pasar por
+ * su tabla de estados ni por su política de entradas no tratadas.
+ *
+ * @code
+   struct Motor : public StateContext<Motor, Stopped, Turning> { ... };
+   struct Lights : public StateContext<Lights, Off, Blinking> { ... };
+
+   OrthogonalRegions<Motor, Lights> aController;
+   aController.delegate( Start{} );
+   @endcode
+ *
+ * Las regiones se construyen con los mismos argumentos, normalmente referencias a los datos que
+ * comparten, y se recorren en el orden de la plantilla. Debe incluirse antes la cabecera del
+ * contexto de la máquina de estados.
+ */
+template<typename... Regions>
+class OrthogonalRegions : private OrthogonalRegion<Regions>...
+{
+public:
+
+   /**
+    * Construye cada región con los argumentos <i>aShared</i>.
+    */
+   template<typename... Args>
+   explicit OrthogonalRegions( Args&... aShared )
+      :
+      OrthogonalRegion<Regions>( aShared... )...
+   {
+
+   }
+
+   /**
+    * Entrega la entrada <i>anInput</i> al estado actual de cada región que la trate.
+    */
+   template<typename T>
+   void delegate( const T& anInput )
+   {
+      int anExpansion[] = { 0, ( deliver( region<Regions>(), anInput ), 0 )... };
+      static_cast<void>( anExpansion );
+   }
+
+   /**
+    * Devuelve la región <i>R</i>.
+    */
+   template<typename R>
+   R& region()
+   {
+      return static_cast<OrthogonalRegion<R>&>( *this ).theRegion;
+   }
+
+private:
+
+   /**
+    * Entrega la entrada <i>anInput</i> a la región <i>aRegion</i> si alguno de sus estados la
+    * trata.
+    */
+   template<template<typename> class P, typename C, typename... States, typename T>
+   static void deliver( BasicStateContext<P, C, States...>& aRegion, const T& anInput )
+   {
+      deliver( aRegion, anInput, AnyOf<CanHandle<States, T>::value...>() );
+   }
+
+   template<typename Region, typename T>
+   static void deliver( Region& aRegion, const T& anInput, std::true_type )
+   {
+      aRegion.delegate( anInput );
+   }
+
+   template<typename Region, typename T>
+   static void deliver( Region&, const T&, std::false_type )
+   {
+
+   }
+};
+
+#endif
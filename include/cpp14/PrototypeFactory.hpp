@@ -0,0 +1,276 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2020 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_PROTOTYPE_FACTORY_HPP_
+#define INCLUDE_GENERIC_PATTERNS_PROTOTYPE_FACTORY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "FactoryMethod.hpp"
+
+/**
+ * @brief Fábrica de productos mediante la clonación de prototipos.
+ *
+ * La clase PrototypeFactory es la alternativa a FactoryMethod para aquellos productos cuya
+ * construcción desde cero es cara (tablas de búsqueda, configuración procesada, etc.) pero cuya
+ * copia es barata. En lugar de registrar un tipo, se registra por cada clave una instancia ya
+ * construida, el prototipo, y los productos se crean copiándolo.
+ *
+ * La plantilla necesita de dos argumentos:
+ *    - Key, un tipo que se empleará como clave unívoca con el que asociar el prototipo. Tiene los
+ *    mismos requisitos que la clave de FactoryMethod.
+ *    - Base, la clase base de la jerarquía de los objetos a crear.
+ *
+ * Los productos pueden obtenerse de tres formas:
+ *    - PrototypeFactory::create, que devuelve una copia propia del prototipo.
+ *    - PrototypeFactory::emplace, que copia el prototipo en una memoria del llamante sin reservar
+ *    memoria dinámica.
+ *    - PrototypeFactory::share, que devuelve el propio prototipo de solo lectura. Es el
+ *    equivalente a la copia en escritura: quien necesite modificarlo debe crear su copia.
+ *
+ * Un prototipo puede registrarse directamente o mediante una función que lo construye. En el
+ * segundo caso, la fábrica lo construye la primera vez que se necesita y lo vuelve a construir
+ * cuando se invalida. Refrescar o invalidar un prototipo no afecta a los productos ya obtenidos.
+ *
+ * @code
+ * PrototypeFactory<std::string, Table> aFactory;
+ * aFactory.registerType<Dictionary>( "ES", [] { return Dictionary{ "es.dic" }; } );
+ *
+ * std::shared_ptr<Table> aTable{ aFactory.create( "ES" ) };
+ * std::shared_ptr<const Table> aSharedTable{ aFactory.share( "ES" ) };
+ *
+ * // El fichero ha cambiado: el prototipo se reconstruirá en la siguiente creación.
+ * aFactory.invalidate( "ES" );
+ * @endcode
+ */
+template<typename Key, class Base>
+class PrototypeFactory
+{
+public:
+
+   /**
+    * El prototipo vinculado a una clave y las funciones que lo clonan.
+    */
+   struct Prototype
+   {
+      std::function<std::shared_ptr<const Base>()> build;
+      std::shared_ptr<Base> ( *clone )( const Base& );
+      Base* ( *construct )( void*, const Base& );
+      std::size_t size;
+      std::size_t alignment;
+      std::shared_ptr<const Base> instance;
+   };
+
+   /**
+    * Alias para un mapa que vincula una clave con un prototipo.
+    */
+   using Table = std::map<Key, Prototype>;
+
+   /**
+    * Registra la instancia <i>aPrototype</i> como prototipo de los productos identificados por
+    * <i>aKey</i>.
+    */
+   template<class Derived>
+   void registerPrototype( const Key& aKey, Derived aPrototype )
+   {
+      theProducts[aKey] = makePrototype<Derived>( nullptr );
+      theProducts[aKey].instance = std::make_shared<const Derived>( std::move( aPrototype ) );
+   }
+
+   /**
+    * Registra la función <i>aBuilder</i>, que devuelve un objeto de tipo <i>Derived</i>, como
+    * constructora del prototipo de los productos identificados por <i>aKey</i>. El prototipo no se
+    * construye hasta que se necesita.
+    */
+   template<class Derived, typename Builder>
+   void registerType( const Key& aKey, Builder aBuilder )
+   {
+      theProducts[aKey] = makePrototype<Derived>( [aBuilder]() -> std::shared_ptr<const Base> {
+                                                     return std::make_shared<const Derived>( aBuilder() );
+                                                  } );
+   }
+
+   /**
+    * Crea una copia del prototipo vinculado al identificador <i>aKey</i> y devuelve un puntero a
+    * su base.
+    */
+   std::shared_ptr<Base> create( const Key& aKey )
+   {
+      const Prototype* aPrototype = find( aKey );
+      return aPrototype != nullptr ? aPrototype->clone( *aPrototype->instance ) : nullptr;
+   }
+
+   /**
+    * Copia el prototipo vinculado al identificador <i>aKey</i> en la memoria <i>aStorage</i> de
+    * <i>aSize</i> bytes y devuelve un puntero a su base. Devuelve nulo si no existe el prototipo o
+    * si la copia no cabe en la memoria o no respeta su alineación. El llamante es responsable de
+    * destruir el objeto.
+    */
+   Base* emplace( const Key& aKey, void* aStorage, std::size_t aSize )
+   {
+      const Prototype* aPrototype = find( aKey );
+      if( aPrototype == nullptr || aPrototype->size > aSize ||
+          reinterpret_cast<std::uintptr_t>( aStorage ) % aPrototype->alignment != 0 )
+      {
+         return nullptr;
+      }
+
+      return aPrototype->construct( aStorage, *aPrototype->instance );
+   }
+
+   /**
+    * Copia el prototipo vinculado al identificador <i>aKey</i> en el hueco <i>aSlot</i>,
+    * destruyendo el objeto que este contuviera, y devuelve un puntero a su base. Devuelve nulo, y
+    * deja el hueco vacío, si no es posible copiarlo.
+    */
+   template<std::size_t Size, std::size_t Alignment>
+   Base* emplace( ProductSlot<Base, Size, Alignment>& aSlot, const Key& aKey )
+   {
+      aSlot.reset();
+      aSlot.theProduct = emplace( aKey, aSlot.theStorage, Size );
+      return aSlot.theProduct;
+   }
+
+   /**
+    * Devuelve el prototipo vinculado al identificador <i>aKey</i> para su uso compartido y de solo
+    * lectura. El objeto devuelto sigue siendo válido aunque el prototipo se refresque o se
+    * invalide.
+    */
+   std::shared_ptr<const Base> share( const Key& aKey )
+   {
+      const Prototype* aPrototype = find( aKey );
+      return aPrototype != nullptr ? aPrototype->instance : nullptr;
+   }
+
+   /**
+    * Sustituye el prototipo vinculado al identificador <i>aKey</i> por <i>aPrototype</i>. Si este
+    * es del mismo tipo que el registrado, se conserva la función constructora, si la hay, para
+    * cuando el prototipo se invalide; si no, se descarta.
+    */
+   template<class Derived>
+   void refresh( const Key& aKey, Derived aPrototype )
+   {
+      typename Table::iterator it = theProducts.find( aKey );
+      if( it != theProducts.end() )
+      {
+         const bool isSameType = it->second.clone == &cloneProduct<Derived>;
+         Prototype aRefreshed = makePrototype<Derived>( isSameType ? std::move( it->second.build )
+                                                                   : nullptr );
+         aRefreshed.instance = std::make_shared<const Derived>( std::move( aPrototype ) );
+         it->second = std::move( aRefreshed );
+      }
+   }
+
+   /**
+    * Vuelve a construir el prototipo vinculado al identificador <i>aKey</i> mediante su función
+    * constructora, si la tiene.
+    */
+   void refresh( const Key& aKey )
+   {
+      typename Table::iterator it = theProducts.find( aKey );
+      if( it != theProducts.end() && it->second.build )
+      {
+         it->second.instance = it->second.build();
+      }
+   }
+
+   /**
+    * Descarta el prototipo vinculado al identificador <i>aKey</i>. Si tiene función constructora,
+    * se volverá a construir cuando se necesite; si no, no se crearán productos hasta que se
+    * refresque con una nueva instancia.
+    */
+   void invalidate( const Key& aKey )
+   {
+      typename Table::iterator it = theProducts.find( aKey );
+      if( it != theProducts.end() )
+      {
+         it->second.instance.reset();
+      }
+   }
+
+   /**
+    * Elimina el prototipo vinculado al identificador <i>aKey</i>.
+    */
+   void remove( const Key& aKey )
+   {
+      theProducts.erase( aKey );
+   }
+
+private:
+
+   /**
+    * Devuelve el prototipo vinculado al identificador <i>aKey</i>, construyéndolo si es necesario,
+    * o nulo si no existe.
+    */
+   const Prototype* find( const Key& aKey )
+   {
+      typename Table::iterator it = theProducts.find( aKey );
+      if( it == theProducts.end() )
+      {
+         return nullptr;
+      }
+
+      if( !it->second.instance && it->second.build )
+      {
+         it->second.instance = it->second.build();
+      }
+
+      return it->second.instance ? &it->second : nullptr;
+   }
+
+   /**
+    * Crea el prototipo, aún sin instancia, de los productos de tipo <i>Derived</i>.
+    */
+   template<class Derived>
+   static Prototype makePrototype( std::function<std::shared_ptr<const Base>()> aBuilder )
+   {
+      static_assert( std::is_base_of<Base, Derived>::value,
+                     "PrototypeFactory::registerType: type doesn't derive from base class" );
+      static_assert( std::is_copy_constructible<Derived>::value,
+                     "PrototypeFactory::registerType: type isn't copy constructible" );
+      return Prototype{ std::move( aBuilder ), &cloneProduct<Derived>, &constructProduct<Derived>,
+                        sizeof( Derived ), alignof( Derived ), nullptr };
+   }
+
+   /**
+    * Función plantilla para la copia de los distintos tipos de prototipos.
+    */
+   template<class Derived>
+   static std::shared_ptr<Base> cloneProduct( const Base& aPrototype )
+   {
+      return std::make_shared<Derived>( static_cast<const Derived&>( aPrototype ) );
+   }
+
+   /**
+    * Función plantilla para la copia de los distintos tipos de prototipos en una memoria
+    * proporcionada por el llamante.
+    */
+   template<class Derived>
+   static Base* constructProduct( void* aStorage, const Base& aPrototype )
+   {
+      return ::new( aStorage ) Derived( static_cast<const Derived&>( aPrototype ) );
+   }
+
+   /**
+    * La tabla que vincula los identificadores con los prototipos.
+    */
+   Table theProducts;
+};
+
+#endif
@@ -19,7 +19,8 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
-#include "cpp14/SafeQueue.hpp"
+#include <typeinfo>
+#include "cpp14/AsyncQueue.hpp"
 #include "cpp14/Subscriber.hpp"
 
 /**
@@ -72,6 +73,14 @@ public:
       theChangeManager.start();
    }
 
+   /**
+    * Devuelve las métricas de la cola de publicación asíncrona.
+    */
+   const QueueMetrics& metrics() const
+   {
+      return theChangeManager.metrics();
+   }
+
    /**
     * Registra el observador <i>aObserver</i> para la recepción de notificaciones.
     */
@@ -118,8 +127,24 @@ template<class T>
 class SyncChangeManager;
 
 // Declaración adelantada.
+template<class T, typename Wait>
+class BasicAsyncChangeManager;
+
+/**
+ * Gestor para la publicación asíncrona cuya tarea se duerme mientras no hay notificaciones.
+ */
 template<class T>
-class AsyncChangeManager;
+using AsyncChangeManager = BasicAsyncChangeManager<T, BlockingWait>;
+
+/** @cond */
+// Gestor asíncrono con la estrategia de espera Wait, como plantilla de un solo parámetro.
+template<typename Wait>
+struct AsyncManagerOf
+{
+   template<class T>
+   using Type = BasicAsyncChangeManager<T, Wait>;
+};
+/** @endcond */
 
 /**
  * @brief Base para la creación de publicadores síncronos.
@@ -210,58 +235,74 @@ using SyncPublisher = Publisher<T, SyncChangeManager>;
 template<typename T>
 using AsyncPublisher = Publisher<T, AsyncChangeManager>;
 
+/**
+ * @brief Base para la creación de publicadores asíncronos con otra estrategia de espera.
+ *
+ * Igual que AsyncPublisher, pero la tarea que envía las notificaciones espera según la estrategia
+ * <i>Wait</i> de BasicSafeQueue. Por ejemplo, SpinParkWait reduce el tiempo de entrega a costa
+ * de consumir algo de procesador.
+ *
+ * @code
+ * struct Publicador : public BasicAsyncPublisher<Publicador, SpinParkWait> { ... }
+ * @endcode
+ */
+template<typename T, typename Wait>
+using BasicAsyncPublisher = Publisher<T, AsyncManagerOf<Wait>::template Type>;
+
 /**
  * @brief Gestor para la publicación asíncrona.
  *
- * La plantilla AsyncChangeManager<T> es la delegada de un publicador de tipo T que notifica los
- * cambios a sus suscriptores de manera asíncrona, es decir, las notificaciones se almacenan en
- * una cola y un subproceso se encarga de sacarlas y enviarlas. También permite a los suscriptores
- * suscribirse y anular la suscripción.
+ * La plantilla BasicAsyncChangeManager<T, Wait> es la delegada de un publicador de tipo T que
+ * notifica los cambios a sus suscriptores de manera asíncrona, es decir, las notificaciones se
+ * almacenan en una cola y un subproceso se encarga de sacarlas y enviarlas. También permite a los
+ * suscriptores suscribirse y anular la suscripción. El subproceso espera las notificaciones según
+ * la estrategia <i>Wait</i>.
  *
  * Se puede acceder concurrentemente y de forma segura a los miembros.
  *
  * Las clases generadas no se pueden copiar ni mover para evitar que los publicadores copiados
  * obtengan la lista de suscriptores.
  */
-template<class T>
-class AsyncChangeManager
+template<class T, typename Wait>
+class BasicAsyncChangeManager
 {
 public:
 
-   AsyncChangeManager() = default;
+   BasicAsyncChangeManager() = default;
 
    /**
-    * Arranca la tarea encarga de enviar las notificaciones.
+    * Arranca la tarea encarga de enviar las notificaciones. Las notificaciones anteriores se
+    * descartan.
     */
    void start()
    {
-      if( !theRunningThread.load() )
+      if( !theQueue )
       {
-         theRunningThread.store( true );
-         theDispatcher = std::thread{ [this] { dispatcher(); } };
+         theQueue.reset( new Queue{ Dispatch{ this }, shareMetrics() } );
       }
    }
 
    /**
-    * Detiene la tarea encarga de enviar las notificaciones.
+    * Devuelve las métricas de la cola de notificaciones, que incluyen como descartadas las
+    * anteriores al arranque.
     */
-   ~AsyncChangeManager()
+   const QueueMetrics& metrics() const
    {
-      if( theRunningThread.load() )
-      {
-         theRunningThread.store( false );
-         theQueue.stop();
-         theDispatcher.join();
-      }
+      return *shareMetrics();
    }
 
-   AsyncChangeManager( const AsyncChangeManager& ) = delete;
+   /**
+    * Detiene la tarea encarga de enviar las notificaciones.
+    */
+   ~BasicAsyncChangeManager() = default;
+
+   BasicAsyncChangeManager( const BasicAsyncChangeManager& ) = delete;
 
-   AsyncChangeManager& operator=( const AsyncChangeManager& ) = delete;
+   BasicAsyncChangeManager& operator=( const BasicAsyncChangeManager& ) = delete;
 
-   AsyncChangeManager( AsyncChangeManager&& ) = delete;
+   BasicAsyncChangeManager( BasicAsyncChangeManager&& ) = delete;
 
-   AsyncChangeManager& operator=( AsyncChangeManager&& ) = delete;
+   BasicAsyncChangeManager& operator=( BasicAsyncChangeManager&& ) = delete;
 
 public:
 
@@ -286,88 +327,110 @@ public:
    /**
     * Notifica a los observadores registrados que los datos de la clase han cambiado.
     */
-   void notify( AsyncPublisher<T>& aSubject )
+   template<template<typename> class Manager>
+   void notify( Publisher<T, Manager>& aSubject )
    {
-      theCopiedSubject = false;
-      theQueue.push( static_cast<T*>( &aSubject ) );
+      if( theQueue )
+      {
+         theQueue->store( Notification{ static_cast<T*>( &aSubject ), Release{ false } } );
+      }
+      else
+      {
+         shareMetrics()->onDrop();
+      }
    }
 
    /**
     * Notifica a los observadores registrados, entregando una copia del sujeto, que los datos de la
     * clase han cambiado.
     */
-   void deliver( AsyncPublisher<T>& aSubject )
+   template<template<typename> class Manager>
+   void deliver( Publisher<T, Manager>& aSubject )
    {
-      theCopiedSubject = true;
-      theQueue.push( new T{ static_cast<T&>( aSubject ) } );
+      if( theQueue )
+      {
+         theQueue->store( Notification{ new T{ static_cast<T&>( aSubject ) }, Release{ true } } );
+      }
+      else
+      {
+         shareMetrics()->onDrop();
+      }
    }
 
 private:
 
    /**
-    * Tarea encargada de enviar a los observadores las notificaciones.
+    * Devuelve las métricas de la cola de notificaciones y las crea la primera vez.
     */
-   void dispatcher()
+   const std::shared_ptr<QueueMetrics>& shareMetrics() const
    {
-      while( theRunningThread.load() )
+      std::call_once( theMetricsCreation, [this] { theMetrics = QueueMetrics::create( typeid( T ).name() ); } );
+      return theMetrics;
+   }
+
+   /**
+    * Libera el sujeto de una notificación si es una copia.
+    */
+   struct Release
+   {
+      void operator()( const T* aSubject ) const
       {
-         T* aSubject = theQueue.front();
-         if( theRunningThread.load() )
+         if( theCopy )
          {
-            theQueue.pop();
-
-            if( aSubject )
-            {
-               for( auto i : theObservers )
-               {
-                  i->update( static_cast<const T&>( *aSubject ) );
-               }
-
-               if( theCopiedSubject.load() )
-               {
-                  delete aSubject;
-               }
-            }
+            delete aSubject;
          }
       }
-   }
 
-private:
+      bool theCopy{};
+   };
 
    /**
-    * La lista de objetos que observan a este sujeto.
+    * Una notificación: el sujeto o una copia suya, que se libera tras enviarla.
     */
-   std::forward_list<std::shared_ptr<SubscriberBase<T>>> theObservers;
+   using Notification = std::unique_ptr<const T, Release>;
 
    /**
-    * El mútex para sincronizar el acceso a la lista de observadores.
+    * Envía a los observadores las notificaciones que saca la cola.
     */
-   std::mutex theMutex;
+   struct Dispatch
+   {
+      void operator()( Notification aSubject )
+      {
+         for( auto& i : theManager->theObservers )
+         {
+            i->update( *aSubject );
+         }
+      }
 
-   /**
-    * La condición que señala cuándo hay que enviar las notificaciones.
-    */
-   std::condition_variable theNotificationCondition;
+      BasicAsyncChangeManager* theManager;
+   };
+
+   using Queue = AsyncQueue<Notification, Dispatch, Waiting<Wait>::template Queue>;
 
    /**
-    * Indica si la tarea se está ejecutando.
+    * La lista de objetos que observan a este sujeto.
     */
-   std::atomic<bool> theRunningThread{};
+   std::forward_list<std::shared_ptr<SubscriberBase<T>>> theObservers;
 
    /**
-    * Indica si el sujeto tiene notificaciones pendientes.
+    * El mútex para sincronizar el acceso a la lista de observadores.
     */
-   SafeQueue<T*> theQueue;
+   std::mutex theMutex;
 
    /**
-    * Indica si al notificar se ha hecho copia del sujeto.
+    * Las métricas de la cola de notificaciones. No se crean hasta que se arranca el gestor, se
+    * consultan o se descarta una notificación, para que las copias del sujeto que entrega
+    * BasicAsyncChangeManager::deliver no reserven ni registren las suyas.
     */
-   std::atomic<bool> theCopiedSubject{};
+   mutable std::shared_ptr<QueueMetrics> theMetrics;
+
+   mutable std::once_flag theMetricsCreation;
 
    /**
-    * El identificador de la tarea.
+    * La cola de notificaciones y su tarea, que existen desde que se arranca el gestor. Se destruye
+    * antes que la lista de observadores.
     */
-   std::thread theDispatcher;
+   std::unique_ptr<Queue> theQueue;
 };
 
 /**
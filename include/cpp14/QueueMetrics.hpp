@@ -0,0 +1,365 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2020 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_QUEUE_METRICS_HPP_
+#define INCLUDE_GENERIC_PATTERNS_QUEUE_METRICS_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "LatencyHistogram.hpp"
+
+/**
+ * @brief Estado de una cola en un instante.
+ */
+struct QueueSnapshot
+{
+   /**
+    * El nombre de la cola.
+    */
+   std::string theName;
+
+   /**
+    * Número de objetos almacenados, incluidos los programados.
+    */
+   std::uint64_t theEnqueued;
+
+   /**
+    * Número de objetos entregados a la función de la cola.
+    */
+   std::uint64_t theDispatched;
+
+   /**
+    * Número de objetos descartados: cancelados, anteriores al arranque o pendientes al destruir
+    * la cola.
+    */
+   std::uint64_t theDropped;
+
+   /**
+    * Número de objetos que esperan en la cola, sin contar los programados.
+    */
+   std::uint64_t theDepth;
+
+   /**
+    * El mayor número de objetos que han esperado en la cola a la vez.
+    */
+   std::uint64_t theHighWater;
+
+   /**
+    * Número de esperas medidas.
+    */
+   std::uint64_t theSamples;
+
+   /**
+    * Cotas, en nanosegundos, de la mediana y de los percentiles 99 y 99,9 de las esperas
+    * medidas, y de la mayor.
+    */
+   std::uint64_t theMedian;
+   std::uint64_t the99th;
+   std::uint64_t the999th;
+   std::uint64_t theMaximum;
+};
+
+/**
+ * @brief Métricas de una cola asíncrona.
+ *
+ * La clase QueueMetrics cuenta los objetos que se almacenan, se entregan y se descartan en una
+ * cola, el mayor número de objetos que esperan a la vez, y la espera de los objetos desde que se
+ * almacenan hasta que se entregan a la función de la cola. AsyncQueue, y por tanto Courier y los
+ * publicadores asíncronos, tienen siempre sus propias métricas.
+ *
+ * Los contadores son atómicos con orden relajado: almacenar un objeto solo cuesta un incremento, y
+ * los demás contadores los actualiza únicamente la tarea de la cola. La espera se mide en uno de
+ * cada 64 objetos, que guardan el instante de almacenamiento en un búfer circular, y se añade a un
+ * histograma con un error relativo de un octavo; con varios productores, el objeto medido puede no
+ * ser exactamente el que se entrega, por lo que la medida es aproximada.
+ *
+ * Todas las métricas vivas pueden leerse desde cualquier tarea con QueueMetrics::collect.
+ *
+ * @code
+ * for( const QueueSnapshot& aQueue : QueueMetrics::collect() ) { ... }
+ * @endcode
+ */
+class QueueMetrics
+{
+public:
+
+   /**
+    * Histograma de las esperas.
+    */
+   using Histogram = BasicLatencyHistogram<3>;
+
+   /**
+    * Crea las métricas de la cola de nombre <i>aName</i> y las registra, olvidando de paso las de
+    * las colas destruidas.
+    */
+   static std::shared_ptr<QueueMetrics> create( std::string aName )
+   {
+      std::shared_ptr<QueueMetrics> aMetrics( new QueueMetrics{ std::move( aName ) } );
+      std::lock_guard<std::mutex> aLock{ registry().theMutex };
+      auto& aRegistered = registry().theMetrics;
+      aRegistered.erase( std::remove_if( aRegistered.begin(), aRegistered.end(),
+                                         []( const std::weak_ptr<QueueMetrics>& aQueue ) { return aQueue.expired(); } ),
+                         aRegistered.end() );
+      aRegistered.push_back( aMetrics );
+      return aMetrics;
+   }
+
+   QueueMetrics( const QueueMetrics& ) = delete;
+
+   QueueMetrics& operator=( const QueueMetrics& ) = delete;
+
+   /**
+    * Devuelve el nombre de la cola.
+    */
+   const std::string& name() const
+   {
+      return theName;
+   }
+
+   /**
+    * Anota que se almacena un objeto. Debe invocarse antes de insertarlo en la cola.
+    */
+   void onStore()
+   {
+      const std::uint64_t aPosition = theStored.fetch_add( 1, std::memory_order_relaxed );
+      if( ( aPosition & theSampleMask ) == 0 )
+      {
+         theStamps[( aPosition >> theSampleShift ) & theStampMask].store( tag( aPosition ) | clock(), std::memory_order_relaxed );
+      }
+   }
+
+   /**
+    * Anota que se programa un objeto.
+    */
+   void onSchedule()
+   {
+      theScheduled.fetch_add( 1, std::memory_order_relaxed );
+   }
+
+   /**
+    * Anota que se descartan <i>aCount</i> objetos.
+    */
+   void onDrop( std::uint64_t aCount = 1 )
+   {
+      theDropped.fetch_add( aCount, std::memory_order_relaxed );
+   }
+
+   /**
+    * Anota que la tarea de la cola ha sacado un objeto. Solo debe invocarla esa tarea.
+    */
+   void onTake()
+   {
+      // La cola solo se vacía al sacar objetos, así que su mayor longitud es la que tiene justo
+      // antes de sacar alguno.
+      const std::uint64_t aPosition = theTaken.load( std::memory_order_relaxed );
+      const std::uint64_t aDepth = theStored.load( std::memory_order_relaxed ) - aPosition;
+      if( aDepth > theHighWater.load( std::memory_order_relaxed ) )
+      {
+         theHighWater.store( aDepth, std::memory_order_relaxed );
+      }
+
+      if( ( aPosition & theSampleMask ) == 0 )
+      {
+         const std::uint64_t aStamp =
+            theStamps[( aPosition >> theSampleShift ) & theStampMask].load( std::memory_order_relaxed );
+         if( ( aStamp & ~theTimeMask ) == tag( aPosition ) )
+         {
+            theLatency.record( ( clock() - aStamp ) & theTimeMask );
+         }
+      }
+
+      theTaken.store( aPosition + 1, std::memory_order_relaxed );
+   }
+
+   /**
+    * Anota que la tarea de la cola entrega <i>aCount</i> objetos programados. Solo debe
+    * invocarla esa tarea.
+    */
+   void onExpire( std::uint64_t aCount )
+   {
+      theExpired.store( theExpired.load( std::memory_order_relaxed ) + aCount, std::memory_order_relaxed );
+   }
+
+   /**
+    * Devuelve el histograma de las esperas.
+    */
+   const Histogram& latency() const
+   {
+      return theLatency;
+   }
+
+   /**
+    * Devuelve el estado actual de la cola.
+    */
+   QueueSnapshot snapshot() const
+   {
+      const std::uint64_t aTaken = theTaken.load( std::memory_order_relaxed );
+      const std::uint64_t aStored = theStored.load( std::memory_order_relaxed );
+      const std::uint64_t aDepth = aStored > aTaken ? aStored - aTaken : 0;
+      const std::uint64_t aHighWater = theHighWater.load( std::memory_order_relaxed );
+      return QueueSnapshot{ theName,
+                            aStored + theScheduled.load( std::memory_order_relaxed ),
+                            aTaken + theExpired.load( std::memory_order_relaxed ),
+                            theDropped.load( std::memory_order_relaxed ),
+                            aDepth,
+                            aDepth > aHighWater ? aDepth : aHighWater,
+                            theLatency.count(),
+                            theLatency.quantile( 0.5 ),
+                            theLatency.quantile( 0.99 ),
+                            theLatency.quantile( 0.999 ),
+                            theLatency.quantile( 1.0 ) };
+   }
+
+   /**
+    * Devuelve el estado de todas las colas vivas.
+    */
+   static std::vector<QueueSnapshot> collect()
+   {
+      std::vector<QueueSnapshot> aSnapshots;
+      std::lock_guard<std::mutex> aLock{ registry().theMutex };
+      auto& aMetrics = registry().theMetrics;
+      for( auto i = aMetrics.begin(); i != aMetrics.end(); )
+      {
+         if( std::shared_ptr<QueueMetrics> aQueue = i->lock() )
+         {
+            aSnapshots.push_back( aQueue->snapshot() );
+            ++i;
+         }
+         else
+         {
+            i = aMetrics.erase( i );
+         }
+      }
+
+      return aSnapshots;
+   }
+
+   /**
+    * Escribe en <i>anOutput</i> el estado de todas las colas vivas, una por línea: el nombre, los
+    * objetos almacenados, entregados, descartados y en espera, la mayor espera simultánea, y las
+    * cotas de la mediana y del percentil 99 de las esperas en nanosegundos.
+    */
+   static void dump( std::ostream& anOutput )
+   {
+      for( const QueueSnapshot& aQueue : collect() )
+      {
+         anOutput << aQueue.theName << ' ' << aQueue.theEnqueued << ' ' << aQueue.theDispatched << ' '
+                  << aQueue.theDropped << ' ' << aQueue.theDepth << ' ' << aQueue.theHighWater << ' '
+                  << aQueue.theMedian << ' ' << aQueue.the99th << '\n';
+      }
+   }
+
+private:
+
+   explicit QueueMetrics( std::string aName )
+      :
+      theName{ std::move( aName ) }
+   {
+
+   }
+
+   /**
+    * Se mide la espera de uno de cada 2^theSampleShift objetos.
+    */
+   static constexpr unsigned theSampleShift = 6;
+
+   static constexpr std::uint64_t theSampleMask = ( std::uint64_t{ 1 } << theSampleShift ) - 1;
+
+   /**
+    * Número de instantes de almacenamiento guardados.
+    */
+   static constexpr std::size_t theStampCount = 64;
+
+   static constexpr std::uint64_t theStampMask = theStampCount - 1;
+
+   /**
+    * Cada instante guardado ocupa los 48 bits inferiores, en nanosegundos módulo 2^48, unos tres
+    * días; los superiores identifican el objeto medido.
+    */
+   static constexpr std::uint64_t theTimeMask = ( std::uint64_t{ 1 } << 48 ) - 1;
+
+   /**
+    * Devuelve la marca del objeto de la posición <i>aPosition</i>.
+    */
+   static std::uint64_t tag( std::uint64_t aPosition )
+   {
+      return ( aPosition >> theSampleShift ) << 48;
+   }
+
+   /**
+    * Devuelve el instante actual en nanosegundos, módulo 2^48.
+    */
+   static std::uint64_t clock()
+   {
+      return static_cast<std::uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch() ).count() ) & theTimeMask;
+   }
+
+   /**
+    * Las métricas de todas las colas.
+    */
+   struct Registry
+   {
+      std::mutex theMutex;
+      std::vector<std::weak_ptr<QueueMetrics>> theMetrics;
+   };
+
+   static Registry& registry()
+   {
+      static Registry theRegistry;
+      return theRegistry;
+   }
+
+   /**
+    * El nombre de la cola.
+    */
+   const std::string theName;
+
+   /**
+    * Los contadores que actualizan los productores. Se separan de los demás con relleno en lugar
+    * de alineamiento porque new no respeta alineamientos mayores que el de max_align_t en C++14.
+    */
+   char theProducerPadding[64];
+   std::atomic<std::uint64_t> theStored{};
+   std::atomic<std::uint64_t> theScheduled{};
+   std::atomic<std::uint64_t> theDropped{};
+
+   /**
+    * Los contadores que actualiza la tarea de la cola.
+    */
+   char theConsumerPadding[64];
+   std::atomic<std::uint64_t> theTaken{};
+   std::atomic<std::uint64_t> theExpired{};
+   std::atomic<std::uint64_t> theHighWater{};
+
+   /**
+    * Los instantes de almacenamiento de los objetos medidos.
+    */
+   std::array<std::atomic<std::uint64_t>, theStampCount> theStamps{};
+
+   /**
+    * El histograma de las esperas.
+    */
+   Histogram theLatency;
+};
+
+#endif
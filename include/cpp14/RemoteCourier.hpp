@@ -0,0 +1,152 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2020 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_REMOTE_COURIER_HPP_
+#define INCLUDE_GENERIC_PATTERNS_REMOTE_COURIER_HPP_
+
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "SharedMemory.hpp"
+
+/**
+ * @brief Mensajero entre procesos.
+ *
+ * La clase RemoteCourier entrega a un destinatario de tipo T los mensajes <i>Messages</i> que
+ * otros procesos envían por un SharedChannel, invocando a su función receive con cada mensaje,
+ * en el orden de envío y desde una tarea propia, como Courier. Los mensajes deben copiarse
+ * trivialmente, por lo que no hay objetos Deliverable: el destinatario se elige en tiempo de
+ * compilación con una tabla indexada por la posición del mensaje en la lista, y recibe una
+ * referencia al mensaje dentro de la memoria compartida, sin copiarlo.
+ *
+ * @code
+ * RemoteCourier<Shop&, Sale, Restock> aCourier{ "/shop", aShop };
+ * @endcode
+ *
+ * Los otros procesos envían los mensajes abriendo el canal con la misma lista de mensajes:
+ *
+ * @code
+ * SharedChannel<Sale, Restock> aChannel{ SharedMemory{ "/shop" } };
+ * aChannel.send( Sale{ 12 } );
+ * @endcode
+ *
+ * El mensajero crea e inicializa el canal, por lo que debe existir antes que los remitentes.
+ * Solo funciona en Linux.
+ */
+template<typename T, typename... Messages>
+class RemoteCourier
+{
+public:
+
+   /**
+    * El canal por el que llegan los mensajes.
+    */
+   using Channel = SharedChannel<Messages...>;
+
+   /**
+    * Crea el segmento con nombre <i>aName</i> para un canal de <i>aCapacity</i> mensajes, que debe
+    * ser una potencia de dos, y pone en marcha la tarea que entrega los mensajes a
+    * <i>aDestination</i>.
+    */
+   RemoteCourier( const char* aName, T aDestination, std::uint32_t aCapacity = 1024 )
+      :
+      RemoteCourier( SharedMemory{ aName, Channel::sizeFor( aCapacity ) }, std::forward<T>( aDestination ), aCapacity )
+   {
+
+   }
+
+   /**
+    * Inicializa en el segmento <i>aMemory</i> un canal de <i>aCapacity</i> mensajes y pone en
+    * marcha la tarea que entrega los mensajes a <i>aDestination</i>.
+    */
+   RemoteCourier( SharedMemory&& aMemory, T aDestination, std::uint32_t aCapacity = 1024 )
+      :
+      theChannel{ std::move( aMemory ), aCapacity },
+      theDestination{ std::forward<T>( aDestination ) }
+   {
+      if( theChannel.isOpen() )
+      {
+         theDispatcher = std::thread( [this] { dispatcher(); } );
+      }
+   }
+
+   RemoteCourier( const RemoteCourier& ) = delete;
+
+   RemoteCourier& operator=( const RemoteCourier& ) = delete;
+
+   /**
+    * Cierra el canal y detiene la tarea. Los mensajes pendientes no se entregan.
+    */
+   ~RemoteCourier()
+   {
+      if( theChannel.isOpen() )
+      {
+         theChannel.close();
+         theDispatcher.join();
+      }
+   }
+
+   /**
+    * Indica si el canal es utilizable.
+    */
+   bool isOpen() const
+   {
+      return theChannel.isOpen();
+   }
+
+private:
+
+   using Destination = std::remove_reference_t<T>;
+
+   using Handler = void ( * )( Destination&, const void* );
+
+   /**
+    * Entrega al destinatario el mensaje de tipo M de la dirección <i>aPayload</i>.
+    */
+   template<typename M>
+   static void receiveAs( Destination& aDestination, const void* aPayload )
+   {
+      aDestination.receive( *static_cast<const M*>( aPayload ) );
+   }
+
+   /**
+    * Tarea encargada de entregar los mensajes hasta que se cierre el canal.
+    */
+   void dispatcher()
+   {
+      static constexpr Handler theHandlers[] = { &receiveAs<Messages>... };
+      while( theChannel.receive( [this]( std::uint32_t aType, const void* aPayload ) {
+                                    theHandlers[aType]( theDestination, aPayload );
+                                 } ) )
+      {
+      }
+   }
+
+   /**
+    * El canal por el que llegan los mensajes.
+    */
+   Channel theChannel;
+
+   /**
+    * El destinatario de los mensajes.
+    */
+   T theDestination;
+
+   /**
+    * La tarea que entrega los mensajes.
+    */
+   std::thread theDispatcher;
+};
+
+#endif
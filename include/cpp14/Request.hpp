@@ -0,0 +1,462 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2020 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_REQUEST_HPP_
+#define INCLUDE_GENERIC_PATTERNS_REQUEST_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Deliverable.hpp"
+#include "SafeQueue.hpp"
+
+/**
+ * @brief Estado de una respuesta.
+ *
+ * La clase ReplyState indica si la respuesta de una petición está lista y permite esperarla, ya
+ * sea bloqueando la tarea o suspendiendo una corrutina. No reserva memoria: la tarea que espera lo
+ * hace activamente un momento y después se duerme en una condición propia, que la respuesta solo
+ * señala si hay alguien dormido. En lugar de la respuesta puede guardar la excepción que lanzó el
+ * destinatario.
+ */
+class ReplyState
+{
+public:
+
+   ReplyState() = default;
+
+   ReplyState( const ReplyState& ) = delete;
+
+   ReplyState& operator=( const ReplyState& ) = delete;
+
+   /**
+    * Indica si la respuesta está lista.
+    */
+   bool isReady() const
+   {
+      return theState.load( std::memory_order_acquire ) == theReady;
+   }
+
+   /**
+    * Bloquea la tarea actual hasta que la respuesta esté lista.
+    */
+   void wait() const
+   {
+      if( spin() )
+      {
+         return;
+      }
+
+      std::unique_lock<std::mutex> aLock( theMutex );
+      theSleepers.fetch_add( 1 );
+      theCondition.wait( aLock, [this] { return theState.load() == theReady; } );
+      theSleepers.fetch_sub( 1 );
+   }
+
+   /**
+    * Bloquea la tarea actual hasta que la respuesta esté lista o llegue el instante
+    * <i>aDeadline</i>. Indica si la respuesta está lista.
+    */
+   bool waitUntil( std::chrono::steady_clock::time_point aDeadline ) const
+   {
+      if( spin() )
+      {
+         return true;
+      }
+
+      std::unique_lock<std::mutex> aLock( theMutex );
+      theSleepers.fetch_add( 1 );
+      const bool isDone = theCondition.wait_until( aLock, aDeadline, [this] { return theState.load() == theReady; } );
+      theSleepers.fetch_sub( 1 );
+      return isDone;
+   }
+
+   /**
+    * Registra la continuación <i>aResume</i>, que se invocará con <i>anAddress</i> cuando la
+    * respuesta esté lista. Devuelve falso, sin registrarla, si ya lo está.
+    */
+   bool suspend( void* anAddress, void ( *aResume )( void* ) )
+   {
+      theContinuation = anAddress;
+      theResume = aResume;
+      int anExpected = theEmpty;
+      return theState.compare_exchange_strong( anExpected, theSuspended, std::memory_order_acq_rel );
+   }
+
+   /**
+    * Guarda la excepción <i>anError</i> en lugar de la respuesta y la marca como lista.
+    */
+   void fail( std::exception_ptr anError )
+   {
+      theError = std::move( anError );
+      complete();
+   }
+
+protected:
+
+   /**
+    * Indica si en lugar de la respuesta se guardó una excepción. Solo tiene sentido si la
+    * respuesta está lista.
+    */
+   bool isFailed() const
+   {
+      return theError != nullptr;
+   }
+
+   /**
+    * Lanza la excepción guardada, si la hay. Solo tiene sentido si la respuesta está lista.
+    */
+   void rethrow() const
+   {
+      if( theError )
+      {
+         std::rethrow_exception( theError );
+      }
+   }
+
+   /**
+    * Marca la respuesta como lista, despierta a las tareas dormidas y reanuda la continuación.
+    */
+   void complete()
+   {
+      const int aPrevious = theState.exchange( theReady );
+      if( theSleepers.load() != 0 )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         aLock.unlock();
+         theCondition.notify_all();
+      }
+
+      if( aPrevious == theSuspended )
+      {
+         theResume( theContinuation );
+      }
+   }
+
+private:
+
+   /**
+    * Espera activamente un momento. Indica si la respuesta está lista.
+    */
+   bool spin() const
+   {
+      for( int i = 0; i < theSpinCount; ++i )
+      {
+         if( isReady() )
+         {
+            return true;
+         }
+
+         relaxProcessor();
+      }
+
+      return false;
+   }
+
+   static constexpr int theEmpty = 0;
+
+   static constexpr int theSuspended = 1;
+
+   static constexpr int theReady = 2;
+
+   /**
+    * Número de vueltas que la tarea espera antes de dormirse.
+    */
+   static constexpr int theSpinCount = 1000;
+
+   /**
+    * Vacía, con una continuación registrada o lista.
+    */
+   std::atomic<int> theState{ theEmpty };
+
+   /**
+    * Número de tareas dormidas.
+    */
+   mutable std::atomic<int> theSleepers{};
+
+   /**
+    * La dirección que recibe la continuación.
+    */
+   void* theContinuation{};
+
+   /**
+    * La continuación.
+    */
+   void ( *theResume )( void* ){};
+
+   /**
+    * La excepción que lanzó el destinatario en lugar de responder.
+    */
+   std::exception_ptr theError;
+
+   mutable std::mutex theMutex;
+
+   mutable std::condition_variable theCondition;
+};
+
+/**
+ * @brief Hueco para la respuesta de tipo R de una petición.
+ */
+template<typename R>
+class ReplySlot : public ReplyState
+{
+public:
+
+   ReplySlot() = default;
+
+   ~ReplySlot()
+   {
+      if( isReady() && !isFailed() )
+      {
+         value().~R();
+      }
+   }
+
+   /**
+    * Guarda la respuesta <i>aValue</i> y la marca como lista.
+    */
+   void set( R&& aValue )
+   {
+      new( &theStorage ) R( std::move( aValue ) );
+      complete();
+   }
+
+   /**
+    * Espera la respuesta y la devuelve, o lanza la excepción del destinatario. Solo puede
+    * invocarse una vez.
+    */
+   R get()
+   {
+      wait();
+      rethrow();
+      return std::move( value() );
+   }
+
+private:
+
+   R& value()
+   {
+      return *reinterpret_cast<R*>( &theStorage );
+   }
+
+   /**
+    * El búfer en el que se construye la respuesta.
+    */
+   std::aligned_storage_t<sizeof( R ), alignof( R )> theStorage;
+};
+
+/**
+ * @brief Hueco para una petición sin respuesta, que solo indica que se ha tratado.
+ */
+template<>
+class ReplySlot<void> : public ReplyState
+{
+public:
+
+   /**
+    * Marca la petición como tratada.
+    */
+   void set()
+   {
+      complete();
+   }
+
+   /**
+    * Espera a que se trate la petición y lanza la excepción del destinatario, si la hubo.
+    */
+   void get()
+   {
+      wait();
+      rethrow();
+   }
+};
+
+// Declaración adelantada.
+template<typename R>
+class ReplyFuture;
+
+/**
+ * @brief Interfaz para las peticiones entregables que esperan una respuesta.
+ *
+ * La plantilla Request es un Deliverable cuya función reply devuelve la respuesta del
+ * destinatario de tipo T, de tipo R. La respuesta se guarda en un hueco dentro de la propia
+ * petición, por lo que obtenerla no reserva memoria: el ReplyFuture que devuelve
+ * Courier::deliverWithReply comparte la propiedad de la petición.
+ *
+ * @code
+ * class Price : public Request<Shop&, int>
+ * {
+ * public:
+ *    int reply( Shop& aShop ) const override { return aShop.receive( *this ); }
+ * };
+ * @endcode
+ *
+ * Si reply lanza una excepción, esta no sale de la tarea del mensajero: se guarda en el hueco y
+ * la relanza ReplyFuture::get. Cada petición solo puede enviarse una vez.
+ */
+template<typename T, typename R>
+class Request : public Deliverable<T>
+{
+public:
+
+   using ReplyType = R;
+
+   virtual R reply( T aDestination ) const = 0;
+
+   void deliver( T aDestination ) const override
+   {
+      complete( std::is_void<R>(), std::forward<T>( aDestination ) );
+   }
+
+private:
+
+   template<typename> friend class ReplyFuture;
+
+   void complete( std::false_type, T aDestination ) const
+   {
+      try
+      {
+         theSlot.set( reply( std::forward<T>( aDestination ) ) );
+      }
+      catch( ... )
+      {
+         theSlot.fail( std::current_exception() );
+      }
+   }
+
+   void complete( std::true_type, T aDestination ) const
+   {
+      try
+      {
+         reply( std::forward<T>( aDestination ) );
+      }
+      catch( ... )
+      {
+         theSlot.fail( std::current_exception() );
+         return;
+      }
+
+      theSlot.set();
+   }
+
+   /**
+    * El hueco de la respuesta.
+    */
+   mutable ReplySlot<R> theSlot;
+};
+
+/**
+ * @brief Respuesta futura a una petición.
+ *
+ * La plantilla ReplyFuture permite esperar la respuesta de tipo R a una petición enviada con
+ * Courier::deliverWithReply, bloqueando la tarea con ReplyFuture::get o, en C++20, suspendiendo
+ * una corrutina:
+ *
+ * @code
+ * int aPrice = co_await aCourier.deliverWithReply<int>( std::make_shared<Price>() );
+ * @endcode
+ *
+ * Las funciones que la hacen esperable no dependen de la cabecera <coroutine>, por lo que la
+ * plantilla puede usarse igual en C++14. La corrutina se reanuda en la tarea de la cola del
+ * mensajero, al volver la función reply.
+ */
+template<typename R>
+class ReplyFuture
+{
+public:
+
+   /**
+    * Crea la respuesta futura de la petición <i>aRequest</i>.
+    */
+   template<typename T>
+   explicit ReplyFuture( const std::shared_ptr<Request<T, R>>& aRequest )
+      :
+      theSlot( aRequest, &aRequest->theSlot )
+   {
+
+   }
+
+   /**
+    * Indica si la respuesta está lista.
+    */
+   bool isReady() const
+   {
+      return theSlot->isReady();
+   }
+
+   /**
+    * Bloquea la tarea actual hasta que la respuesta esté lista.
+    */
+   void wait() const
+   {
+      theSlot->wait();
+   }
+
+   /**
+    * Bloquea la tarea actual hasta que la respuesta esté lista o transcurra el tiempo
+    * <i>aTimeout</i>. Indica si la respuesta está lista.
+    */
+   bool waitFor( std::chrono::steady_clock::duration aTimeout ) const
+   {
+      return theSlot->waitUntil( std::chrono::steady_clock::now() + aTimeout );
+   }
+
+   /**
+    * Espera la respuesta y la devuelve, o lanza la excepción de la función reply de la petición.
+    * Solo puede invocarse una vez.
+    */
+   R get()
+   {
+      return theSlot->get();
+   }
+
+   bool await_ready() const
+   {
+      return theSlot->isReady();
+   }
+
+   template<typename Handle>
+   bool await_suspend( Handle aHandle )
+   {
+      return theSlot->suspend( aHandle.address(), &resume<Handle> );
+   }
+
+   R await_resume()
+   {
+      return theSlot->get();
+   }
+
+private:
+
+   /**
+    * Reanuda la corrutina de tipo <i>Handle</i> cuya dirección es <i>anAddress</i>.
+    */
+   template<typename Handle>
+   static void resume( void* anAddress )
+   {
+      Handle::from_address( anAddress ).resume();
+   }
+
+   /**
+    * El hueco de la respuesta, que comparte la propiedad de la petición.
+    */
+   std::shared_ptr<ReplySlot<R>> theSlot;
+};
+
+#endif
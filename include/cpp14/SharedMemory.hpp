@@ -0,0 +1,526 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2020 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_SHARED_MEMORY_HPP_
+#define INCLUDE_GENERIC_PATTERNS_SHARED_MEMORY_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../common/StateTraits.hpp"
+#include "SafeQueue.hpp"
+
+/**
+ * @brief Memoria compartida entre procesos.
+ *
+ * La clase SharedMemory proyecta en memoria un segmento compartido: uno con nombre, creado con
+ * shm_open, que otros procesos pueden abrir por su nombre, o uno anónimo, creado con memfd_create,
+ * cuyo descriptor heredan los procesos hijos o se pasa por un socket local. El segmento se libera
+ * al destruir el objeto; el nombre, solo si el objeto lo creó.
+ *
+ * Si no se puede crear o abrir el segmento, SharedMemory::isOpen devuelve falso.
+ */
+class SharedMemory
+{
+public:
+
+   /**
+    * Crea el segmento con nombre <i>aName</i>, que debe empezar por '/', y tamaño <i>aSize</i>.
+    * Falla si ya existe.
+    */
+   SharedMemory( const char* aName, std::size_t aSize )
+   {
+      const int aDescriptor = ::shm_open( aName, O_CREAT | O_EXCL | O_RDWR, 0600 );
+      if( aDescriptor < 0 )
+      {
+         return;
+      }
+
+      if( ::ftruncate( aDescriptor, static_cast<off_t>( aSize ) ) == 0 )
+      {
+         map( aDescriptor, aSize );
+      }
+
+      ::close( aDescriptor );
+      if( isOpen() )
+      {
+         theName = aName;
+      }
+      else
+      {
+         ::shm_unlink( aName );
+      }
+   }
+
+   /**
+    * Abre el segmento con nombre <i>aName</i> creado por otro objeto.
+    */
+   explicit SharedMemory( const char* aName )
+   {
+      const int aDescriptor = ::shm_open( aName, O_RDWR, 0 );
+      if( aDescriptor >= 0 )
+      {
+         mapAll( aDescriptor );
+         ::close( aDescriptor );
+      }
+   }
+
+   /**
+    * Proyecta el segmento del descriptor <i>aDescriptor</i>, que sigue siendo del llamante.
+    */
+   explicit SharedMemory( int aDescriptor )
+   {
+      mapAll( aDescriptor );
+   }
+
+   SharedMemory( SharedMemory&& anOther )
+      :
+      theData{ anOther.theData },
+      theSize{ anOther.theSize },
+      theName{ std::move( anOther.theName ) }
+   {
+      anOther.theData = nullptr;
+      anOther.theSize = 0;
+      anOther.theName.clear();
+   }
+
+   SharedMemory( const SharedMemory& ) = delete;
+
+   SharedMemory& operator=( const SharedMemory& ) = delete;
+
+   ~SharedMemory()
+   {
+      if( theData )
+      {
+         ::munmap( theData, theSize );
+      }
+
+      if( !theName.empty() )
+      {
+         ::shm_unlink( theName.c_str() );
+      }
+   }
+
+   /**
+    * Crea un segmento anónimo de tamaño <i>aSize</i> y devuelve su descriptor, o -1 si falla.
+    */
+   static int createAnonymous( std::size_t aSize )
+   {
+      const int aDescriptor = ::memfd_create( "generic-patterns", MFD_CLOEXEC );
+      if( aDescriptor >= 0 && ::ftruncate( aDescriptor, static_cast<off_t>( aSize ) ) != 0 )
+      {
+         ::close( aDescriptor );
+         return -1;
+      }
+
+      return aDescriptor;
+   }
+
+   /**
+    * Indica si el segmento está proyectado.
+    */
+   bool isOpen() const
+   {
+      return theData != nullptr;
+   }
+
+   /**
+    * Devuelve la dirección del segmento.
+    */
+   void* data() const
+   {
+      return theData;
+   }
+
+   /**
+    * Devuelve el tamaño del segmento.
+    */
+   std::size_t size() const
+   {
+      return theSize;
+   }
+
+private:
+
+   /**
+    * Proyecta <i>aSize</i> bytes del descriptor <i>aDescriptor</i>.
+    */
+   void map( int aDescriptor, std::size_t aSize )
+   {
+      void* aData = ::mmap( nullptr, aSize, PROT_READ | PROT_WRITE, MAP_SHARED, aDescriptor, 0 );
+      if( aData != MAP_FAILED )
+      {
+         theData = aData;
+         theSize = aSize;
+      }
+   }
+
+   /**
+    * Proyecta el segmento completo del descriptor <i>aDescriptor</i>.
+    */
+   void mapAll( int aDescriptor )
+   {
+      struct stat aStatus;
+      if( ::fstat( aDescriptor, &aStatus ) == 0 && aStatus.st_size > 0 )
+      {
+         map( aDescriptor, static_cast<std::size_t>( aStatus.st_size ) );
+      }
+   }
+
+   /**
+    * La dirección del segmento proyectado.
+    */
+   void* theData{};
+
+   /**
+    * El tamaño del segmento proyectado.
+    */
+   std::size_t theSize{};
+
+   /**
+    * El nombre del segmento si lo creó este objeto. Se copia porque el del llamante puede no
+    * sobrevivir al objeto.
+    */
+   std::string theName;
+};
+
+/**
+ * @brief Canal de mensajes entre procesos sobre memoria compartida.
+ *
+ * La clase SharedChannel organiza un segmento de memoria compartida como un búfer circular de
+ * registros de tamaño fijo, cada uno con uno de los mensajes <i>Messages</i>, que deben copiarse
+ * trivialmente porque sus bytes cruzan entre procesos. Cualquier número de procesos y tareas
+ * puede enviar mensajes, pero solo una tarea puede recibirlos.
+ *
+ * Los remitentes reservan los registros con una operación atómica sobre la posición final y los
+ * publican con el número de secuencia de cada registro; el receptor trata cada mensaje en el
+ * propio registro, sin copiarlo. Cuando el canal está vacío, el receptor espera activamente un
+ * momento y después se duerme en un futex compartido, y los remitentes solo hacen la llamada al
+ * sistema que lo despierta si está dormido.
+ *
+ * El canal solo guarda posiciones y números de secuencia, nunca punteros, por lo que cada proceso
+ * puede proyectar el segmento en una dirección distinta. Los procesos deben compilarse con la
+ * misma lista de mensajes: la cabecera guarda una huella del nombre, el tamaño y el alineamiento
+ * de cada mensaje, en orden, y el canal no se abre si no coincide con la propia.
+ */
+template<typename... Messages>
+class SharedChannel
+{
+public:
+
+   static_assert( AllOf<std::is_trivially_copyable<Messages>::value...>::value,
+                  "SharedChannel: messages must be trivially copyable" );
+
+   /**
+    * Devuelve el tamaño del segmento necesario para <i>aCapacity</i> registros, que debe ser una
+    * potencia de dos.
+    */
+   static constexpr std::size_t sizeFor( std::size_t aCapacity )
+   {
+      return sizeof( Header ) + aCapacity * sizeof( Record );
+   }
+
+   /**
+    * Usa como canal el segmento <i>aMemory</i>. Si <i>aCapacity</i> no es cero, inicializa el
+    * canal con esa capacidad, que debe caber en el segmento; si es cero, el canal ya debe estar
+    * inicializado por otro proceso.
+    */
+   explicit SharedChannel( SharedMemory&& aMemory, std::uint32_t aCapacity = 0 )
+      :
+      theMemory{ std::move( aMemory ) }
+   {
+      if( !theMemory.isOpen() )
+      {
+         return;
+      }
+
+      if( aCapacity != 0 )
+      {
+         if( ( aCapacity & ( aCapacity - 1 ) ) != 0 || sizeFor( aCapacity ) > theMemory.size() )
+         {
+            return;
+         }
+
+         Header* aHeader = new( theMemory.data() ) Header{};
+         for( std::uint32_t i = 0; i < aCapacity; ++i )
+         {
+            new( &records( aHeader )[i] ) Record{};
+            records( aHeader )[i].theSequence.store( i, std::memory_order_relaxed );
+         }
+
+         aHeader->theRecordSize = sizeof( Record );
+         aHeader->theMessageCount = sizeof...( Messages );
+         aHeader->theCapacity = aCapacity;
+         aHeader->theFingerprint = fingerprint();
+         aHeader->theFormat.store( theFormat, std::memory_order_release );
+      }
+
+      Header* aHeader = static_cast<Header*>( theMemory.data() );
+      if( theMemory.size() >= sizeof( Header ) && aHeader->theFormat.load( std::memory_order_acquire ) == theFormat &&
+          aHeader->theRecordSize == sizeof( Record ) && aHeader->theMessageCount == sizeof...( Messages ) &&
+          aHeader->theFingerprint == fingerprint() && sizeFor( aHeader->theCapacity ) <= theMemory.size() )
+      {
+         theHeader = aHeader;
+         theMask = aHeader->theCapacity - 1;
+      }
+   }
+
+   /**
+    * Indica si el canal es utilizable.
+    */
+   bool isOpen() const
+   {
+      return theHeader != nullptr;
+   }
+
+   /**
+    * Envía el mensaje <i>aMessage</i>. Si el canal está lleno, devuelve falso sin enviarlo.
+    */
+   template<typename M>
+   bool trySend( const M& aMessage )
+   {
+      static_assert( TupleIndex<M, std::tuple<Messages...>>::value < sizeof...( Messages ),
+                     "SharedChannel: M is not one of the messages" );
+      std::uint64_t aPosition = theHeader->theTail.load( std::memory_order_relaxed );
+      for( ;; )
+      {
+         Record& aRecord = records( theHeader )[aPosition & theMask];
+         const std::uint64_t aSequence = aRecord.theSequence.load( std::memory_order_acquire );
+         const std::int64_t aDifference = static_cast<std::int64_t>( aSequence - aPosition );
+         if( aDifference == 0 )
+         {
+            if( theHeader->theTail.compare_exchange_weak( aPosition, aPosition + 1, std::memory_order_relaxed ) )
+            {
+               aRecord.theType = static_cast<std::uint32_t>( TupleIndex<M, std::tuple<Messages...>>::value );
+               new( &aRecord.thePayload ) M( aMessage );
+
+               // El orden secuencial de las dos operaciones garantiza que el remitente ve dormido
+               // al receptor o que el receptor ve el registro antes de dormirse.
+               aRecord.theSequence.store( aPosition + 1 );
+               if( theHeader->theSleeping.load() != 0 )
+               {
+                  wake();
+               }
+
+               return true;
+            }
+         }
+         else if( aDifference < 0 )
+         {
+            return false;
+         }
+         else
+         {
+            aPosition = theHeader->theTail.load( std::memory_order_relaxed );
+         }
+      }
+   }
+
+   /**
+    * Envía el mensaje <i>aMessage</i>. Si el canal está lleno, cede el procesador hasta que haya
+    * sitio. Devuelve falso si el canal se ha cerrado.
+    */
+   template<typename M>
+   bool send( const M& aMessage )
+   {
+      while( !trySend( aMessage ) )
+      {
+         if( theHeader->theClosed.load( std::memory_order_relaxed ) != 0 )
+         {
+            return false;
+         }
+
+         std::this_thread::yield();
+      }
+
+      return true;
+   }
+
+   /**
+    * Espera el siguiente mensaje y lo entrega a <i>aHandler</i> junto con su posición en la lista
+    * de mensajes y la dirección de sus bytes, que solo son válidos durante la llamada. Devuelve
+    * falso si el canal se ha cerrado. Solo una tarea puede invocar a esta función.
+    */
+   template<typename Handler>
+   bool receive( Handler&& aHandler )
+   {
+      const std::uint64_t aPosition = theHeader->theHead.load( std::memory_order_relaxed );
+      Record& aRecord = records( theHeader )[aPosition & theMask];
+      if( !waitRecord( aRecord, aPosition ) )
+      {
+         return false;
+      }
+
+      aHandler( aRecord.theType, static_cast<const void*>( &aRecord.thePayload ) );
+      aRecord.theSequence.store( aPosition + theMask + 1, std::memory_order_release );
+      theHeader->theHead.store( aPosition + 1, std::memory_order_relaxed );
+      return true;
+   }
+
+   /**
+    * Cierra el canal y despierta al receptor.
+    */
+   void close()
+   {
+      theHeader->theClosed.store( 1 );
+      wake();
+   }
+
+private:
+
+   static constexpr std::uint32_t theFormat = 0x4C4E4843; // "CHNL"
+
+   /**
+    * Número de vueltas que el receptor espera activamente antes de dormirse.
+    */
+   static constexpr int theSpinCount = 4000;
+
+   /**
+    * La cabecera del segmento. Los campos que escriben los remitentes y el receptor están en
+    * líneas de caché distintas.
+    */
+   struct Header
+   {
+      std::atomic<std::uint32_t> theFormat;
+      std::uint32_t theRecordSize;
+      std::uint32_t theMessageCount;
+      std::uint32_t theCapacity;
+      std::uint64_t theFingerprint;
+      alignas( 64 ) std::atomic<std::uint64_t> theTail;
+      alignas( 64 ) std::atomic<std::uint64_t> theHead;
+      alignas( 64 ) std::atomic<std::uint32_t> theSleeping;
+      std::atomic<std::uint32_t> theFutex;
+      std::atomic<std::uint32_t> theClosed;
+   };
+
+   /**
+    * Un registro del búfer.
+    */
+   struct Record
+   {
+      std::atomic<std::uint64_t> theSequence;
+      std::uint32_t theType;
+      alignas( Messages... ) unsigned char thePayload[std::max( { sizeof( Messages )... } )];
+   };
+
+   static_assert( ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+                  "SharedChannel: shared atomics must be lock free" );
+
+   /**
+    * Devuelve la huella de la lista de mensajes: un resumen FNV-1a del nombre decorado, el tamaño
+    * y el alineamiento de cada mensaje, en orden. Distingue listas con los mismos tamaños en otro
+    * orden o con otros tipos.
+    */
+   static std::uint64_t fingerprint()
+   {
+      static const std::uint64_t theFingerprint = [] {
+         const char* const aNames[] = { typeid( Messages ).name()... };
+         const std::size_t aSizes[] = { sizeof( Messages )... };
+         const std::size_t anAlignments[] = { alignof( Messages )... };
+         std::uint64_t aHash = 14695981039346656037u;
+         const auto aMix = [&aHash]( std::uint64_t aValue ) { aHash = ( aHash ^ aValue ) * 1099511628211u; };
+         for( std::size_t i = 0; i < sizeof...( Messages ); ++i )
+         {
+            for( const char* aCharacter = aNames[i]; *aCharacter != '\0'; ++aCharacter )
+            {
+               aMix( static_cast<unsigned char>( *aCharacter ) );
+            }
+
+            aMix( 0 );
+            aMix( aSizes[i] );
+            aMix( anAlignments[i] );
+         }
+
+         return aHash;
+      }();
+
+      return theFingerprint;
+   }
+
+   static Record* records( Header* aHeader )
+   {
+      return reinterpret_cast<Record*>( reinterpret_cast<unsigned char*>( aHeader ) + sizeof( Header ) );
+   }
+
+   /**
+    * Espera a que se publique el registro <i>aRecord</i> de la posición <i>aPosition</i>. Devuelve
+    * falso si el canal se cierra.
+    */
+   bool waitRecord( Record& aRecord, std::uint64_t aPosition )
+   {
+      for( int i = 0; aRecord.theSequence.load( std::memory_order_acquire ) != aPosition + 1; ++i )
+      {
+         if( theHeader->theClosed.load( std::memory_order_relaxed ) != 0 )
+         {
+            return false;
+         }
+
+         if( i < theSpinCount )
+         {
+            relaxProcessor();
+            continue;
+         }
+
+         const std::uint32_t anEpoch = theHeader->theFutex.load();
+         theHeader->theSleeping.store( 1 );
+         if( aRecord.theSequence.load() != aPosition + 1 && theHeader->theClosed.load() == 0 )
+         {
+            ::syscall( SYS_futex, &theHeader->theFutex, FUTEX_WAIT, anEpoch, nullptr, nullptr, 0 );
+         }
+
+         theHeader->theSleeping.store( 0, std::memory_order_relaxed );
+         i = 0;
+      }
+
+      return true;
+   }
+
+   /**
+    * Despierta al receptor.
+    */
+   void wake()
+   {
+      theHeader->theFutex.fetch_add( 1 );
+      ::syscall( SYS_futex, &theHeader->theFutex, FUTEX_WAKE, 1, nullptr, nullptr, 0 );
+   }
+
+   /**
+    * El segmento proyectado.
+    */
+   SharedMemory theMemory;
+
+   /**
+    * La cabecera del canal, o nullptr si el segmento no es un canal válido.
+    */
+   Header* theHeader{};
+
+   /**
+    * La máscara que convierte una posición en un índice del búfer.
+    */
+   std::uint64_t theMask{};
+};
+
+#endif
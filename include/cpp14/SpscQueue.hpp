@@ -0,0 +1,366 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_SPSC_QUEUE_HPP_
+#define INCLUDE_GENERIC_PATTERNS_SPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Una cola para un único productor y un único consumidor.
+ *
+ * La clase SpscQueue tiene la misma interfaz que SafeQueue, pero solo admite una tarea que añade
+ * elementos y otra que los lee. A cambio, no usa mútex mientras hay elementos: es un búfer
+ * circular de capacidad fija en el que el productor solo escribe la posición final y el consumidor
+ * solo la inicial, cada una en su propia línea de caché, y cada tarea guarda una copia de la
+ * posición de la otra que solo relee cuando el búfer parece lleno o vacío. Ninguna operación
+ * atómica de lectura y escritura interviene en la inserción ni en la extracción.
+ *
+ * Cuando la cola está vacía, el consumidor espera un momento activamente y después se duerme; el
+ * productor solo lo despierta, con la consiguiente llamada al sistema, si está dormido. Cuando la
+ * cola está llena, el productor cede el procesador hasta que haya sitio.
+ */
+template<typename T>
+class SpscQueue
+{
+public:
+
+   /**
+    * Crea la cola con capacidad para, al menos, <i>aCapacity</i> elementos.
+    */
+   explicit SpscQueue( std::size_t aCapacity = 1024 )
+      :
+      theMask{ roundUp( aCapacity ) - 1 },
+      theSlots{ new Slot[theMask + 1] }
+   {
+
+   }
+
+   SpscQueue( const SpscQueue& ) = delete;
+
+   SpscQueue& operator=( const SpscQueue& ) = delete;
+
+   ~SpscQueue()
+   {
+      for( std::size_t i = theConsumer.theHead.load(); i != theProducer.theTail.load(); ++i )
+      {
+         element( i ).~T();
+      }
+   }
+
+   /**
+    * Añade el elemento <i>aData</i> a la cola.
+    */
+   void push( const T& aData )
+   {
+      emplace( T( aData ) );
+   }
+
+   /**
+    * Construye y añade el elemento <i>aData</i> a la cola. Si está llena, espera a que haya sitio.
+    */
+   void emplace( T&& aData )
+   {
+      const std::size_t aTail = theProducer.theTail.load( std::memory_order_relaxed );
+      while( aTail - theProducer.theHeadCache > theMask )
+      {
+         theProducer.theHeadCache = theConsumer.theHead.load( std::memory_order_acquire );
+         if( aTail - theProducer.theHeadCache > theMask )
+         {
+            if( theStopped.load( std::memory_order_relaxed ) )
+            {
+               return;
+            }
+
+            std::this_thread::yield();
+         }
+      }
+
+      new( &theSlots[aTail & theMask] ) T( std::move( aData ) );
+      // El orden secuencial de las dos operaciones garantiza que el productor ve dormido al
+      // consumidor o que el consumidor ve el nuevo elemento antes de dormirse.
+      theProducer.theTail.store( aTail + 1 );
+      if( theSleeping.load() )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         aLock.unlock();
+         theReadCondition.notify_one();
+      }
+   }
+
+   /**
+    * Devuelve el primer elemento de la cola, es decir, el primero que se añadió. Si la cola está
+    * vacía, bloquea la tarea actual hasta que haya algún elemento.
+    */
+   T front()
+   {
+      return wait() ? element( theConsumer.theHead.load( std::memory_order_relaxed ) ) : T{};
+   }
+
+   /**
+    * Elimina el primero elemento de la cola, es decir, el primero que se añadió. Si la cola está
+    * vacía, bloquea la tarea actual hasta que haya algún elemento.
+    */
+   void pop()
+   {
+      if( wait() )
+      {
+         const std::size_t aHead = theConsumer.theHead.load( std::memory_order_relaxed );
+         element( aHead ).~T();
+         theConsumer.theHead.store( aHead + 1, std::memory_order_release );
+      }
+   }
+
+   /**
+    * Extrae el primer elemento de la cola y lo deja en <i>aData</i>. Si la cola está vacía,
+    * bloquea la tarea actual hasta que haya algún elemento. Devuelve falso si la cola se ha
+    * detenido o si se ha interrumpido la espera.
+    */
+   bool pop( T& aData )
+   {
+      return take( aData, wait( true, std::chrono::steady_clock::time_point::max() ) );
+   }
+
+   /**
+    * Igual que la función anterior, pero espera como mucho hasta el instante <i>aDeadline</i>.
+    * Devuelve falso también si llega ese instante sin ningún elemento.
+    */
+   bool pop( T& aData, std::chrono::steady_clock::time_point aDeadline )
+   {
+      return take( aData, wait( true, aDeadline ) );
+   }
+
+   /**
+    * Interrumpe la espera en curso, o la próxima, de la función pop que extrae un elemento, que
+    * devuelve falso si no hay ninguno. Puede invocarse desde cualquier tarea.
+    */
+   void interrupt()
+   {
+      theInterrupted.store( true );
+      std::unique_lock<std::mutex> aLock( theMutex );
+      aLock.unlock();
+      theReadCondition.notify_all();
+   }
+
+   /**
+    * Indica si la cola está vacía.
+    */
+   bool empty() const
+   {
+      return size() == 0;
+   }
+
+   /**
+    * Devuelve el tamaño actual de la cola.
+    */
+   std::size_t size() const
+   {
+      const std::size_t aHead = theConsumer.theHead.load( std::memory_order_acquire );
+      return theProducer.theTail.load( std::memory_order_acquire ) - aHead;
+   }
+
+   /**
+    * Se fuerza la salida de las condiciones de espera porque se va a destruir la cola.
+    */
+   void stop()
+   {
+      theStopped.store( true );
+      std::unique_lock<std::mutex> aLock( theMutex );
+      aLock.unlock();
+      theReadCondition.notify_all();
+   }
+
+private:
+
+   /**
+    * Número de vueltas que el consumidor espera activamente antes de dormirse.
+    */
+   static constexpr int theSpinCount = 256;
+
+   /**
+    * Tamaño supuesto de una línea de caché.
+    */
+   static constexpr std::size_t theCacheLine = 64;
+
+   /**
+    * Una posición del búfer.
+    */
+   using Slot = std::aligned_storage_t<sizeof( T ), alignof( T )>;
+
+   /**
+    * Espera a que haya algún elemento, hasta el instante <i>aDeadline</i> y, si
+    * <i>anInterruptible</i> es cierto, hasta que se interrumpa la espera. Devuelve falso si no hay
+    * ningún elemento o si la cola se ha detenido.
+    */
+   bool wait( bool anInterruptible = false,
+              std::chrono::steady_clock::time_point aDeadline = std::chrono::steady_clock::time_point::max() )
+   {
+      const std::size_t aHead = theConsumer.theHead.load( std::memory_order_relaxed );
+      if( aHead != theConsumer.theTailCache )
+      {
+         return !theStopped.load( std::memory_order_relaxed );
+      }
+
+      auto aReady = [this, aHead, anInterruptible] {
+         return isReadable( aHead ) || theStopped.load( std::memory_order_relaxed ) ||
+                ( anInterruptible && theInterrupted.load( std::memory_order_relaxed ) );
+      };
+
+      for( int i = 0; i < theSpinCount; ++i )
+      {
+         if( aReady() )
+         {
+            return aHead != theConsumer.theTailCache && !theStopped.load( std::memory_order_relaxed );
+         }
+      }
+
+      std::unique_lock<std::mutex> aLock( theMutex );
+      theSleeping.store( true );
+      if( aDeadline == std::chrono::steady_clock::time_point::max() )
+      {
+         theReadCondition.wait( aLock, aReady );
+      }
+      else
+      {
+         theReadCondition.wait_until( aLock, aDeadline, aReady );
+      }
+
+      theSleeping.store( false, std::memory_order_relaxed );
+      return aHead != theConsumer.theTailCache && !theStopped.load( std::memory_order_relaxed );
+   }
+
+   /**
+    * Extrae el primer elemento en <i>aData</i> si <i>aReadable</i> es cierto y, si no, anula la
+    * interrupción.
+    */
+   bool take( T& aData, bool aReadable )
+   {
+      if( !aReadable )
+      {
+         theInterrupted.store( false, std::memory_order_relaxed );
+         return false;
+      }
+
+      const std::size_t aHead = theConsumer.theHead.load( std::memory_order_relaxed );
+      aData = std::move( element( aHead ) );
+      element( aHead ).~T();
+      theConsumer.theHead.store( aHead + 1, std::memory_order_release );
+      return true;
+   }
+
+   /**
+    * Relee la posición final y indica si hay elementos a partir de <i>aHead</i>.
+    */
+   bool isReadable( std::size_t aHead )
+   {
+      theConsumer.theTailCache = theProducer.theTail.load();
+      return aHead != theConsumer.theTailCache;
+   }
+
+   /**
+    * Devuelve el elemento de la posición <i>anIndex</i>.
+    */
+   T& element( std::size_t anIndex )
+   {
+      return *reinterpret_cast<T*>( &theSlots[anIndex & theMask] );
+   }
+
+   /**
+    * Devuelve la menor potencia de dos mayor o igual que <i>aCapacity</i>.
+    */
+   static std::size_t roundUp( std::size_t aCapacity )
+   {
+      std::size_t aPower = 1;
+      while( aPower < aCapacity )
+      {
+         aPower <<= 1;
+      }
+
+      return aPower;
+   }
+
+   /**
+    * Los datos que escribe el productor.
+    */
+   struct Producer
+   {
+      std::atomic<std::size_t> theTail{};
+      std::size_t theHeadCache{};
+   };
+
+   /**
+    * Los datos que escribe el consumidor.
+    */
+   struct Consumer
+   {
+      std::atomic<std::size_t> theHead{};
+      std::size_t theTailCache{};
+   };
+
+   /**
+    * La máscara que convierte una posición en un índice del búfer.
+    */
+   const std::size_t theMask;
+
+   /**
+    * El búfer circular.
+    */
+   std::unique_ptr<Slot[]> theSlots;
+
+   /**
+    * Los datos del productor y del consumidor ocupan líneas de caché distintas. Se separan con
+    * relleno en lugar de alineamiento porque new no respeta alineamientos mayores que el de
+    * max_align_t en C++14, y AsyncQueue y Courier crean sus colas con new.
+    */
+   char theProducerPadding[theCacheLine];
+   Producer theProducer;
+   char theConsumerPadding[theCacheLine];
+   Consumer theConsumer;
+   char theStatePadding[theCacheLine];
+
+   /**
+    * Indica si el consumidor está dormido o a punto de dormirse.
+    */
+   std::atomic<bool> theSleeping{};
+
+   /**
+    * Indica si la cola se ha detenido.
+    */
+   std::atomic<bool> theStopped{};
+
+   /**
+    * Indica si se ha interrumpido la espera de la función pop que extrae un elemento.
+    */
+   std::atomic<bool> theInterrupted{};
+
+   /**
+    * El mútex usado para dormir al consumidor.
+    */
+   std::mutex theMutex;
+
+   /**
+    * La condición que despierta al consumidor.
+    */
+   std::condition_variable theReadCondition;
+};
+
+#endif
@@ -14,9 +14,17 @@
 #ifndef INCLUDE_GENERIC_PATTERNS_STATE_CONTEXT_HPP_
 #define INCLUDE_GENERIC_PATTERNS_STATE_CONTEXT_HPP_
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
 #include <type_traits>
-#include <boost/variant.hpp>
+#include <utility>
+#include "../common/RunToCompletion.hpp"
+#include "../common/StateSnapshot.hpp"
+#include "SafeQueue.hpp"
 #include "StateExecutor.hpp"
+#include "StateVariant.hpp"
 
 /**
  * @brief Contexto de la máquina de estados.
@@ -46,20 +54,97 @@
  * El contexto tiene disponible la función StateContext::changeState que, como su nombre indica,
  * permite el cambio de estado. Dicha función tiene dos propósitos: especificar el estado inicial,
  * algo que normalmente hará el contexto, y cambiar de un estado a otro, algo que deberían hacer los
- * propios estados.
+ * propios estados. El nuevo estado se copia o se mueve según se pase; para los estados con datos
+ * miembro costosos de copiar, StateContext::emplaceState lo construye directamente en el contexto.
+ *
+ * Las entradas que el estado actual no puede tratar se entregan a la política
+ * <i>UnhandledPolicy</i>, que es además base del contexto. StateContext usa ReportUnhandled, que
+ * informa por la salida de error; para elegir otra, el contexto debe derivar de BasicStateContext:
+ *
+ * @code
+   class Radio : public BasicStateContext<CountUnhandled, Radio, Listening, Receiving, Transmitting>
+   {
+      ...
+   }
+   @endcode
+ *
+ * Las políticas disponibles son IgnoreUnhandled, CountUnhandled, CallbackUnhandled y
+ * RejectUnhandled.
  */
-template<typename Context, typename... States>
-class StateContext
+template<template<typename> class UnhandledPolicy, typename Context, typename... States>
+class BasicStateContext : public UnhandledPolicy<std::tuple<States...>>
 {
 public:
 
    /**
-    * Cambia al estado <i>aState</i>.
+    * Cambia al estado <i>aState</i>, que se copia o se mueve según se pase. Si el estado que se
+    * abandona define la función onExit( Context& ), se llama antes del cambio; si el nuevo estado
+    * define onEnter( Context& ), se llama después. Ambas se resuelven en tiempo de compilación y no
+    * cuestan nada a los estados que no las definen.
     */
    template<typename S>
-   void changeState( const S& aState )
+   void changeState( S&& aState )
+   {
+      emplaceState<std::decay_t<S>>( std::forward<S>( aState ) );
+   }
+
+   /**
+    * Cambia al estado de tipo <i>S</i> construyéndolo en su lugar con los argumentos
+    * <i>aArgs</i>. Las funciones onExit y onEnter se llaman igual que en
+    * StateContext::changeState.
+    */
+   template<typename S, typename... Args>
+   void emplaceState( Args&&... aArgs )
+   {
+      exitState();
+      theState.template emplace<S>( std::forward<Args>( aArgs )... );
+      enterState<S>();
+   }
+
+   /**
+    * El tipo de las instantáneas de la máquina.
+    */
+   using Snapshot = StateSnapshot<States...>;
+
+   /**
+    * Guarda en <i>aSnapshot</i> el estado actual. Los estados deben copiarse trivialmente.
+    */
+   void snapshot( Snapshot& aSnapshot ) const
+   {
+      static_assert( AllOf<std::is_trivially_copyable<States>::value...>::value,
+                     "StateContext: states must be trivially copyable to take snapshots" );
+      static constexpr Save theSaves[] = { &saveState<States>... };
+      aSnapshot.theIndex = static_cast<std::uint32_t>( theState.index() );
+      theSaves[theState.index()]( aSnapshot.thePayload, theState );
+   }
+
+   /**
+    * Recupera el estado guardado en <i>aSnapshot</i>, sin llamar a las funciones onExit ni
+    * onEnter. Devuelve false, sin cambiar de estado, si la instantánea no es válida.
+    */
+   bool restore( const Snapshot& aSnapshot )
+   {
+      if( aSnapshot.theIndex >= sizeof...( States ) )
+      {
+         return false;
+      }
+
+      static constexpr Load theLoads[] = { &loadState<States>... };
+      theLoads[aSnapshot.theIndex]( theState, aSnapshot.thePayload );
+      theEntered = true;
+      return true;
+   }
+
+   /**
+    * Encola la entrada <i>anInput</i> para tratarla en cuanto termine la entrada en curso. Es la
+    * forma en que una función handle genera nuevas entradas sin recursividad: cada entrada se trata
+    * por completo antes de la siguiente. Fuera de una función handle equivale a
+    * StateContext::delegate.
+    */
+   template<typename T>
+   void post( T anInput )
    {
-      theState = aState;
+      theInputs.post( *this, std::move( anInput ) );
    }
 
 protected:
@@ -70,17 +155,191 @@ protected:
    template<typename T>
    void delegate( T anInput )
    {
-      boost::apply_visitor( StateVisitor<Context, T>( static_cast<Context*>( this ),
-                                                      std::forward<T>( anInput ) ),
-                            theState );
+      theInputs.delegate( *this, std::move( anInput ) );
+   }
+
+   /**
+    * Trata seguidas las entradas del rango [<i>aFirst</i>, <i>aLast</i>). Las entradas encoladas
+    * con StateContext::post durante el tratamiento de una entrada se tratan antes de la
+    * siguiente.
+    */
+   template<typename Iterator>
+   void processBatch( Iterator aFirst, Iterator aLast )
+   {
+      theInputs.processBatch( *this, aFirst, aLast );
+   }
+
+   /**
+    * Trata las entradas de la cola <i>aQueue</i> hasta que esta se detenga. Las entradas que llegan
+    * en ráfaga se extraen de una vez y se tratan seguidas. Esta función bloquea la tarea actual,
+    * por lo que normalmente se ejecutará en una tarea dedicada que sea la única que use el
+    * contexto.
+    */
+   template<typename T, typename Wait>
+   void feed( BasicSafeQueue<T, Wait>& aQueue )
+   {
+      theInputs.feed( *this, aQueue );
    }
 
 private:
 
+   /**
+    * Entrega la entrada <i>anInput</i> al estado actual.
+    *
+    * El estado se resuelve mediante una tabla, generada en tiempo de compilación para cada tipo de
+    * entrada, con una función por estado: las que llaman a la función handle del estado o de uno de
+    * sus superestados y las que entregan a la política una entrada que el estado no maneja. Si la
+    * política de la máquina es Traced, la entrada se registra además en la traza.
+    */
+   template<typename T>
+   void dispatch( T anInput )
+   {
+      using IsTraced = std::is_base_of<TracedPolicy, UnhandledPolicy<std::tuple<States...>>>;
+      dispatch( std::move( anInput ), IsTraced() );
+   }
+
+   template<typename T>
+   void dispatch( T anInput, std::false_type )
+   {
+      static constexpr Handler<T> theHandlers[] = { &handleInput<States, T>... };
+      theHandlers[theState.index()]( static_cast<Context&>( *this ), theState, std::move( anInput ) );
+   }
+
+   /**
+    * Entrega la entrada <i>anInput</i> al estado actual y la registra en la traza de la máquina.
+    * Solo se usa si la política de la máquina es Traced.
+    */
+   template<typename T>
+   void dispatch( T anInput, std::true_type )
+   {
+      const std::size_t aFrom = theState.index();
+      const std::uint64_t aStart = this->traceClock();
+      dispatch( std::move( anInput ), std::false_type() );
+      this->template traceInput<T>( static_cast<Context*>( this ), aFrom, theState.index(), aStart );
+   }
+
+   /**
+    * Función de la tabla de BasicStateContext::dispatch para la entrada de tipo <i>T</i>.
+    */
+   template<typename T>
+   using Handler = void ( * )( Context&, StateVariant<States...>&, T&& );
+
+   /**
+    * Trata la entrada <i>anInput</i> en el estado <i>S</i>, que es el actual, o en el primero de
+    * sus superestados que la trate.
+    */
+   template<typename S, typename T>
+   static std::enable_if_t<CanHandle<S, T>::value, void>
+   handleInput( Context& aContext, StateVariant<States...>& aState, T&& anInput )
+   {
+      using Handler = typename HandlerOf<S, T>::Types;
+      const Handler& aHandler = aState.template get<S>();
+      aHandler.handle( aContext, std::forward<T>( anInput ) );
+   }
+
+   template<typename S, typename T>
+   static std::enable_if_t<!CanHandle<S, T>::value, void>
+   handleInput( Context& aContext, StateVariant<States...>&, T&& )
+   {
+      static_cast<BasicStateContext&>( aContext ).template unhandled<S, T>();
+   }
+
+   /**
+    * Llama a la función onExit del estado actual, si la define.
+    */
+   void exitState()
+   {
+      if( AnyOf<HasOnExit<States, Context>::value...>::value && theEntered )
+      {
+         static constexpr Exit theExits[] = { &exitFrom<States>... };
+         theExits[theState.index()]( static_cast<Context&>( *this ), theState );
+      }
+   }
+
+   /**
+    * Función de la tabla de BasicStateContext::exitState.
+    */
+   using Exit = void ( * )( Context&, StateVariant<States...>& );
+
+   /**
+    * Llama a la función onExit del estado <i>S</i>, que es el actual, si la define.
+    */
+   template<typename S>
+   static std::enable_if_t<HasOnExit<S, Context>::value, void>
+   exitFrom( Context& aContext, StateVariant<States...>& aState )
+   {
+      aState.template get<S>().onExit( aContext );
+   }
+
+   template<typename S>
+   static std::enable_if_t<!HasOnExit<S, Context>::value, void>
+   exitFrom( Context&, StateVariant<States...>& )
+   {
+
+   }
+
+   /**
+    * Llama a la función onEnter del estado <i>S</i>, que acaba de convertirse en el actual, si la
+    * define.
+    */
+   template<typename S>
+   std::enable_if_t<HasOnEnter<S, Context>::value, void> enterState()
+   {
+      theEntered = true;
+      theState.template get<S>().onEnter( static_cast<Context&>( *this ) );
+   }
+
+   template<typename S>
+   std::enable_if_t<!HasOnEnter<S, Context>::value, void> enterState()
+   {
+      theEntered = true;
+   }
+
+   /**
+    * Funciones de las tablas de StateContext::snapshot y StateContext::restore.
+    */
+   using Save = void ( * )( unsigned char*, const StateVariant<States...>& );
+   using Load = void ( * )( StateVariant<States...>&, const unsigned char* );
+
+   template<typename S>
+   static void saveState( unsigned char* aPayload, const StateVariant<States...>& aState )
+   {
+      std::memcpy( aPayload, &aState.template get<S>(), sizeof( S ) );
+   }
+
+   template<typename S>
+   static void loadState( StateVariant<States...>& aState, const unsigned char* aPayload )
+   {
+      aState.template emplace<S>( *reinterpret_cast<const S*>( aPayload ) );
+   }
+
+   template<typename...>
+   friend class OrthogonalRegions;
+
+   friend class RunToCompletion<BasicStateContext>;
+
    /**
     * Los estados que componen la máquina.
     */
-   boost::variant<States...> theState;
+   StateVariant<States...> theState;
+
+   /**
+    * Las entradas encoladas con StateContext::post pendientes de tratar.
+    */
+   RunToCompletion<BasicStateContext> theInputs;
+
+   /**
+    * Indica si ya se ha entrado en algún estado, es decir, si el estado actual no es el construido
+    * por defecto.
+    */
+   bool theEntered{};
 };
 
+/**
+ * Contexto de la máquina de estados que informa por la salida de error de las entradas que no
+ * puede tratar.
+ */
+template<typename Context, typename... States>
+using StateContext = BasicStateContext<ReportUnhandled, Context, States...>;
+
 #endif
@@ -14,15 +14,16 @@
 #ifndef INCLUDE_GENERIC_PATTERNS_STATE_EXECUTOR_HPP_
 #define INCLUDE_GENERIC_PATTERNS_STATE_EXECUTOR_HPP_
 
+#include <tuple>
 #include <type_traits>
-#include <iostream>
-#include <boost/variant.hpp>
+#include "../common/StateTraits.hpp"
+#include "../common/UnhandledInput.hpp"
 
 /** @cond */
 
 // Declaración adelantada.
-template<typename Context, typename... States>
-class StateContext;
+template<template<typename> class UnhandledPolicy, typename Context, typename... States>
+class BasicStateContext;
 
 template <typename T, typename Tuple>
 struct HasType;
@@ -83,8 +84,10 @@ struct State
    };
    @endcode
  *
- * Dado que un estado siempre carece de datos miembro, se recomienda que sea un objeto único para
- * evitar su continua creación y destrucción.
+ * Un estado puede tener datos miembro, que viven mientras la máquina permanece en él: el contexto
+ * guarda el estado actual en su interior, sin reservar memoria, y lo destruye al abandonarlo, por
+ * lo que crear los estados sin datos no cuesta nada. Para que el contexto pueda guardar
+ * instantáneas con StateContext::snapshot, los estados deben copiarse trivialmente.
  */
 template <typename Input, typename... Inputs>
 struct State<Input, Inputs...> : public State<Inputs...>
@@ -96,47 +99,4 @@ struct State<Input, Inputs...> : public State<Inputs...>
    void handle( Context& aContext, Input&& ) const;
 };
 
-/** @cond */
-
-// @brief Visitor para manejar los distintos tipos de entrada de un estado.
-//
-// La plantilla StateVisitor se encarga de delegar en la función handle adecuada, es decir, aquella
-// función handle que es capaz de tratar el tipo de entrada especificado en el constructor.
-template<typename Context, typename Input>
-class StateVisitor : public boost::static_visitor<>
-{
-public:
-
-   StateVisitor( Context* aContext, Input&& anInput )
-   : theContext{ aContext },
-     theInput{ std::forward<Input>( anInput ) }
-   {
-
-   }
-
-   template<typename S>
-   std::enable_if_t<TupleHasType<Input, typename S::Types>::value, void>
-   operator()( const S& aState ) const
-   {
-      aState.handle( *theContext, std::forward<Input>( theInput ) );
-   }
-
-   template<typename S>
-   std::enable_if_t<!TupleHasType<Input, typename S::Types>::value, void>
-   operator()( const S& aState ) const
-   {
-      std::cerr << "State can't handle this input type" << std::endl;
-   }
-
-private:
-
-   // El objeto cuyos datos cambian en función de la máquina de estados.
-   Context* theContext;
-
-   // El tipo empleado como argumento de la función handle de un estado.
-   Input&& theInput;
-};
-
-/** @endcond */
-
 #endif
@@ -0,0 +1,364 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_STATE_TRACE_HPP_
+#define INCLUDE_GENERIC_PATTERNS_STATE_TRACE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <tuple>
+#include <typeinfo>
+#include <vector>
+#include "../common/StateTraits.hpp"
+#include "../common/UnhandledInput.hpp"
+#include "LatencyHistogram.hpp"
+
+/** @cond */
+
+// Declaración adelantada.
+template<template<typename> class UnhandledPolicy, typename Context, typename... States>
+class BasicStateContext;
+
+/** @endcond */
+
+/**
+ * @brief Registro del tratamiento de una entrada por una máquina de estados.
+ */
+struct TraceRecord
+{
+   /**
+    * El contexto que trató la entrada.
+    */
+   const void* theContext;
+
+   /**
+    * El estado antes de tratar la entrada.
+    */
+   const std::type_info* theFrom;
+
+   /**
+    * El tipo de la entrada.
+    */
+   const std::type_info* theInput;
+
+   /**
+    * El estado después de tratar la entrada.
+    */
+   const std::type_info* theTo;
+
+   /**
+    * El instante en que empezó el tratamiento, en nanosegundos de std::chrono::steady_clock.
+    */
+   std::uint64_t theTime;
+};
+
+/**
+ * @brief Búfer circular de registros de una tarea.
+ *
+ * Cada tarea que trata entradas de máquinas con traza escribe en su propio búfer, obtenido con
+ * TraceRing::local, de modo que la escritura no necesita bloqueos. El búfer se destruye cuando la
+ * tarea termina, así que solo se conservan los registros de las tareas vivas. Cuando el búfer se llena, los
+ * registros nuevos sustituyen a los más antiguos. Los registros pueden leerse desde cualquier
+ * tarea mientras se escriben; cada posición lleva un número de secuencia que permite descartar las
+ * que se están sobrescribiendo.
+ */
+class TraceRing
+{
+public:
+
+   /**
+    * Número de registros que caben en el búfer.
+    */
+   static constexpr std::size_t theCapacity = 1024;
+
+   /**
+    * Añade el registro <i>aRecord</i>. Solo debe llamarla la tarea propietaria del búfer.
+    */
+   void push( const TraceRecord& aRecord )
+   {
+      const std::uint64_t aPosition = theHead.load( std::memory_order_relaxed );
+      Slot& aSlot = theSlots[aPosition % theCapacity];
+      aSlot.theSequence.store( 2 * aPosition + 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_release );
+      aSlot.theContext.store( aRecord.theContext, std::memory_order_relaxed );
+      aSlot.theFrom.store( aRecord.theFrom, std::memory_order_relaxed );
+      aSlot.theInput.store( aRecord.theInput, std::memory_order_relaxed );
+      aSlot.theTo.store( aRecord.theTo, std::memory_order_relaxed );
+      aSlot.theTime.store( aRecord.theTime, std::memory_order_relaxed );
+      aSlot.theSequence.store( 2 * aPosition + 2, std::memory_order_release );
+      theHead.store( aPosition + 1, std::memory_order_release );
+   }
+
+   /**
+    * Añade a <i>aRecords</i>, del más antiguo al más reciente, los registros del búfer.
+    */
+   void copyTo( std::vector<TraceRecord>& aRecords ) const
+   {
+      const std::uint64_t aHead = theHead.load( std::memory_order_acquire );
+      const std::uint64_t aFirst = aHead > theCapacity ? aHead - theCapacity : 0;
+      for( std::uint64_t aPosition = aFirst; aPosition < aHead; ++aPosition )
+      {
+         const Slot& aSlot = theSlots[aPosition % theCapacity];
+         const std::uint64_t aSequence = aSlot.theSequence.load( std::memory_order_acquire );
+         TraceRecord aRecord{ aSlot.theContext.load( std::memory_order_relaxed ),
+                              aSlot.theFrom.load( std::memory_order_relaxed ),
+                              aSlot.theInput.load( std::memory_order_relaxed ),
+                              aSlot.theTo.load( std::memory_order_relaxed ),
+                              aSlot.theTime.load( std::memory_order_relaxed ) };
+         std::atomic_thread_fence( std::memory_order_acquire );
+         if( aSequence == 2 * aPosition + 2 &&
+             aSlot.theSequence.load( std::memory_order_relaxed ) == aSequence )
+         {
+            aRecords.push_back( aRecord );
+         }
+      }
+   }
+
+   /**
+    * Devuelve el búfer de la tarea actual, que se crea la primera vez que se pide.
+    */
+   static TraceRing& local()
+   {
+      thread_local std::shared_ptr<TraceRing> theRing = registerRing();
+      return *theRing;
+   }
+
+   /**
+    * Devuelve los registros de los búferes de todas las tareas vivas.
+    */
+   static std::vector<TraceRecord> collect()
+   {
+      std::vector<TraceRecord> aRecords;
+      std::lock_guard<std::mutex> aLock{ registry().theMutex };
+      auto& aRings = registry().theRings;
+      for( auto i = aRings.begin(); i != aRings.end(); )
+      {
+         if( std::shared_ptr<TraceRing> aRing = i->lock() )
+         {
+            aRing->copyTo( aRecords );
+            ++i;
+         }
+         else
+         {
+            i = aRings.erase( i );
+         }
+      }
+
+      return aRecords;
+   }
+
+   /**
+    * Escribe en <i>anOutput</i> los registros de todas las tareas, uno por línea.
+    */
+   static void dump( std::ostream& anOutput )
+   {
+      for( const TraceRecord& aRecord : collect() )
+      {
+         anOutput << aRecord.theTime << ' ' << aRecord.theContext << ' ' << aRecord.theFrom->name()
+                  << " --" << aRecord.theInput->name() << "--> " << aRecord.theTo->name() << '\n';
+      }
+   }
+
+private:
+
+   /**
+    * Una posición del búfer. El número de secuencia es impar mientras se escribe.
+    */
+   struct Slot
+   {
+      std::atomic<std::uint64_t> theSequence{};
+      std::atomic<const void*> theContext{};
+      std::atomic<const std::type_info*> theFrom{};
+      std::atomic<const std::type_info*> theInput{};
+      std::atomic<const std::type_info*> theTo{};
+      std::atomic<std::uint64_t> theTime{};
+   };
+
+   /**
+    * Los búferes de todas las tareas. Los de las tareas que han terminado se eliminan al registrar
+    * uno nuevo o al recoger los registros.
+    */
+   struct Registry
+   {
+      std::mutex theMutex;
+      std::vector<std::weak_ptr<TraceRing>> theRings;
+   };
+
+   static Registry& registry()
+   {
+      static Registry theRegistry;
+      return theRegistry;
+   }
+
+   static std::shared_ptr<TraceRing> registerRing()
+   {
+      std::shared_ptr<TraceRing> aRing = std::make_shared<TraceRing>();
+      std::lock_guard<std::mutex> aLock{ registry().theMutex };
+      auto& aRings = registry().theRings;
+      aRings.erase( std::remove_if( aRings.begin(), aRings.end(),
+                                    []( const std::weak_ptr<TraceRing>& aRing ) { return aRing.expired(); } ),
+                    aRings.end() );
+      aRings.push_back( aRing );
+      return aRing;
+   }
+
+   std::array<Slot, theCapacity> theSlots;
+
+   std::atomic<std::uint64_t> theHead{};
+};
+
+/**
+ * @brief Traza de una máquina de estados.
+ *
+ * La plantilla StateTracer registra cada entrada que trata la máquina ─estado de partida, tipo de
+ * la entrada, estado de llegada e instante─ en el búfer TraceRing de la tarea que la trata, y
+ * añade la duración del tratamiento al histograma del estado de partida y el tipo de la entrada.
+ * No se usa directamente, sino a través de la política Traced.
+ */
+template<typename States>
+class StateTracer;
+
+template<typename... States>
+class StateTracer<std::tuple<States...>> : public TracedPolicy
+{
+public:
+
+   /**
+    * Devuelve el histograma de las duraciones del tratamiento de las entradas de tipo
+    * <i>Input</i> en el estado <i>S</i>.
+    */
+   template<typename S, typename Input>
+   const LatencyHistogram& handlingTime() const
+   {
+      return theHistograms[TupleIndex<S, std::tuple<States...>>::value * theColumns +
+                           TupleIndex<Input, TracedInputs>::value];
+   }
+
+   /**
+    * Escribe en <i>anOutput</i> un resumen de los histogramas con datos: el estado, el tipo de la
+    * entrada ─other para los que no maneja ningún estado─, el número de entradas tratadas y las
+    * cotas de la mediana y del percentil 99 en nanosegundos.
+    */
+   void dumpHandlingTimes( std::ostream& anOutput ) const
+   {
+      for( std::size_t i = 0; i < theHistograms.size(); ++i )
+      {
+         const LatencyHistogram& aHistogram = theHistograms[i];
+         if( aHistogram.count() != 0 )
+         {
+            anOutput << stateName( i / theColumns ).name() << ' '
+                     << inputName( i % theColumns, static_cast<TracedInputs*>( nullptr ) ) << ' '
+                     << aHistogram.count() << ' ' << aHistogram.quantile( 0.5 ) << ' '
+                     << aHistogram.quantile( 0.99 ) << '\n';
+         }
+      }
+   }
+
+protected:
+
+   /**
+    * Devuelve el instante actual en nanosegundos.
+    */
+   static std::uint64_t traceClock()
+   {
+      return static_cast<std::uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch() ).count() );
+   }
+
+   /**
+    * Registra el tratamiento por el contexto <i>aContext</i> de una entrada de tipo <i>Input</i>
+    * que empezó en el instante <i>aStart</i> con el estado de posición <i>aFrom</i> y terminó con
+    * el de posición <i>aTo</i>.
+    */
+   template<typename Input>
+   void traceInput( const void* aContext, std::size_t aFrom, std::size_t aTo, std::uint64_t aStart )
+   {
+      const std::uint64_t anEnd = traceClock();
+      TraceRing::local().push( { aContext, &stateName( aFrom ), &typeid( Input ), &stateName( aTo ), aStart } );
+      theHistograms[aFrom * theColumns + TupleIndex<Input, TracedInputs>::value].record( anEnd - aStart );
+   }
+
+private:
+
+   /**
+    * Los tipos de entrada que manejan los estados de la máquina.
+    */
+   using TracedInputs = typename InputsOf<std::tuple<States...>>::Types;
+
+   /**
+    * Número de columnas de la tabla de histogramas: una por cada tipo de entrada más una para los
+    * tipos que no maneja ningún estado.
+    */
+   static constexpr std::size_t theColumns = std::tuple_size<TracedInputs>::value + 1;
+
+   /**
+    * Devuelve el tipo del estado de posición <i>anIndex</i>.
+    */
+   static const std::type_info& stateName( std::size_t anIndex )
+   {
+      static const std::type_info* const theNames[] = { &typeid( States )... };
+      return *theNames[anIndex];
+   }
+
+   /**
+    * Devuelve el nombre del tipo de entrada de la columna <i>aColumn</i>.
+    */
+   template<typename... Inputs>
+   static const char* inputName( std::size_t aColumn, std::tuple<Inputs...>* )
+   {
+      static const char* const theNames[] = { typeid( Inputs ).name()..., "other" };
+      return theNames[aColumn];
+   }
+
+   /**
+    * Los histogramas de cada estado y tipo de entrada.
+    */
+   std::array<LatencyHistogram, sizeof...( States ) * theColumns> theHistograms;
+};
+
+/**
+ * @brief Política que añade la traza a otra política de entradas no tratadas.
+ *
+ * La traza se activa eligiendo Traced<Policy>::Policy como política del contexto, donde
+ * <i>Policy</i> es la política de entradas no tratadas. Con cualquier otra política, el código
+ * de la traza no se genera y no tiene coste alguno:
+ *
+ * @code
+   class Radio : public BasicStateContext<Traced<CountUnhandled>::Policy, Radio, Listening, Receiving>
+   {
+      ...
+   }
+   @endcode
+ */
+template<template<typename> class UnhandledPolicy = ReportUnhandled>
+struct Traced
+{
+   template<typename States>
+   class Policy : public UnhandledPolicy<States>, public StateTracer<States> {};
+};
+
+/**
+ * Contexto de la máquina de estados con traza que informa por la salida de error de las entradas
+ * que no puede tratar.
+ */
+template<typename Context, typename... States>
+using TracedStateContext = BasicStateContext<Traced<>::Policy, Context, States...>;
+
+#endif
@@ -0,0 +1,220 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_STATE_VARIANT_HPP_
+#define INCLUDE_GENERIC_PATTERNS_STATE_VARIANT_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "../common/StateTraits.hpp"
+#include "../common/UnhandledInput.hpp"
+
+/**
+ * @brief Almacén del estado actual de una máquina de estados.
+ *
+ * La plantilla StateVariant guarda un objeto de uno de los tipos <i>States</i> en un búfer interno
+ * del tamaño del mayor de ellos, junto con su posición en la lista. A diferencia de
+ * boost::variant, nunca reserva memoria: cambiar de estado destruye el actual y construye el nuevo
+ * en el mismo búfer. Las operaciones que dependen del tipo actual, como la copia o la
+ * destrucción, se resuelven mediante tablas de funciones generadas en tiempo de compilación.
+ *
+ * Si el constructor del nuevo estado puede lanzar una excepción, el estado se construye aparte
+ * antes de destruir el actual, que se conserva si la construcción falla, y después se mueve al
+ * búfer; en ese caso, el estado debe poder moverse sin lanzar excepciones.
+ *
+ * Inicialmente contiene el primero de los estados construido por defecto.
+ */
+template<typename... States>
+class StateVariant
+{
+public:
+
+   StateVariant()
+      :
+      theIndex{}
+   {
+      new( &theStorage ) std::tuple_element_t<0, std::tuple<States...>>();
+   }
+
+   StateVariant( const StateVariant& anOther )
+      :
+      theIndex{ anOther.theIndex }
+   {
+      static constexpr Copy theCopies[] = { &copyState<States>... };
+      theCopies[theIndex]( &theStorage, &anOther.theStorage );
+   }
+
+   StateVariant( StateVariant&& anOther )
+      :
+      theIndex{ anOther.theIndex }
+   {
+      static constexpr Move theMoves[] = { &moveState<States>... };
+      theMoves[theIndex]( &theStorage, &anOther.theStorage );
+   }
+
+   ~StateVariant()
+   {
+      reset();
+   }
+
+   StateVariant& operator=( const StateVariant& anOther )
+   {
+      if( this != &anOther )
+      {
+         *this = StateVariant( anOther );
+      }
+
+      return *this;
+   }
+
+   StateVariant& operator=( StateVariant&& anOther )
+   {
+      static_assert( AllOf<std::is_nothrow_move_constructible<States>::value...>::value,
+                     "StateVariant: states must be nothrow move constructible" );
+      if( this != &anOther )
+      {
+         static constexpr Move theMoves[] = { &moveState<States>... };
+         reset();
+         theMoves[anOther.theIndex]( &theStorage, &anOther.theStorage );
+         theIndex = anOther.theIndex;
+      }
+
+      return *this;
+   }
+
+   /**
+    * Sustituye el estado actual por uno de tipo <i>S</i> construido con los argumentos
+    * <i>aArgs</i>, y lo devuelve.
+    */
+   template<typename S, typename... Args>
+   S& emplace( Args&&... aArgs )
+   {
+      static_assert( indexOf<S>() < sizeof...( States ), "StateVariant: S is not one of the states" );
+      construct<S>( std::is_nothrow_constructible<S, Args...>(), std::forward<Args>( aArgs )... );
+      return get<S>();
+   }
+
+   /**
+    * Devuelve la posición en la lista de estados del tipo del estado actual.
+    */
+   std::size_t index() const
+   {
+      return theIndex;
+   }
+
+   /**
+    * Devuelve el estado actual, que debe ser de tipo <i>S</i>.
+    */
+   template<typename S>
+   S& get()
+   {
+      return *reinterpret_cast<S*>( &theStorage );
+   }
+
+   template<typename S>
+   const S& get() const
+   {
+      return *reinterpret_cast<const S*>( &theStorage );
+   }
+
+   /**
+    * Devuelve el estado actual si es de tipo <i>S</i> o nullptr en caso contrario.
+    */
+   template<typename S>
+   S* getIf()
+   {
+      return theIndex == indexOf<S>() ? &get<S>() : nullptr;
+   }
+
+private:
+
+   /**
+    * Devuelve la posición del tipo <i>S</i> en la lista de estados.
+    */
+   template<typename S>
+   static constexpr std::size_t indexOf()
+   {
+      return TupleIndex<S, std::tuple<States...>>::value;
+   }
+
+   /**
+    * Construye en el búfer el estado de tipo <i>S</i> cuyo constructor no lanza excepciones.
+    */
+   template<typename S, typename... Args>
+   void construct( std::true_type, Args&&... aArgs )
+   {
+      reset();
+      new( &theStorage ) S( std::forward<Args>( aArgs )... );
+      theIndex = indexOf<S>();
+   }
+
+   /**
+    * Construye aparte el estado de tipo <i>S</i>, cuyo constructor puede lanzar excepciones, y lo
+    * mueve al búfer.
+    */
+   template<typename S, typename... Args>
+   void construct( std::false_type, Args&&... aArgs )
+   {
+      static_assert( std::is_nothrow_move_constructible<S>::value,
+                     "StateVariant: S must be nothrow constructible or nothrow move constructible" );
+      S aState( std::forward<Args>( aArgs )... );
+      construct<S>( std::true_type(), std::move( aState ) );
+   }
+
+   /**
+    * Destruye el estado actual.
+    */
+   void reset()
+   {
+      static constexpr Destroy theDestroys[] = { &destroyState<States>... };
+      theDestroys[theIndex]( &theStorage );
+   }
+
+   using Copy = void ( * )( void*, const void* );
+   using Move = void ( * )( void*, void* );
+   using Destroy = void ( * )( void* );
+
+   template<typename S>
+   static void copyState( void* aTarget, const void* aSource )
+   {
+      new( aTarget ) S( *static_cast<const S*>( aSource ) );
+   }
+
+   template<typename S>
+   static void moveState( void* aTarget, void* aSource )
+   {
+      new( aTarget ) S( std::move( *static_cast<S*>( aSource ) ) );
+   }
+
+   template<typename S>
+   static void destroyState( void* aState )
+   {
+      static_cast<S*>( aState )->~S();
+   }
+
+   /**
+    * El búfer en el que se construye el estado actual.
+    */
+   alignas( States... ) unsigned char theStorage[std::max( { sizeof( States )... } )];
+
+   /**
+    * La posición en la lista de estados del tipo del estado actual.
+    */
+   std::size_t theIndex;
+};
+
+#endif
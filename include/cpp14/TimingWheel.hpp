@@ -0,0 +1,418 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_TIMING_WHEEL_HPP_
+#define INCLUDE_GENERIC_PATTERNS_TIMING_WHEEL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Identificador de un temporizador de TimingWheel.
+ *
+ * Permite cancelar el temporizador. Un identificador de un temporizador que ya ha vencido o se ha
+ * cancelado no cancela nada, aunque su posición se haya reutilizado.
+ */
+struct TimerHandle
+{
+   /**
+    * La posición del temporizador.
+    */
+   std::uint32_t theIndex;
+
+   /**
+    * La generación de la posición cuando se creó el temporizador.
+    */
+   std::uint32_t theGeneration;
+};
+
+/**
+ * @brief Rueda de temporizadores jerárquica.
+ *
+ * La clase TimingWheel guarda objetos de tipo T hasta un instante, medido en pasos de un reloj
+ * que avanza quien la usa. Tiene cuatro niveles de 256 casillas: el primero tiene una casilla por
+ * paso y cada uno de los siguientes, una por vuelta completa del anterior, por lo que abarca 2^32
+ * pasos. Los temporizadores más lejanos se guardan en la última casilla y se recolocan al llegar
+ * a ella.
+ *
+ * Añadir y cancelar un temporizador cuesta un tiempo constante: cada casilla es una lista
+ * doblemente enlazada de nodos que se guardan en un vector y se reutilizan. Al avanzar, cada vez
+ * que el primer nivel completa una vuelta se reparten entre los niveles inferiores los
+ * temporizadores de la siguiente casilla de los superiores. Un mapa de bits de las casillas
+ * ocupadas permite saltar directamente al siguiente paso con temporizadores que vencen o se
+ * recolocan, por lejano que esté.
+ *
+ * Esta clase no es concurrentemente segura.
+ */
+template<typename T>
+class TimingWheel
+{
+public:
+
+   /**
+    * Crea la rueda con el reloj en el paso 0.
+    */
+   TimingWheel()
+   {
+      for( auto& aHead : theHeads )
+      {
+         aHead = theNone;
+      }
+   }
+
+   /**
+    * Guarda <i>anObject</i> hasta el paso <i>aTick</i> y devuelve el identificador del
+    * temporizador. Si el reloj ya ha procesado ese paso, el objeto vence en el siguiente.
+    */
+   TimerHandle insert( std::uint64_t aTick, T&& anObject )
+   {
+      std::uint32_t anIndex;
+      if( theFree != theNone )
+      {
+         anIndex = theFree;
+         theFree = theNodes[anIndex].theNext;
+      }
+      else
+      {
+         anIndex = static_cast<std::uint32_t>( theNodes.size() );
+         theNodes.emplace_back();
+      }
+
+      Node& aNode = theNodes[anIndex];
+      aNode.theObject = std::move( anObject );
+      aNode.theTick = aTick;
+      link( anIndex );
+      ++theSize;
+      return TimerHandle{ anIndex, aNode.theGeneration };
+   }
+
+   /**
+    * Cancela el temporizador <i>aHandle</i>. Devuelve falso si ya había vencido o se había
+    * cancelado.
+    */
+   bool cancel( TimerHandle aHandle )
+   {
+      if( aHandle.theIndex >= theNodes.size() || theNodes[aHandle.theIndex].theGeneration != aHandle.theGeneration ||
+          theNodes[aHandle.theIndex].theSlot == theNoSlot )
+      {
+         return false;
+      }
+
+      unlink( aHandle.theIndex );
+      release( aHandle.theIndex );
+      return true;
+   }
+
+   /**
+    * Avanza el reloj hasta el paso <i>aTick</i>, inclusive, y entrega a <i>anExpire</i>, en orden
+    * de vencimiento, los objetos vencidos.
+    */
+   template<typename Expire>
+   void advance( std::uint64_t aTick, Expire&& anExpire )
+   {
+      while( theCurrent <= aTick && theSize != 0 )
+      {
+         if( ( theCurrent & theSlotMask ) == 0 )
+         {
+            cascade();
+         }
+
+         std::uint32_t& aHead = theHeads[theCurrent & theSlotMask];
+         while( aHead != theNone )
+         {
+            const std::uint32_t anIndex = aHead;
+            unlink( anIndex );
+            T anObject = std::move( theNodes[anIndex].theObject );
+            release( anIndex );
+            anExpire( std::move( anObject ) );
+         }
+
+         const std::uint64_t aNext = nextFrom( theCurrent + 1 );
+         theCurrent = aNext <= aTick ? aNext : aTick + 1;
+      }
+
+      if( theSize == 0 && theCurrent <= aTick )
+      {
+         theCurrent = aTick + 1;
+      }
+   }
+
+   /**
+    * Devuelve el próximo paso en el que el reloj debe avanzar: el primero en el que vence algún
+    * temporizador del primer nivel o se recolocan los de alguna casilla de los niveles superiores.
+    * Solo tiene sentido si la rueda no está vacía.
+    */
+   std::uint64_t next() const
+   {
+      return nextFrom( theCurrent );
+   }
+
+   /**
+    * Devuelve el siguiente paso que procesará el reloj.
+    */
+   std::uint64_t current() const
+   {
+      return theCurrent;
+   }
+
+   /**
+    * Devuelve el número de temporizadores pendientes.
+    */
+   std::size_t size() const
+   {
+      return theSize;
+   }
+
+   /**
+    * Indica si no hay temporizadores pendientes.
+    */
+   bool empty() const
+   {
+      return theSize == 0;
+   }
+
+private:
+
+   static constexpr std::uint32_t theNone = UINT32_MAX;
+
+   static constexpr std::uint16_t theNoSlot = UINT16_MAX;
+
+   static constexpr int theLevels = 4;
+
+   static constexpr int theSlotBits = 8;
+
+   static constexpr std::uint64_t theSlotMask = ( 1u << theSlotBits ) - 1;
+
+   /**
+    * Un temporizador, o una posición libre si no está en ninguna casilla.
+    */
+   struct Node
+   {
+      T theObject{};
+      std::uint64_t theTick{};
+      std::uint32_t theNext{ theNone };
+      std::uint32_t thePrevious{ theNone };
+      std::uint32_t theGeneration{};
+      std::uint16_t theSlot{ theNoSlot };
+   };
+
+   /**
+    * Devuelve el primer paso desde <i>aTick</i> que debe procesarse. Una casilla de posición
+    * <i>d</i> del nivel <i>n</i> se procesa en los pasos cuyo dígito <i>n</i>, en base 256, es
+    * <i>d</i> y los inferiores son cero; el resultado es el menor de esos pasos entre todas las
+    * casillas ocupadas.
+    */
+   std::uint64_t nextFrom( std::uint64_t aTick ) const
+   {
+      std::uint64_t aNext = UINT64_MAX;
+      for( int aLevel = 0; aLevel < theLevels; ++aLevel )
+      {
+         const int aShift = theSlotBits * aLevel;
+         const std::uint64_t aFirst = ( aTick + ( std::uint64_t{ 1 } << aShift ) - 1 ) >> aShift;
+         const int aDistance = nextOccupied( aLevel, aFirst & theSlotMask );
+         if( aDistance >= 0 )
+         {
+            const std::uint64_t aCandidate = ( aFirst + static_cast<std::uint64_t>( aDistance ) ) << aShift;
+            aNext = aCandidate < aNext ? aCandidate : aNext;
+         }
+      }
+
+      return aNext;
+   }
+
+   /**
+    * Devuelve cuántas casillas hay desde la de posición <i>aDigit</i> del nivel <i>aLevel</i>
+    * hasta la siguiente ocupada, dando la vuelta si hace falta, o -1 si el nivel está vacío.
+    */
+   int nextOccupied( int aLevel, std::uint64_t aDigit ) const
+   {
+      for( int aDistance = 0; aDistance < ( 1 << theSlotBits ) + 64; )
+      {
+         const std::uint64_t aSlot = ( aDigit + static_cast<std::uint64_t>( aDistance ) ) & theSlotMask;
+         const std::uint64_t aBits = theOccupied[( aLevel << theSlotBits ) / 64 + aSlot / 64] >> ( aSlot % 64 );
+         if( aBits != 0 )
+         {
+            return aDistance + lowestBit( aBits );
+         }
+
+         aDistance += static_cast<int>( 64 - aSlot % 64 );
+      }
+
+      return -1;
+   }
+
+   /**
+    * Devuelve la posición del bit activo más bajo de <i>aBits</i>, que no debe ser cero.
+    */
+   static int lowestBit( std::uint64_t aBits )
+   {
+#if defined( __GNUC__ )
+      return __builtin_ctzll( aBits );
+#else
+      int aBit = 0;
+      for( ; ( aBits & 1 ) == 0; aBits >>= 1 )
+      {
+         ++aBit;
+      }
+
+      return aBit;
+#endif
+   }
+
+   void markOccupied( std::size_t aSlot )
+   {
+      theOccupied[aSlot / 64] |= std::uint64_t{ 1 } << ( aSlot % 64 );
+   }
+
+   void markEmpty( std::size_t aSlot )
+   {
+      theOccupied[aSlot / 64] &= ~( std::uint64_t{ 1 } << ( aSlot % 64 ) );
+   }
+
+   /**
+    * Enlaza el nodo <i>anIndex</i> en la casilla que le corresponde según su vencimiento.
+    */
+   void link( std::uint32_t anIndex )
+   {
+      Node& aNode = theNodes[anIndex];
+      const std::uint64_t aTick = aNode.theTick < theCurrent ? theCurrent : aNode.theTick;
+      const std::uint64_t aDelta = aTick - theCurrent;
+
+      int aLevel = 0;
+      while( aLevel < theLevels - 1 && aDelta >> ( theSlotBits * ( aLevel + 1 ) ) != 0 )
+      {
+         ++aLevel;
+      }
+
+      // Los temporizadores fuera del alcance de la rueda esperan en la casilla más lejana del
+      // último nivel y se recolocan al llegar a ella.
+      const std::uint64_t aLimit = std::uint64_t{ 1 } << ( theSlotBits * theLevels );
+      const std::uint64_t aPlaced = aDelta < aLimit ? aTick : theCurrent + aLimit - 1;
+
+      const std::uint16_t aSlot =
+         static_cast<std::uint16_t>( ( aLevel << theSlotBits ) + ( ( aPlaced >> ( theSlotBits * aLevel ) ) & theSlotMask ) );
+      aNode.theSlot = aSlot;
+      aNode.thePrevious = theNone;
+      aNode.theNext = theHeads[aSlot];
+      if( aNode.theNext != theNone )
+      {
+         theNodes[aNode.theNext].thePrevious = anIndex;
+      }
+
+      theHeads[aSlot] = anIndex;
+      markOccupied( aSlot );
+   }
+
+   /**
+    * Desenlaza el nodo <i>anIndex</i> de su casilla.
+    */
+   void unlink( std::uint32_t anIndex )
+   {
+      Node& aNode = theNodes[anIndex];
+      if( aNode.thePrevious != theNone )
+      {
+         theNodes[aNode.thePrevious].theNext = aNode.theNext;
+      }
+      else
+      {
+         theHeads[aNode.theSlot] = aNode.theNext;
+      }
+
+      if( aNode.theNext != theNone )
+      {
+         theNodes[aNode.theNext].thePrevious = aNode.thePrevious;
+      }
+
+      if( theHeads[aNode.theSlot] == theNone )
+      {
+         markEmpty( aNode.theSlot );
+      }
+
+      aNode.theSlot = theNoSlot;
+   }
+
+   /**
+    * Devuelve el nodo <i>anIndex</i> a la lista de posiciones libres.
+    */
+   void release( std::uint32_t anIndex )
+   {
+      Node& aNode = theNodes[anIndex];
+      aNode.theObject = T{};
+      ++aNode.theGeneration;
+      aNode.theNext = theFree;
+      theFree = anIndex;
+      --theSize;
+   }
+
+   /**
+    * Recoloca los temporizadores de las casillas de los niveles superiores que empiezan en el paso
+    * actual, empezando por el nivel más alto.
+    */
+   void cascade()
+   {
+      int aLevel = 1;
+      while( aLevel < theLevels - 1 && ( ( theCurrent >> ( theSlotBits * aLevel ) ) & theSlotMask ) == 0 )
+      {
+         ++aLevel;
+      }
+
+      for( ; aLevel > 0; --aLevel )
+      {
+         const std::size_t aSlot =
+            ( aLevel << theSlotBits ) + ( ( theCurrent >> ( theSlotBits * aLevel ) ) & theSlotMask );
+         std::uint32_t anIndex = theHeads[aSlot];
+         theHeads[aSlot] = theNone;
+         markEmpty( aSlot );
+         while( anIndex != theNone )
+         {
+            const std::uint32_t aNext = theNodes[anIndex].theNext;
+            link( anIndex );
+            anIndex = aNext;
+         }
+      }
+   }
+
+   /**
+    * Las casillas de todos los niveles, con la posición del primer nodo de cada una.
+    */
+   std::uint32_t theHeads[theLevels << theSlotBits];
+
+   /**
+    * Un bit por casilla que indica si está ocupada.
+    */
+   std::uint64_t theOccupied[( theLevels << theSlotBits ) / 64]{};
+
+   /**
+    * Los nodos, ocupados y libres.
+    */
+   std::vector<Node> theNodes;
+
+   /**
+    * La primera posición libre.
+    */
+   std::uint32_t theFree{ theNone };
+
+   /**
+    * El número de temporizadores pendientes.
+    */
+   std::size_t theSize{};
+
+   /**
+    * El siguiente paso que procesará el reloj.
+    */
+   std::uint64_t theCurrent{};
+};
+
+#endif
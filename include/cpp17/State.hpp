@@ -14,16 +14,23 @@
 #ifndef INCLUDE_GENERIC_PATTERNS_STATE_HPP_
 #define INCLUDE_GENERIC_PATTERNS_STATE_HPP_
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <variant>
+#include "../common/RunToCompletion.hpp"
+#include "../common/StateSnapshot.hpp"
+#include "../common/StateTraits.hpp"
+#include "../common/UnhandledInput.hpp"
 
 /** @cond */
 
 // Declaración adelantada.
-template<typename Context, typename... States>
-class StateContext;
-
-template<class T> struct always_false : std::false_type {};
+template<template<typename> class UnhandledPolicy, typename Context, typename... States>
+class BasicStateContext;
 
 template <typename T, typename Tuple>
 struct HasType;
@@ -74,8 +81,10 @@ struct State
    };
    @endcode
  *
- * Dado que un estado siempre carece de datos miembro, se recomienda que sea un objeto único para
- * evitar su continua creación y destrucción.
+ * Un estado puede tener datos miembro, que viven mientras la máquina permanece en él: el contexto
+ * guarda el estado actual en su interior, sin reservar memoria, y lo destruye al abandonarlo, por
+ * lo que crear los estados sin datos no cuesta nada. Para que el contexto pueda guardar
+ * instantáneas con StateContext::snapshot, los estados deben copiarse trivialmente.
  */
 template <typename T, typename... Ts>
 struct State<T, Ts...> : public State<Ts...>
@@ -115,47 +124,273 @@ struct State<T, Ts...> : public State<Ts...>
  * El contexto tiene disponible la función StateContext::changeState que, como su nombre indica,
  * permite el cambio de estado. Dicha función tiene dos propósitos: especificar el estado inicial,
  * algo que normalmente hará el contexto, y cambiar de un estado a otro, algo que deberían hacer los
- * propios estados.
+ * propios estados. El nuevo estado se copia o se mueve según se pase; para los estados con datos
+ * miembro costosos de copiar, StateContext::emplaceState lo construye directamente en el contexto.
+ *
+ * Las entradas que el estado actual no puede tratar se entregan a la política
+ * <i>UnhandledPolicy</i>, que es además base del contexto. StateContext usa ReportUnhandled, que
+ * informa por la salida de error; para elegir otra, el contexto debe derivar de BasicStateContext:
+ *
+ * @code
+   class Radio : public BasicStateContext<CountUnhandled, Radio, Listening, Receiving, Transmitting>
+   {
+      ...
+   }
+   @endcode
+ *
+ * Las políticas disponibles son IgnoreUnhandled, CountUnhandled, CallbackUnhandled y
+ * RejectUnhandled.
  */
-template<typename Context, typename... States>
-class StateContext
+template<template<typename> class UnhandledPolicy, typename Context, typename... States>
+class BasicStateContext : public UnhandledPolicy<std::tuple<States...>>
 {
 public:
 
    /**
     * Delega el tratamiento de los datos de entrada <i>anInput</i> al estado actual.
+    *
+    * La entrada se reenvía sin copias hasta la función handle del estado. El estado se resuelve
+    * mediante una tabla, generada en tiempo de compilación para cada tipo de entrada, con una
+    * función por estado: las que llaman a su función handle y las que entregan a la política una
+    * entrada que el estado no maneja.
     */
    template<typename T>
-   void delegate( T anInput )
-   {
-      std::visit( [&]( auto&& aState ) {
-                     using S = std::decay_t<decltype( aState )>;
-                     if constexpr( HasType<T, typename S::Types>::value )
-                     {
-                        aState.handle( static_cast<Context&>( *this ), std::forward<T>( anInput ) );
-                     }
-                     else
-                     {
-                        std::cerr << "State can't handle this input type" << std::endl;
-                     }
-                  }, theState );
+   void delegate( T&& anInput )
+   {
+      theInputs.delegate( *this, std::forward<T>( anInput ) );
+   }
+
+   /**
+    * Encola la entrada <i>anInput</i> para tratarla en cuanto termine la entrada en curso. Es la
+    * forma en que una función handle genera nuevas entradas sin recursividad: cada entrada se trata
+    * por completo antes de la siguiente. Fuera de una función handle equivale a
+    * StateContext::delegate.
+    */
+   template<typename T>
+   void post( T&& anInput )
+   {
+      theInputs.post( *this, std::forward<T>( anInput ) );
+   }
+
+   /**
+    * Trata seguidas las entradas del rango [<i>aFirst</i>, <i>aLast</i>). Las entradas encoladas
+    * con StateContext::post durante el tratamiento de una entrada se tratan antes de la
+    * siguiente.
+    */
+   template<typename Iterator>
+   void processBatch( Iterator aFirst, Iterator aLast )
+   {
+      theInputs.processBatch( *this, aFirst, aLast );
+   }
+
+   /**
+    * Trata las entradas de la cola <i>aQueue</i> hasta que esta se detenga. Las entradas que llegan
+    * en ráfaga se extraen de una vez y se tratan con StateContext::processBatch. Esta función
+    * bloquea la tarea actual, por lo que normalmente se ejecutará en una tarea dedicada que sea la
+    * única que use el contexto.
+    */
+   template<typename T, typename Wait>
+   void feed( BasicSafeQueue<T, Wait>& aQueue )
+   {
+      theInputs.feed( *this, aQueue );
    }
 
    /**
-    * Cambia al estado <i>aState</i>.
+    * Cambia al estado <i>aState</i>, que se copia o se mueve según se pase. Si el estado que se
+    * abandona define la función onExit( Context& ), se llama antes del cambio; si el nuevo estado
+    * define onEnter( Context& ), se llama después. Ambas se resuelven en tiempo de compilación y no
+    * cuestan nada a los estados que no las definen.
     */
    template<typename S>
-   void changeState( const S& aState )
+   void changeState( S&& aState )
+   {
+      emplaceState<std::decay_t<S>>( std::forward<S>( aState ) );
+   }
+
+   /**
+    * Cambia al estado de tipo <i>S</i> construyéndolo en su lugar con los argumentos
+    * <i>aArgs</i>. Las funciones onExit y onEnter se llaman igual que en StateContext::changeState.
+    */
+   template<typename S, typename... Args>
+   void emplaceState( Args&&... aArgs )
+   {
+      exitState();
+      theState.template emplace<S>( std::forward<Args>( aArgs )... );
+      theEntered = true;
+      if constexpr( HasOnEnter<S, Context>::value )
+      {
+         std::get_if<S>( &theState )->onEnter( static_cast<Context&>( *this ) );
+      }
+   }
+
+   /**
+    * El tipo de las instantáneas de la máquina.
+    */
+   using Snapshot = StateSnapshot<States...>;
+
+   /**
+    * Guarda en <i>aSnapshot</i> el estado actual. Los estados deben copiarse trivialmente.
+    */
+   void snapshot( Snapshot& aSnapshot ) const
    {
-      theState = aState;
+      static_assert( ( std::is_trivially_copyable_v<States> && ... ),
+                     "StateContext: states must be trivially copyable to take snapshots" );
+      aSnapshot.theIndex = static_cast<std::uint32_t>( theState.index() );
+      std::visit( [&aSnapshot]( const auto& aState ) {
+                     std::memcpy( aSnapshot.thePayload, &aState, sizeof( aState ) );
+                  }, theState );
+   }
+
+   /**
+    * Recupera el estado guardado en <i>aSnapshot</i>, sin llamar a las funciones onExit ni
+    * onEnter. Devuelve false, sin cambiar de estado, si la instantánea no es válida.
+    */
+   bool restore( const Snapshot& aSnapshot )
+   {
+      if( aSnapshot.theIndex >= sizeof...( States ) )
+      {
+         return false;
+      }
+
+      static constexpr Load theLoads[] = { &loadState<States>... };
+      theLoads[aSnapshot.theIndex]( theState, aSnapshot.thePayload );
+      theEntered = true;
+      return true;
    }
 
 private:
 
+   /**
+    * Función de la tabla de StateContext::restore.
+    */
+   using Load = void ( * )( std::variant<States...>&, const unsigned char* );
+
+   template<typename S>
+   static void loadState( std::variant<States...>& aState, const unsigned char* aPayload )
+   {
+      aState.template emplace<S>( *reinterpret_cast<const S*>( aPayload ) );
+   }
+
+   /**
+    * Entrega la entrada <i>anInput</i> al estado actual. Si la política de la máquina es Traced,
+    * además la registra en la traza.
+    */
+   template<typename T>
+   void dispatch( T&& anInput )
+   {
+      if constexpr( std::is_base_of_v<TracedPolicy, UnhandledPolicy<std::tuple<States...>>> )
+      {
+         const std::size_t aFrom = theState.index();
+         const std::uint64_t aStart = this->traceClock();
+         handleCurrent( std::forward<T>( anInput ) );
+         this->template traceInput<std::decay_t<T>>( static_cast<Context*>( this ), aFrom,
+                                                     theState.index(), aStart );
+      }
+      else
+      {
+         handleCurrent( std::forward<T>( anInput ) );
+      }
+   }
+
+   /**
+    * Entrega la entrada <i>anInput</i> al estado actual, sin registrarla en la traza. Igual que
+    * std::visit, lanza std::bad_variant_access si no hay estado actual porque un cambio de estado
+    * terminó con una excepción.
+    */
+   template<typename T>
+   void handleCurrent( T&& anInput )
+   {
+      if( theState.valueless_by_exception() )
+      {
+         throw std::bad_variant_access{};
+      }
+
+      static constexpr Handler<T> theHandlers[] = { &handleInput<States, T>... };
+      theHandlers[theState.index()]( static_cast<Context&>( *this ), theState,
+                                     std::forward<T>( anInput ) );
+   }
+
+   /**
+    * Llama a la función onExit del estado actual, si la define.
+    */
+   void exitState()
+   {
+      if constexpr( ( HasOnExit<States, Context>::value || ... ) )
+      {
+         if( theEntered && !theState.valueless_by_exception() )
+         {
+            static constexpr Exit theExits[] = { &exitFrom<States>... };
+            theExits[theState.index()]( static_cast<Context&>( *this ), theState );
+         }
+      }
+   }
+
+   /**
+    * Función de la tabla de BasicStateContext::exitState.
+    */
+   using Exit = void ( * )( Context&, std::variant<States...>& );
+
+   /**
+    * Llama a la función onExit del estado <i>S</i>, que es el actual, si la define.
+    */
+   template<typename S>
+   static void exitFrom( Context& aContext, std::variant<States...>& aState )
+   {
+      if constexpr( HasOnExit<S, Context>::value )
+      {
+         std::get_if<S>( &aState )->onExit( aContext );
+      }
+   }
+
+   friend class RunToCompletion<BasicStateContext>;
+
+   /**
+    * Función de la tabla de StateContext::delegate para la entrada de tipo <i>T</i>.
+    */
+   template<typename T>
+   using Handler = void ( * )( Context&, std::variant<States...>&, T&& );
+
+   /**
+    * Trata la entrada <i>anInput</i> en el estado <i>S</i>, que es el actual, o en el primero de
+    * sus superestados que la trate.
+    */
+   template<typename S, typename T>
+   static void handleInput( Context& aContext, std::variant<States...>& aState, T&& anInput )
+   {
+      if constexpr( CanHandle<S, std::decay_t<T>>::value )
+      {
+         using Handler = typename HandlerOf<S, std::decay_t<T>>::Types;
+         const Handler& aHandler = *std::get_if<S>( &aState );
+         aHandler.handle( aContext, std::forward<T>( anInput ) );
+      }
+      else
+      {
+         static_cast<BasicStateContext&>( aContext ).template unhandled<S, std::decay_t<T>>();
+      }
+   }
+
    /**
     * Los estados que componen la máquina.
     */
    std::variant<States...> theState;
+
+   /**
+    * Las entradas encoladas con StateContext::post pendientes de tratar.
+    */
+   RunToCompletion<BasicStateContext> theInputs;
+
+   /**
+    * Indica si ya se ha entrado en algún estado, es decir, si el estado actual no es el construido
+    * por defecto.
+    */
+   bool theEntered{};
 };
 
+/**
+ * Contexto de la máquina de estados que informa por la salida de error de las entradas que no
+ * puede tratar.
+ */
+template<typename Context, typename... States>
+using StateContext = BasicStateContext<ReportUnhandled, Context, States...>;
+
 #endif
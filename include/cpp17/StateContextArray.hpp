@@ -0,0 +1,554 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_STATE_CONTEXT_ARRAY_HPP_
+#define INCLUDE_GENERIC_PATTERNS_STATE_CONTEXT_ARRAY_HPP_
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "State.hpp"
+
+/**
+ * @brief Conjunto de máquinas de estados independientes.
+ *
+ * La plantilla StateContextArray gestiona un gran número de máquinas de estados iguales, por
+ * ejemplo, una por conexión, sin crear un objeto StateContext por cada una. Los datos se guardan
+ * como estructura de vectores: un vector con el índice del estado actual de cada máquina, otro con
+ * los datos de tipo <i>Context</i> de cada una y, solo para los estados con datos miembro, un
+ * vector por estado.
+ *
+ * Las máquinas se identifican por su posición, devuelta por StateContextArray::add. Las funciones
+ * handle de los estados reciben como contexto un StateContextArray::Instance, que da acceso a los
+ * datos de la máquina y a su función changeState:
+ *
+ * @code
+   class Listening : public State<Segment>
+   {
+   public:
+      template<typename C>
+      void handle( C& aConnection, const Segment& aSegment ) const
+      {
+         aConnection->theReceived += aSegment.size();
+         aConnection.changeState( Receiving{} );
+      }
+   };
+
+   StateContextArray<Connection, Listening, Receiving> aConnections;
+   std::size_t anId = aConnections.add( Connection{}, Listening{} );
+   @endcode
+ *
+ * La función StateContextArray::processBatch trata de una vez un lote de pares (máquina, entrada),
+ * agrupándolos por el estado actual de cada máquina para que todas las entradas de un mismo estado
+ * se traten seguidas sin pasar por la tabla de estados. Las máquinas pueden repartirse en
+ * particiones contiguas que se tratan en paralelo: cada máquina pertenece a una única partición, por
+ * lo que sus entradas se tratan siempre en orden y por una sola tarea. Las tareas de las
+ * particiones se crean la primera vez que se necesitan y se reutilizan en los lotes siguientes.
+ * Las entradas dirigidas a máquinas que no existen se descartan.
+ *
+ * El conjunto puede moverse pero no copiarse, y solo una tarea a la vez debe usarlo.
+ *
+ * Los estados deben poder construirse por defecto.
+ */
+template<template<typename> class UnhandledPolicy, typename Context, typename... States>
+class BasicStateContextArray : public UnhandledPolicy<std::tuple<States...>>
+{
+public:
+
+   /**
+    * El tipo del índice del estado actual de cada máquina.
+    */
+   using Index = std::conditional_t<sizeof...( States ) <= 0xFF, std::uint8_t, std::uint16_t>;
+
+   /**
+    * @brief Una máquina del conjunto.
+    *
+    * Es el contexto que reciben las funciones handle de los estados.
+    */
+   class Instance
+   {
+   public:
+
+      Instance( BasicStateContextArray& anArray, std::size_t anId )
+         :
+         theArray{ anArray },
+         theId{ anId }
+      {
+
+      }
+
+      /**
+       * Cambia la máquina al estado <i>aState</i>.
+       */
+      template<typename S>
+      void changeState( const S& aState )
+      {
+         theArray.changeState( theId, aState );
+      }
+
+      /**
+       * Devuelve los datos de la máquina.
+       */
+      Context& context() const
+      {
+         return theArray.theContexts[theId];
+      }
+
+      Context* operator->() const
+      {
+         return &context();
+      }
+
+      /**
+       * Devuelve la posición de la máquina en el conjunto.
+       */
+      std::size_t id() const
+      {
+         return theId;
+      }
+
+   private:
+
+      BasicStateContextArray& theArray;
+      std::size_t theId;
+   };
+
+   /**
+    * Añade una máquina con los datos <i>aContext</i> y el estado inicial <i>aState</i>, y devuelve
+    * su posición en el conjunto.
+    */
+   template<typename S>
+   std::size_t add( Context aContext, const S& aState )
+   {
+      const std::size_t anId = theContexts.size();
+      theContexts.push_back( std::move( aContext ) );
+      theIndices.push_back( 0 );
+      std::apply( []( auto&... aStorage ) { ( aStorage.push_back( {} ), ... ); }, theStates );
+      changeState( anId, aState );
+      return anId;
+   }
+
+   /**
+    * Cambia la máquina de posición <i>anId</i> al estado <i>aState</i>.
+    */
+   template<typename S>
+   void changeState( std::size_t anId, const S& aState )
+   {
+      theIndices[anId] = static_cast<Index>( TupleIndex<S, std::tuple<States...>>::value );
+      if constexpr( !std::is_empty_v<S> )
+      {
+         std::get<std::vector<S>>( theStates )[anId] = aState;
+      }
+   }
+
+   /**
+    * Devuelve la posición, entre los estados de la plantilla, del estado actual de la máquina de
+    * posición <i>anId</i>.
+    */
+   std::size_t stateOf( std::size_t anId ) const
+   {
+      return theIndices[anId];
+   }
+
+   /**
+    * Devuelve los datos de la máquina de posición <i>anId</i>.
+    */
+   Context& operator[]( std::size_t anId )
+   {
+      return theContexts[anId];
+   }
+
+   /**
+    * Devuelve el número de máquinas.
+    */
+   std::size_t size() const
+   {
+      return theContexts.size();
+   }
+
+   /**
+    * Delega el tratamiento de los datos de entrada <i>anInput</i> al estado actual de la máquina
+    * de posición <i>anId</i>. Devuelve false, sin tratar la entrada, si la máquina no existe.
+    */
+   template<typename T>
+   bool delegate( std::size_t anId, T&& anInput )
+   {
+      if( anId >= theContexts.size() )
+      {
+         return false;
+      }
+
+      static constexpr Handler<T> theHandlers[] = { &handleInput<States, T>... };
+      theHandlers[theIndices[anId]]( *this, anId, std::forward<T>( anInput ) );
+      return true;
+   }
+
+   /**
+    * Trata el lote de entradas [<i>aFirst</i>, <i>aLast</i>), cuyos elementos son pares con la
+    * posición de la máquina como primer miembro y la entrada como segundo, repartiendo las
+    * máquinas en <i>aPartitions</i> particiones que se tratan en paralelo. Las entradas de una
+    * misma máquina se tratan en el orden del lote. Devuelve el número de entradas descartadas por
+    * estar dirigidas a máquinas que no existen.
+    */
+   template<typename Iterator>
+   std::size_t processBatch( Iterator aFirst, Iterator aLast, std::size_t aPartitions = 1 )
+   {
+      using Item = std::remove_reference_t<decltype( *aFirst )>;
+
+      if( aPartitions == 0 )
+      {
+         aPartitions = 1;
+      }
+
+      const std::size_t aSize = theContexts.size();
+      const std::size_t aPartitionSize = ( aSize + aPartitions - 1 ) / aPartitions;
+      std::size_t aDiscarded = 0;
+      std::vector<std::vector<Item*>> aBatches( aPartitions );
+      for( ; aFirst != aLast; ++aFirst )
+      {
+         const std::size_t anId = aFirst->first;
+         if( anId >= aSize )
+         {
+            ++aDiscarded;
+            continue;
+         }
+
+         aBatches[anId / aPartitionSize].push_back( &*aFirst );
+      }
+
+      if( theOccurrences.size() < aSize )
+      {
+         theOccurrences.resize( aSize );
+      }
+
+      if( aPartitions > 1 )
+      {
+         if( !theWorkers )
+         {
+            theWorkers = std::make_unique<Workers>();
+         }
+
+         theWorkers->run( aPartitions - 1, [this, &aBatches]( std::size_t i ) { processPartition( aBatches[i + 1] ); } );
+      }
+
+      try
+      {
+         processPartition( aBatches[0] );
+      }
+      catch( ... )
+      {
+         if( aPartitions > 1 )
+         {
+            theWorkers->wait( std::nothrow );
+         }
+
+         throw;
+      }
+
+      if( aPartitions > 1 )
+      {
+         theWorkers->wait();
+      }
+
+      return aDiscarded;
+   }
+
+private:
+
+   /**
+    * Las tareas que tratan las particiones, salvo la primera, que trata la tarea que llama a
+    * StateContextArray::processBatch.
+    */
+   class Workers
+   {
+   public:
+
+      Workers() = default;
+
+      Workers( const Workers& ) = delete;
+
+      Workers& operator=( const Workers& ) = delete;
+
+      ~Workers()
+      {
+         {
+            std::unique_lock<std::mutex> aLock( theMutex );
+            theStopping = true;
+            theStart.notify_all();
+         }
+
+         for( std::thread& aThread : theThreads )
+         {
+            aThread.join();
+         }
+      }
+
+      /**
+       * Hace que las tareas traten las particiones [0, <i>aCount</i>) con la función
+       * <i>aTask</i>, creando las tareas que falten.
+       */
+      void run( std::size_t aCount, std::function<void( std::size_t )> aTask )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         while( theThreads.size() < aCount )
+         {
+            theThreads.emplace_back( [this, i = theThreads.size(), aGeneration = theGeneration] { work( i, aGeneration ); } );
+         }
+
+         theTask = std::move( aTask );
+         theActive = aCount;
+         thePending = aCount;
+         ++theGeneration;
+         theStart.notify_all();
+      }
+
+      /**
+       * Espera a que las tareas terminen las particiones de StateContextArray::Workers::run y
+       * relanza la primera excepción que haya lanzado alguna de ellas.
+       */
+      void wait()
+      {
+         std::exception_ptr anError = wait( std::nothrow );
+         if( anError )
+         {
+            std::rethrow_exception( anError );
+         }
+      }
+
+      /**
+       * Espera a que las tareas terminen y devuelve, sin lanzarla, la primera excepción.
+       */
+      std::exception_ptr wait( const std::nothrow_t& )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theDone.wait( aLock, [this] { return thePending == 0; } );
+         return std::exchange( theError, nullptr );
+      }
+
+   private:
+
+      void work( std::size_t anIndex, std::uint64_t aGeneration )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         for( ;; )
+         {
+            theStart.wait( aLock, [this, aGeneration] { return theStopping || theGeneration != aGeneration; } );
+            if( theStopping )
+            {
+               return;
+            }
+
+            aGeneration = theGeneration;
+            if( anIndex < theActive )
+            {
+               aLock.unlock();
+               std::exception_ptr anError;
+               try
+               {
+                  theTask( anIndex );
+               }
+               catch( ... )
+               {
+                  anError = std::current_exception();
+               }
+
+               aLock.lock();
+               if( anError && !theError )
+               {
+                  theError = anError;
+               }
+
+               if( --thePending == 0 )
+               {
+                  theDone.notify_one();
+               }
+            }
+         }
+      }
+
+      std::mutex theMutex;
+      std::condition_variable theStart;
+      std::condition_variable theDone;
+      std::vector<std::thread> theThreads;
+      std::function<void( std::size_t )> theTask;
+      std::exception_ptr theError;
+      std::uint64_t theGeneration{};
+      std::size_t theActive{};
+      std::size_t thePending{};
+      bool theStopping{};
+   };
+
+   /**
+    * Sustituye al vector de datos de los estados que carecen de ellos.
+    */
+   template<typename S>
+   struct NoStorage
+   {
+      void push_back( const S& ) {}
+   };
+
+   /**
+    * Los datos de cada máquina para el estado <i>S</i>.
+    */
+   template<typename S>
+   using Storage = std::conditional_t<std::is_empty_v<S>, NoStorage<S>, std::vector<S>>;
+
+   /**
+    * Función de la tabla de StateContextArray::delegate para la entrada de tipo <i>T</i>.
+    */
+   template<typename T>
+   using Handler = void ( * )( BasicStateContextArray&, std::size_t, T&& );
+
+   /**
+    * Trata la entrada <i>anInput</i> de la máquina de posición <i>anId</i> en el estado <i>S</i>,
+    * que es el actual.
+    */
+   template<typename S, typename T>
+   static void handleInput( BasicStateContextArray& anArray, std::size_t anId, T&& anInput )
+   {
+      if constexpr( CanHandle<S, std::decay_t<T>>::value )
+      {
+         using Handler = typename HandlerOf<S, std::decay_t<T>>::Types;
+         Instance anInstance{ anArray, anId };
+         const Handler& aHandler = anArray.template stateAt<S>( anId );
+         aHandler.handle( anInstance, std::forward<T>( anInput ) );
+      }
+      else
+      {
+         anArray.template unhandled<S, std::decay_t<T>>();
+      }
+   }
+
+   /**
+    * Devuelve el estado <i>S</i> de la máquina de posición <i>anId</i>.
+    */
+   template<typename S>
+   const S& stateAt( std::size_t anId ) const
+   {
+      if constexpr( std::is_empty_v<S> )
+      {
+         static const S theState{};
+         return theState;
+      }
+      else
+      {
+         return std::get<std::vector<S>>( theStates )[anId];
+      }
+   }
+
+   /**
+    * Trata las entradas <i>anItems</i> de una partición. Las entradas se reparten en rondas en las
+    * que cada máquina aparece como mucho una vez, y cada ronda se agrupa por el estado actual de
+    * las máquinas.
+    */
+   template<typename Item>
+   void processPartition( const std::vector<Item*>& anItems )
+   {
+      std::vector<std::vector<Item*>> aRounds;
+      for( Item* anItem : anItems )
+      {
+         const std::size_t aRound = theOccurrences[anItem->first]++;
+         if( aRound == aRounds.size() )
+         {
+            aRounds.emplace_back();
+         }
+
+         aRounds[aRound].push_back( anItem );
+      }
+
+      for( Item* anItem : anItems )
+      {
+         theOccurrences[anItem->first] = 0;
+      }
+
+      std::array<std::vector<Item*>, sizeof...( States )> aGroups;
+      for( const std::vector<Item*>& aRound : aRounds )
+      {
+         for( Item* anItem : aRound )
+         {
+            aGroups[theIndices[anItem->first]].push_back( anItem );
+         }
+
+         processGroups( aGroups, std::index_sequence_for<States...>() );
+      }
+   }
+
+   /**
+    * Trata los grupos <i>aGroups</i> de entradas, uno por estado, y los deja vacíos.
+    */
+   template<typename Item, std::size_t... Is>
+   void processGroups( std::array<std::vector<Item*>, sizeof...( States )>& aGroups,
+                       std::index_sequence<Is...> )
+   {
+      ( processGroup<States>( aGroups[Is] ), ... );
+   }
+
+   /**
+    * Trata en el estado <i>S</i> las entradas del grupo <i>aGroup</i> y lo deja vacío.
+    */
+   template<typename S, typename Item>
+   void processGroup( std::vector<Item*>& aGroup )
+   {
+      for( Item* anItem : aGroup )
+      {
+         handleInput<S>( *this, anItem->first, anItem->second );
+      }
+
+      aGroup.clear();
+   }
+
+   /**
+    * Los datos de cada máquina.
+    */
+   std::vector<Context> theContexts;
+
+   /**
+    * El índice del estado actual de cada máquina.
+    */
+   std::vector<Index> theIndices;
+
+   /**
+    * Los datos de cada máquina para cada estado con datos miembro.
+    */
+   std::tuple<Storage<States>...> theStates;
+
+   /**
+    * Apariciones de cada máquina en el lote que se está repartiendo en rondas.
+    */
+   std::vector<std::uint32_t> theOccurrences;
+
+   /**
+    * Las tareas de las particiones, que se crean con el primer lote que las necesita.
+    */
+   std::unique_ptr<Workers> theWorkers;
+};
+
+/**
+ * Conjunto de máquinas de estados que informa por la salida de error de las entradas que no
+ * pueden tratar.
+ */
+template<typename Context, typename... States>
+using StateContextArray = BasicStateContextArray<ReportUnhandled, Context, States...>;
+
+#endif
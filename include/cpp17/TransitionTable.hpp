@@ -0,0 +1,281 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2019 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_TRANSITION_TABLE_HPP_
+#define INCLUDE_GENERIC_PATTERNS_TRANSITION_TABLE_HPP_
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "State.hpp"
+
+/** @cond */
+
+// La tupla Result ampliada con los tipos Ts que aún no contiene.
+template <typename Result, typename... Ts>
+struct UniqueImpl
+{
+   using Types = Result;
+};
+
+template <typename... Rs, typename T, typename... Ts>
+struct UniqueImpl<std::tuple<Rs...>, T, Ts...>
+   : UniqueImpl<std::conditional_t<HasType<T, std::tuple<Rs...>>::value, std::tuple<Rs...>, std::tuple<Rs..., T>>, Ts...> {};
+
+// Los tipos Ts sin repetir, en el orden de su primera aparición.
+template <typename... Ts>
+using Unique = typename UniqueImpl<std::tuple<>, Ts...>::Types;
+
+// La transición de la lista Ts que parte del estado From con la entrada Input, o void si no hay.
+template <typename From, typename Input, typename... Ts>
+struct FindTransition
+{
+   using Types = void;
+};
+
+template <typename From, typename Input, typename T, typename... Ts>
+struct FindTransition<From, Input, T, Ts...>
+{
+   using Types = std::conditional_t<std::is_same_v<typename T::FromState, From> &&
+                                    std::is_same_v<typename T::InputType, Input>,
+                                    T, typename FindTransition<From, Input, Ts...>::Types>;
+};
+
+/** @endcond */
+
+/**
+ * @brief Acción vacía de una transición.
+ */
+struct NoAction
+{
+   template<typename Context, typename Input>
+   void operator()( Context&, const Input& ) const {}
+};
+
+/**
+ * @brief Una transición de la máquina de estados.
+ *
+ * Declara que, en el estado <i>From</i>, la entrada de tipo <i>Input</i> ejecuta la acción
+ * <i>Action</i> y lleva al estado <i>To</i>. La acción es un tipo que se construye por defecto y
+ * define el operador de llamada con el contexto y la entrada como argumentos.
+ */
+template<typename From, typename Input, typename To, typename Action = NoAction>
+struct Transition
+{
+   using FromState = From;
+   using InputType = Input;
+   using ToState = To;
+   using ActionType = Action;
+};
+
+/**
+ * @brief Tabla de transiciones de una máquina de estados.
+ *
+ * Los estados de la máquina son los que aparecen en las transiciones, y el estado inicial es el
+ * de partida de la primera.
+ */
+template<typename... Transitions>
+struct TransitionTable
+{
+   using States = Unique<typename Transitions::FromState..., typename Transitions::ToState...>;
+   using Inputs = Unique<typename Transitions::InputType...>;
+};
+
+/**
+ * @brief Contexto de una máquina de estados declarada mediante una tabla de transiciones.
+ *
+ * Es la alternativa declarativa a StateContext: en lugar de repartir las transiciones entre las
+ * funciones handle de los estados, se declaran todas en una TransitionTable. Los estados son
+ * simples tipos etiqueta y el contexto solo guarda la posición del estado actual.
+ *
+ * @code
+   struct Closed {}; struct Listening {}; struct Established {};
+   struct Open {}; struct Synchronize {}; struct Close {};
+
+   using TcpTable = TransitionTable<Transition<Closed, Open, Listening>,
+                                    Transition<Listening, Synchronize, Established, SendAck>,
+                                    Transition<Established, Close, Closed>>;
+
+   class TcpConnection : public TableStateContext<TcpConnection, TcpTable>
+   {
+      ...
+   };
+   @endcode
+ *
+ * La tabla se comprueba en tiempo de compilación: es un error que dos transiciones partan del
+ * mismo estado con la misma entrada, que haya estados inalcanzables desde el inicial y que se
+ * delegue una entrada que no aparece en ninguna transición. Las entradas que el estado actual no
+ * trata se entregan a la política <i>UnhandledPolicy</i>; con RejectUnhandled, la tabla debe
+ * cubrir todas las combinaciones de estado y entrada que se deleguen.
+ *
+ * Para cada tipo de entrada, la tabla se convierte en un vector constante con una función por
+ * estado que ejecuta la acción y fija el estado siguiente.
+ */
+template<template<typename> class UnhandledPolicy, typename Context, typename Table>
+class BasicTableStateContext;
+
+template<template<typename> class UnhandledPolicy, typename Context, typename... Transitions>
+class BasicTableStateContext<UnhandledPolicy, Context, TransitionTable<Transitions...>>
+   : public UnhandledPolicy<typename TransitionTable<Transitions...>::States>
+{
+public:
+
+   /**
+    * Los estados de la máquina.
+    */
+   using States = typename TransitionTable<Transitions...>::States;
+
+   /**
+    * Las entradas de la máquina.
+    */
+   using Inputs = typename TransitionTable<Transitions...>::Inputs;
+
+   /**
+    * Delega el tratamiento de los datos de entrada <i>anInput</i> en la transición que parte del
+    * estado actual.
+    */
+   template<typename T>
+   void delegate( T&& anInput )
+   {
+      static_assert( HasType<std::decay_t<T>, Inputs>::value,
+                     "TableStateContext: no transition takes this input type" );
+      static constexpr auto theHandlers = makeHandlers<T>( std::make_index_sequence<theStateCount>() );
+      theHandlers[theState]( static_cast<Context&>( *this ), theState, std::forward<T>( anInput ) );
+   }
+
+   /**
+    * Indica si el estado actual es <i>S</i>.
+    */
+   template<typename S>
+   bool isIn() const
+   {
+      return theState == TupleIndex<S, States>::value;
+   }
+
+private:
+
+   /**
+    * Número de estados de la máquina.
+    */
+   static constexpr std::size_t theStateCount = std::tuple_size_v<States>;
+
+   /**
+    * Indica si dos transiciones parten del mismo estado con la misma entrada.
+    */
+   static constexpr bool hasDuplicates()
+   {
+      constexpr std::array<std::size_t, sizeof...( Transitions )> aFrom{
+         TupleIndex<typename Transitions::FromState, States>::value... };
+      constexpr std::array<std::size_t, sizeof...( Transitions )> anInput{
+         TupleIndex<typename Transitions::InputType, Inputs>::value... };
+      for( std::size_t i = 0; i < aFrom.size(); ++i )
+      {
+         for( std::size_t j = i + 1; j < aFrom.size(); ++j )
+         {
+            if( aFrom[i] == aFrom[j] && anInput[i] == anInput[j] )
+            {
+               return true;
+            }
+         }
+      }
+
+      return false;
+   }
+
+   /**
+    * Indica si todos los estados son alcanzables desde el inicial.
+    */
+   static constexpr bool isConnected()
+   {
+      constexpr std::array<std::size_t, sizeof...( Transitions )> aFrom{
+         TupleIndex<typename Transitions::FromState, States>::value... };
+      constexpr std::array<std::size_t, sizeof...( Transitions )> aTo{
+         TupleIndex<typename Transitions::ToState, States>::value... };
+      std::array<bool, theStateCount> isReached{};
+      isReached[0] = true;
+      for( bool isChanged = true; isChanged; )
+      {
+         isChanged = false;
+         for( std::size_t i = 0; i < aFrom.size(); ++i )
+         {
+            if( isReached[aFrom[i]] && !isReached[aTo[i]] )
+            {
+               isReached[aTo[i]] = true;
+               isChanged = true;
+            }
+         }
+      }
+
+      for( bool aReached : isReached )
+      {
+         if( !aReached )
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   static_assert( !hasDuplicates(), "TableStateContext: two transitions share state and input" );
+   static_assert( isConnected(), "TableStateContext: some states are unreachable" );
+
+   /**
+    * Función de la tabla de TableStateContext::delegate para la entrada de tipo <i>T</i>.
+    */
+   template<typename T>
+   using Handler = void ( * )( Context&, std::size_t&, T&& );
+
+   /**
+    * Genera la tabla de TableStateContext::delegate para la entrada de tipo <i>T</i>.
+    */
+   template<typename T, std::size_t... Is>
+   static constexpr std::array<Handler<T>, theStateCount> makeHandlers( std::index_sequence<Is...> )
+   {
+      return { &handleInput<std::tuple_element_t<Is, States>, T>... };
+   }
+
+   /**
+    * Ejecuta la transición que parte del estado <i>S</i> con la entrada <i>anInput</i>.
+    */
+   template<typename S, typename T>
+   static void handleInput( Context& aContext, std::size_t& aState, T&& anInput )
+   {
+      using Found = typename FindTransition<S, std::decay_t<T>, Transitions...>::Types;
+      if constexpr( std::is_void_v<Found> )
+      {
+         static_cast<BasicTableStateContext&>( aContext ).template unhandled<S, std::decay_t<T>>();
+      }
+      else
+      {
+         typename Found::ActionType{}( aContext, std::forward<T>( anInput ) );
+         aState = TupleIndex<typename Found::ToState, States>::value;
+      }
+   }
+
+   /**
+    * La posición del estado actual.
+    */
+   std::size_t theState{};
+};
+
+/**
+ * Contexto de una máquina de estados declarada mediante una tabla de transiciones que informa por
+ * la salida de error de las entradas que no puede tratar.
+ */
+template<typename Context, typename Table>
+using TableStateContext = BasicTableStateContext<ReportUnhandled, Context, Table>;
+
+#endif
@@ -0,0 +1,681 @@
+//-------------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2020 Jorge Rodríguez Santos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so
+//-------------------------------------------------------------------------------
+
+#ifndef INCLUDE_GENERIC_PATTERNS_LOAD_GENERATOR_HPP_
+#define INCLUDE_GENERIC_PATTERNS_LOAD_GENERATOR_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "cpp14/AsyncQueue.hpp"
+#include "cpp14/Courier.hpp"
+#include "cpp14/Deliverable.hpp"
+#include "cpp14/LatencyHistogram.hpp"
+#include "cpp14/Publisher.hpp"
+#include "cpp14/Subscriber.hpp"
+
+/**
+ * @brief Configuración de una prueba de carga.
+ */
+struct LoadConfig
+{
+   /**
+    * Número de tareas que envían mensajes.
+    */
+   int theProducers{ 4 };
+
+   /**
+    * Número de destinatarios: colas, mensajeros o suscriptores.
+    */
+   int theDestinations{ 4 };
+
+   /**
+    * Tiempo durante el que se envían mensajes.
+    */
+   std::chrono::milliseconds theDuration{ 1000 };
+
+   /**
+    * Número de mensajes que cada tarea envía seguidos antes de descansar.
+    */
+   int theBurst{ 1 };
+
+   /**
+    * Descanso entre ráfagas.
+    */
+   std::chrono::microseconds thePause{ 0 };
+
+   /**
+    * Pesos de los mensajes pequeños, medianos y grandes.
+    */
+   unsigned theMix[3]{ 8, 1, 1 };
+
+   /**
+    * Tiempo máximo de espera, tras el envío, hasta que lleguen todos los mensajes.
+    */
+   std::chrono::milliseconds theDrainTimeout{ 5000 };
+};
+
+/**
+ * @brief Resultado de una prueba de carga.
+ */
+struct LoadReport
+{
+   /**
+    * Número de entregas esperadas: cada mensaje cuenta una vez por destinatario que debe
+    * recibirlo.
+    */
+   std::uint64_t theExpected;
+
+   /**
+    * Número de entregas recibidas, incluidas las repetidas.
+    */
+   std::uint64_t theReceived;
+
+   /**
+    * Número de entregas esperadas que no llegaron.
+    */
+   std::uint64_t theLost;
+
+   /**
+    * Número de entregas recibidas más de una vez.
+    */
+   std::uint64_t theDuplicated;
+
+   /**
+    * Número de entregas que llegaron después de otra posterior del mismo remitente.
+    */
+   std::uint64_t theReordered;
+
+   /**
+    * Número de entregas cuyo contenido no coincide con su suma de verificación.
+    */
+   std::uint64_t theCorrupted;
+
+   /**
+    * Duración de la prueba, desde el primer envío hasta la última entrega, en segundos.
+    */
+   double theSeconds;
+
+   /**
+    * Cotas, en nanosegundos, de la mediana, de los percentiles 99 y 99,9 y del máximo de la
+    * espera entre el envío y la entrega.
+    */
+   std::uint64_t theMedian;
+   std::uint64_t the99th;
+   std::uint64_t the999th;
+   std::uint64_t theMaximum;
+
+   /**
+    * Devuelve las entregas por segundo.
+    */
+   double throughput() const
+   {
+      return theSeconds > 0 ? theReceived / theSeconds : 0;
+   }
+
+   /**
+    * Indica si todas las entregas llegaron una vez, en orden y completas.
+    */
+   bool isClean() const
+   {
+      return theLost == 0 && theDuplicated == 0 && theReordered == 0 && theCorrupted == 0;
+   }
+
+   /**
+    * Escribe el resultado en <i>anOutput</i> como un objeto JSON en una línea.
+    */
+   void print( std::ostream& anOutput, const char* aTarget ) const
+   {
+      anOutput << "{\"target\":\"" << aTarget << "\",\"expected\":" << theExpected << ",\"received\":" << theReceived
+               << ",\"lost\":" << theLost << ",\"duplicated\":" << theDuplicated << ",\"reordered\":" << theReordered
+               << ",\"corrupted\":" << theCorrupted << ",\"seconds\":" << theSeconds << ",\"throughput\":" << throughput()
+               << ",\"p50_ns\":" << theMedian << ",\"p99_ns\":" << the99th << ",\"p999_ns\":" << the999th
+               << ",\"max_ns\":" << theMaximum << "}\n";
+   }
+};
+
+/**
+ * @brief Mensaje de una prueba de carga.
+ *
+ * Lleva el remitente, un número de secuencia por remitente y destinatario, el instante de envío y
+ * una carga útil de 16, 64 o 256 bytes según su tipo, protegida por una suma de verificación.
+ */
+struct LoadMessage
+{
+   static constexpr std::size_t theSizes[3] = { 16, 64, 256 };
+
+   /**
+    * Rellena la carga útil y calcula su suma de verificación.
+    */
+   void seal()
+   {
+      for( std::size_t i = 0; i < theSizes[theKind]; ++i )
+      {
+         thePayload[i] = static_cast<unsigned char>( theSequence + i );
+      }
+
+      theChecksum = checksum();
+   }
+
+   /**
+    * Indica si la carga útil coincide con la suma de verificación.
+    */
+   bool isIntact() const
+   {
+      return theKind < 3 && theChecksum == checksum();
+   }
+
+   std::uint32_t theProducer{};
+   std::uint32_t theKind{};
+   std::uint64_t theSequence{};
+   std::uint64_t theStamp{};
+   std::uint64_t theChecksum{};
+   unsigned char thePayload[256];
+
+private:
+
+   std::uint64_t checksum() const
+   {
+      std::uint64_t aHash = 0xCBF29CE484222325 ^ theProducer ^ ( theSequence << 8 );
+      for( std::size_t i = 0; i < theSizes[theKind]; ++i )
+      {
+         aHash = ( aHash ^ thePayload[i] ) * 0x100000001B3;
+      }
+
+      return aHash;
+   }
+};
+
+constexpr std::size_t LoadMessage::theSizes[3];
+
+/**
+ * @brief Destinatario de una prueba de carga.
+ *
+ * Comprueba cada mensaje que recibe y anota, por remitente, qué números de secuencia han llegado,
+ * de modo que distingue las repeticiones, los desórdenes y, al final, las pérdidas. Puede recibir
+ * mensajes desde varias tareas a la vez.
+ */
+class LoadSink
+{
+public:
+
+   LoadSink( int aProducers, BasicLatencyHistogram<3>& aLatency, std::atomic<std::uint64_t>& aReceived )
+      :
+      theStreams( static_cast<std::size_t>( aProducers ) ),
+      theLatency( aLatency ),
+      theReceived( aReceived )
+   {
+
+   }
+
+   /**
+    * Comprueba y anota el mensaje <i>aMessage</i>.
+    */
+   void receive( const LoadMessage& aMessage )
+   {
+      const std::uint64_t aNow = clock();
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theLast = aNow;
+         if( !aMessage.isIntact() || aMessage.theProducer >= theStreams.size() )
+         {
+            ++theCorrupted;
+         }
+         else
+         {
+            Stream& aStream = theStreams[aMessage.theProducer];
+            if( aMessage.theSequence >= aStream.theSeen.size() )
+            {
+               aStream.theSeen.resize( 2 * aMessage.theSequence + 1024 );
+            }
+
+            if( aStream.theSeen[aMessage.theSequence] )
+            {
+               ++theDuplicated;
+            }
+            else
+            {
+               aStream.theSeen[aMessage.theSequence] = true;
+               ++aStream.theUnique;
+               if( aMessage.theSequence < aStream.theHighest )
+               {
+                  ++theReordered;
+               }
+               else
+               {
+                  aStream.theHighest = aMessage.theSequence;
+               }
+            }
+         }
+      }
+
+      theLatency.record( aNow - aMessage.theStamp );
+      theReceived.fetch_add( 1, std::memory_order_release );
+   }
+
+   /**
+    * Devuelve el número de mensajes distintos recibidos del remitente <i>aProducer</i>.
+    */
+   std::uint64_t unique( int aProducer ) const
+   {
+      std::unique_lock<std::mutex> aLock( theMutex );
+      return theStreams[static_cast<std::size_t>( aProducer )].theUnique;
+   }
+
+   std::uint64_t duplicated() const
+   {
+      std::unique_lock<std::mutex> aLock( theMutex );
+      return theDuplicated;
+   }
+
+   std::uint64_t reordered() const
+   {
+      std::unique_lock<std::mutex> aLock( theMutex );
+      return theReordered;
+   }
+
+   std::uint64_t corrupted() const
+   {
+      std::unique_lock<std::mutex> aLock( theMutex );
+      return theCorrupted;
+   }
+
+   /**
+    * Devuelve el instante de la última entrega.
+    */
+   std::uint64_t last() const
+   {
+      std::unique_lock<std::mutex> aLock( theMutex );
+      return theLast;
+   }
+
+   /**
+    * Devuelve el instante actual en nanosegundos.
+    */
+   static std::uint64_t clock()
+   {
+      return static_cast<std::uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch() ).count() );
+   }
+
+private:
+
+   /**
+    * Los mensajes recibidos de un remitente.
+    */
+   struct Stream
+   {
+      std::vector<bool> theSeen;
+      std::uint64_t theHighest{};
+      std::uint64_t theUnique{};
+   };
+
+   mutable std::mutex theMutex;
+
+   std::vector<Stream> theStreams;
+
+   std::uint64_t theDuplicated{};
+
+   std::uint64_t theReordered{};
+
+   std::uint64_t theCorrupted{};
+
+   std::uint64_t theLast{};
+
+   BasicLatencyHistogram<3>& theLatency;
+
+   std::atomic<std::uint64_t>& theReceived;
+};
+
+/**
+ * @brief Destinos de la prueba de carga: AsyncQueue.
+ *
+ * Cada destinatario tiene su propia cola y cada remitente reparte sus mensajes entre todas.
+ */
+class AsyncQueueLoad
+{
+public:
+
+   static constexpr bool theFanOut = false;
+
+   static constexpr const char* theName = "AsyncQueue";
+
+   AsyncQueueLoad( std::vector<std::unique_ptr<LoadSink>>& aSinks, int )
+   {
+      for( auto& aSink : aSinks )
+      {
+         theQueues.emplace_back( new Queue{ Forward{ aSink.get() }, "LoadAsyncQueue" } );
+      }
+   }
+
+   void send( int, int aDestination, const LoadMessage& aMessage )
+   {
+      theQueues[static_cast<std::size_t>( aDestination )]->store( aMessage );
+   }
+
+private:
+
+   struct Forward
+   {
+      void operator()( LoadMessage aMessage )
+      {
+         theSink->receive( aMessage );
+      }
+
+      LoadSink* theSink;
+   };
+
+   using Queue = AsyncQueue<LoadMessage, Forward>;
+
+   std::vector<std::unique_ptr<Queue>> theQueues;
+};
+
+/**
+ * @brief Destinos de la prueba de carga: Courier.
+ *
+ * Cada destinatario tiene su propio mensajero y cada remitente reparte sus envíos entre todos.
+ */
+class CourierLoad
+{
+public:
+
+   static constexpr bool theFanOut = false;
+
+   static constexpr const char* theName = "Courier";
+
+   CourierLoad( std::vector<std::unique_ptr<LoadSink>>& aSinks, int )
+   {
+      for( auto& aSink : aSinks )
+      {
+         theCouriers.emplace_back( new Courier<LoadSink&>{ *aSink, "LoadCourier" } );
+      }
+   }
+
+   void send( int, int aDestination, const LoadMessage& aMessage )
+   {
+      theCouriers[static_cast<std::size_t>( aDestination )]->deliver( std::make_shared<Parcel>( aMessage ) );
+   }
+
+private:
+
+   struct Parcel : public Deliverable<LoadSink&>
+   {
+      explicit Parcel( const LoadMessage& aMessage ) : theMessage( aMessage ) {}
+
+      void deliver( LoadSink& aSink ) const override
+      {
+         aSink.receive( theMessage );
+      }
+
+      LoadMessage theMessage;
+   };
+
+   std::vector<std::unique_ptr<Courier<LoadSink&>>> theCouriers;
+};
+
+/**
+ * @brief Destinos de la prueba de carga: publicadores de tipo Model.
+ *
+ * Cada remitente tiene su propio publicador, al que están suscritos todos los destinatarios, por
+ * lo que cada mensaje llega a todos ellos. Los publicadores asíncronos entregan una copia del
+ * mensaje; los síncronos lo notifican desde la tarea del remitente.
+ */
+template<typename Model>
+class PublisherLoad
+{
+public:
+
+   static constexpr bool theFanOut = true;
+
+   static constexpr const char* theName = Model::theName;
+
+   PublisherLoad( std::vector<std::unique_ptr<LoadSink>>& aSinks, int aProducers )
+   {
+      for( auto& aSink : aSinks )
+      {
+         theViews.push_back( std::make_shared<View>( aSink.get() ) );
+      }
+
+      for( int i = 0; i < aProducers; ++i )
+      {
+         theModels.emplace_back( new Model );
+         theModels.back()->start();
+         for( auto& aView : theViews )
+         {
+            theModels.back()->attach( aView );
+         }
+      }
+   }
+
+   void send( int aProducer, int, const LoadMessage& aMessage )
+   {
+      Model& aModel = *theModels[static_cast<std::size_t>( aProducer )];
+      aModel.theMessage = aMessage;
+      aModel.publish();
+   }
+
+private:
+
+   struct View : public Subscriber<Model>
+   {
+      explicit View( LoadSink* aSink ) : theSink{ aSink } {}
+
+      void update( const Model& aModel ) override
+      {
+         theSink->receive( aModel.theMessage );
+      }
+
+      LoadSink* theSink;
+   };
+
+   std::vector<std::shared_ptr<View>> theViews;
+
+   std::vector<std::unique_ptr<Model>> theModels;
+};
+
+/**
+ * Mensaje de un publicador asíncrono, que se entrega copiado.
+ */
+struct AsyncLoadModel : public AsyncPublisher<AsyncLoadModel>
+{
+   static constexpr const char* theName = "AsyncPublisher";
+
+   void publish()
+   {
+      deliver();
+   }
+
+   LoadMessage theMessage;
+};
+
+/**
+ * Mensaje de un publicador síncrono.
+ */
+struct SyncLoadModel : public SyncPublisher<SyncLoadModel>
+{
+   static constexpr const char* theName = "SyncPublisher";
+
+   void start() {}
+
+   void publish()
+   {
+      notify();
+   }
+
+   LoadMessage theMessage;
+};
+
+/**
+ * @brief Generador de carga.
+ *
+ * La clase LoadGenerator pone en marcha las tareas remitentes de la configuración, que envían
+ * ráfagas de mensajes de tipos mezclados a los destinatarios de <i>Target</i> durante el tiempo
+ * indicado, espera a que lleguen y devuelve el rendimiento, la espera y las anomalías: mensajes
+ * perdidos, repetidos, desordenados o corruptos.
+ *
+ * @code
+ * LoadConfig aConfig;
+ * aConfig.theProducers = 8;
+ * LoadReport aReport = LoadGenerator{ aConfig }.run<CourierLoad>();
+ * @endcode
+ *
+ * Los destinos disponibles son AsyncQueueLoad, CourierLoad, PublisherLoad<AsyncLoadModel> y
+ * PublisherLoad<SyncLoadModel>. Toda la sincronización es explícita, por lo que la prueba puede
+ * ejecutarse con ThreadSanitizer.
+ */
+class LoadGenerator
+{
+public:
+
+   explicit LoadGenerator( const LoadConfig& aConfig )
+      :
+      theConfig( aConfig )
+   {
+
+   }
+
+   /**
+    * Ejecuta la prueba sobre los destinos de tipo <i>Target</i>.
+    */
+   template<typename Target>
+   LoadReport run()
+   {
+      BasicLatencyHistogram<3> aLatency;
+      std::atomic<std::uint64_t> aReceived{};
+      std::vector<std::unique_ptr<LoadSink>> aSinks;
+      for( int i = 0; i < theConfig.theDestinations; ++i )
+      {
+         aSinks.emplace_back( new LoadSink{ theConfig.theProducers, aLatency, aReceived } );
+      }
+
+      // Por cada remitente, el número de mensajes enviados a cada destinatario.
+      std::vector<std::vector<std::uint64_t>> aSent( static_cast<std::size_t>( theConfig.theProducers ),
+                                                     std::vector<std::uint64_t>( aSinks.size() ) );
+      const std::uint64_t aStart = LoadSink::clock();
+      {
+         Target aTarget( aSinks, theConfig.theProducers );
+         std::vector<std::thread> aProducers;
+         for( int i = 0; i < theConfig.theProducers; ++i )
+         {
+            aProducers.emplace_back( [this, &aTarget, &aSent, i] { produce<Target>( aTarget, i, aSent[i] ); } );
+         }
+
+         for( auto& aProducer : aProducers )
+         {
+            aProducer.join();
+         }
+
+         const std::uint64_t anExpected = expected<Target>( aSent );
+         const auto aDeadline = std::chrono::steady_clock::now() + theConfig.theDrainTimeout;
+         while( aReceived.load( std::memory_order_acquire ) < anExpected && std::chrono::steady_clock::now() < aDeadline )
+         {
+            std::this_thread::sleep_for( std::chrono::microseconds{ 100 } );
+         }
+      }
+
+      LoadReport aReport{};
+      aReport.theExpected = expected<Target>( aSent );
+      aReport.theReceived = aReceived.load();
+      std::uint64_t aLast = aStart;
+      for( std::size_t d = 0; d < aSinks.size(); ++d )
+      {
+         for( int p = 0; p < theConfig.theProducers; ++p )
+         {
+            const std::uint64_t aCount = Target::theFanOut ? aSent[p][0] : aSent[p][d];
+            const std::uint64_t aUnique = aSinks[d]->unique( p );
+            aReport.theLost += aCount > aUnique ? aCount - aUnique : 0;
+         }
+
+         aReport.theDuplicated += aSinks[d]->duplicated();
+         aReport.theReordered += aSinks[d]->reordered();
+         aReport.theCorrupted += aSinks[d]->corrupted();
+         aLast = std::max( aLast, aSinks[d]->last() );
+      }
+
+      aReport.theSeconds = ( aLast - aStart ) / 1e9;
+      aReport.theMedian = aLatency.quantile( 0.5 );
+      aReport.the99th = aLatency.quantile( 0.99 );
+      aReport.the999th = aLatency.quantile( 0.999 );
+      aReport.theMaximum = aLatency.quantile( 1.0 );
+      return aReport;
+   }
+
+private:
+
+   /**
+    * Tarea remitente <i>aProducer</i>: envía ráfagas hasta que termina el tiempo de la prueba y
+    * anota en <i>aSent</i> los mensajes enviados a cada destinatario.
+    */
+   template<typename Target>
+   void produce( Target& aTarget, int aProducer, std::vector<std::uint64_t>& aSent )
+   {
+      const unsigned aTotal = theConfig.theMix[0] + theConfig.theMix[1] + theConfig.theMix[2];
+      std::uint64_t aRandom = 0x9E3779B97F4A7C15 * static_cast<std::uint64_t>( aProducer + 1 );
+      const auto anEnd = std::chrono::steady_clock::now() + theConfig.theDuration;
+      std::size_t aDestination = static_cast<std::size_t>( aProducer ) % aSent.size();
+      LoadMessage aMessage;
+      aMessage.theProducer = static_cast<std::uint32_t>( aProducer );
+      while( std::chrono::steady_clock::now() < anEnd )
+      {
+         for( int i = 0; i < theConfig.theBurst; ++i )
+         {
+            aRandom ^= aRandom << 13;
+            aRandom ^= aRandom >> 7;
+            aRandom ^= aRandom << 17;
+            const unsigned aChoice = aTotal != 0 ? static_cast<unsigned>( aRandom % aTotal ) : 0;
+            aMessage.theKind = aChoice < theConfig.theMix[0] ? 0 : aChoice < theConfig.theMix[0] + theConfig.theMix[1] ? 1 : 2;
+
+            // Los publicadores entregan cada mensaje a todos los destinatarios, así que cada
+            // remitente lleva una única secuencia.
+            const std::size_t aStream = Target::theFanOut ? 0 : aDestination;
+            aMessage.theSequence = ++aSent[aStream];
+            aMessage.seal();
+            aMessage.theStamp = LoadSink::clock();
+            aTarget.send( aProducer, static_cast<int>( aDestination ), aMessage );
+            aDestination = ( aDestination + 1 ) % aSent.size();
+         }
+
+         if( theConfig.thePause.count() != 0 )
+         {
+            std::this_thread::sleep_for( theConfig.thePause );
+         }
+      }
+   }
+
+   /**
+    * Devuelve el número de entregas esperadas según los mensajes enviados <i>aSent</i>.
+    */
+   template<typename Target>
+   std::uint64_t expected( const std::vector<std::vector<std::uint64_t>>& aSent ) const
+   {
+      std::uint64_t anExpected = 0;
+      for( const auto& aCounts : aSent )
+      {
+         for( const std::uint64_t aCount : aCounts )
+         {
+            anExpected += Target::theFanOut ? aCount * static_cast<std::uint64_t>( theConfig.theDestinations ) : aCount;
+         }
+      }
+
+      return anExpected;
+   }
+
+   const LoadConfig theConfig;
+};
+
+#endif
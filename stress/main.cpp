@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "LoadGenerator.hpp"
+
+namespace
+{
+   /**
+    * Si <i>anArgument</i> es la opción <i>aName</i>, devuelve su valor; si no, devuelve nullptr.
+    */
+   const char* option( const char* anArgument, const char* aName )
+   {
+      const std::size_t aLength = std::strlen( aName );
+      if( std::strncmp( anArgument, aName, aLength ) == 0 && anArgument[aLength] == '=' )
+      {
+         return anArgument + aLength + 1;
+      }
+
+      return nullptr;
+   }
+
+   template<typename Target>
+   bool run( const LoadConfig& aConfig, const std::string& aTarget, const char* aName )
+   {
+      if( aTarget != "all" && aTarget != aName )
+      {
+         return true;
+      }
+
+      const LoadReport aReport = LoadGenerator{ aConfig }.run<Target>();
+      aReport.print( std::cout, Target::theName );
+      return aReport.isClean();
+   }
+}
+
+/**
+ * Generador de carga para AsyncQueue, Courier y los publicadores. Escribe un objeto JSON por
+ * destino y termina con error si algún mensaje se pierde, se repite, se desordena o se corrompe.
+ *
+ *    --target=all|asyncqueue|courier|async-publisher|sync-publisher
+ *    --producers=N --destinations=M --duration-ms=D --burst=B --pause-us=P --mix=PEQ,MED,GRA
+ */
+int main( int argc, char** argv )
+{
+   LoadConfig aConfig;
+   std::string aTarget{ "all" };
+   for( int i = 1; i < argc; ++i )
+   {
+      const char* aValue;
+      if( ( aValue = option( argv[i], "--target" ) ) )
+      {
+         aTarget = aValue;
+      }
+      else if( ( aValue = option( argv[i], "--producers" ) ) )
+      {
+         aConfig.theProducers = std::atoi( aValue );
+      }
+      else if( ( aValue = option( argv[i], "--destinations" ) ) )
+      {
+         aConfig.theDestinations = std::atoi( aValue );
+      }
+      else if( ( aValue = option( argv[i], "--duration-ms" ) ) )
+      {
+         aConfig.theDuration = std::chrono::milliseconds{ std::atoi( aValue ) };
+      }
+      else if( ( aValue = option( argv[i], "--burst" ) ) )
+      {
+         aConfig.theBurst = std::atoi( aValue );
+      }
+      else if( ( aValue = option( argv[i], "--pause-us" ) ) )
+      {
+         aConfig.thePause = std::chrono::microseconds{ std::atoi( aValue ) };
+      }
+      else if( !( ( aValue = option( argv[i], "--mix" ) ) &&
+                  std::sscanf( aValue, "%u,%u,%u", &aConfig.theMix[0], &aConfig.theMix[1], &aConfig.theMix[2] ) == 3 ) )
+      {
+         std::cerr << "Opción desconocida: " << argv[i] << '\n';
+         return 2;
+      }
+   }
+
+   if( aConfig.theProducers < 1 || aConfig.theDestinations < 1 || aConfig.theBurst < 1 )
+   {
+      std::cerr << "Se necesitan al menos un remitente, un destinatario y un mensaje por ráfaga\n";
+      return 2;
+   }
+
+   bool isClean = run<AsyncQueueLoad>( aConfig, aTarget, "asyncqueue" );
+   isClean = run<CourierLoad>( aConfig, aTarget, "courier" ) && isClean;
+   isClean = run<PublisherLoad<AsyncLoadModel>>( aConfig, aTarget, "async-publisher" ) && isClean;
+   isClean = run<PublisherLoad<SyncLoadModel>>( aConfig, aTarget, "sync-publisher" ) && isClean;
+   return isClean ? 0 : 1;
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "cpp14/AbstractFactory.hpp"
 
@@ -54,6 +56,15 @@ struct AbstractFactoryTest : public Test
    {
       const char* const produce() { return "Interior Kiki"; }
    };
+
+   struct PaintedBodyWork : public BodyWork
+   {
+      PaintedBodyWork( const std::string& aColour ) : theColour{ aColour } {}
+
+      const char* const manufacture() { return theColour.c_str(); }
+
+      std::string theColour;
+   };
 };
 
 TEST_F(AbstractFactoryTest, CreateConcreteProducts)
@@ -83,3 +94,86 @@ TEST_F(AbstractFactoryTest, CreateConcreteProducts)
    ASSERT_EQ( aKikiInterior->produce(), "Interior Kiki" );
 }
 
+TEST_F(AbstractFactoryTest, CreateConcreteProductsWithoutVirtualCalls)
+{
+   using CarFactory = AbstractFactory<Chassis, BodyWork, Interior>;
+
+   using TotoroFactory = StaticConcreteFactory<CarFactory, TotoroChassis, TotoroBodyWork, TotoroInterior>;
+   static_assert( !std::is_polymorphic<TotoroFactory>::value, "The factory must not be polymorphic" );
+   TotoroFactory aTotoroFactory;
+
+   std::unique_ptr<TotoroChassis> aTotoroChassis{ aTotoroFactory.create<Chassis>() };
+   std::unique_ptr<TotoroBodyWork> aTotoroBodywork{ aTotoroFactory.create<BodyWork>() };
+   std::unique_ptr<TotoroInterior> aTotoroInterior{ aTotoroFactory.create<Interior>() };
+
+   ASSERT_EQ( aTotoroChassis->make(), "Chasis Totoro" );
+   ASSERT_EQ( aTotoroBodywork->manufacture(), "Carrocería Totoro" );
+   ASSERT_EQ( aTotoroInterior->produce(), "Interior Totoro" );
+}
+
+TEST_F(AbstractFactoryTest, CreateConcreteProductsFromArena)
+{
+   using CarFactory = AllocatingAbstractFactory<Chassis, BodyWork( const std::string& )>;
+   using TotoroFactory = AllocatingConcreteFactory<CarFactory, TotoroChassis, PaintedBodyWork>;
+
+   alignas( std::max_align_t ) unsigned char aBuffer[256];
+   MonotonicBufferResource anArena{ aBuffer, sizeof( aBuffer ) };
+   auto aTotoroFactory = std::make_shared<TotoroFactory>( &anArena );
+   std::shared_ptr<CarFactory> aCarFactory = aTotoroFactory;
+
+   {
+      ProductPtr<Chassis> aTotoroChassis{ aCarFactory->create<Chassis>() };
+      ProductPtr<BodyWork> aTotoroBodywork{ aCarFactory->create<BodyWork>( "Rojo" ) };
+
+      ASSERT_EQ( aTotoroChassis->make(), "Chasis Totoro" );
+      ASSERT_EQ( std::string{ aTotoroBodywork->manufacture() }, "Rojo" );
+      ASSERT_GE( anArena.used(), sizeof( TotoroChassis ) + sizeof( PaintedBodyWork ) );
+   }
+
+   anArena.release();
+   ASSERT_EQ( anArena.used(), 0u );
+}
+
+TEST_F(AbstractFactoryTest, CreateOveralignedProducts)
+{
+   struct alignas( 64 ) CachedChassis : public Chassis
+   {
+      const char* const make() { return "Chasis alineado"; }
+   };
+
+   using CarFactory = AllocatingAbstractFactory<Chassis>;
+   using CachedFactory = AllocatingConcreteFactory<CarFactory, CachedChassis>;
+
+   CachedFactory aFactory;
+   std::vector<ProductPtr<Chassis>> aChassis;
+   for( int i = 0; i < 16; ++i )
+   {
+      aChassis.push_back( aFactory.create<Chassis>() );
+      ASSERT_EQ( reinterpret_cast<std::uintptr_t>( aChassis.back().get() ) % 64, 0u );
+   }
+
+   ASSERT_EQ( aChassis.front()->make(), "Chasis alineado" );
+}
+
+TEST_F(AbstractFactoryTest, SwitchFamilyAtRuntime)
+{
+   using CarFactory = AbstractFactory<Chassis, BodyWork, Interior>;
+   using TotoroFactory = ConcreteFactory<CarFactory, TotoroChassis, TotoroBodyWork, TotoroInterior>;
+   using KikiFactory = ConcreteFactory<CarFactory, KikiChassis, KikiBodyWork, KikiInterior>;
+
+   FactorySelector<CarFactory> aSelector{ Type2Type<TotoroFactory>() };
+
+   std::unique_ptr<Chassis> aTotoroChassis{ aSelector.create<Chassis>() };
+   std::unique_ptr<Interior> aTotoroInterior{ aSelector.create<Interior>() };
+
+   aSelector.select<KikiFactory>();
+
+   std::unique_ptr<Chassis> aKikiChassis{ aSelector.create<Chassis>() };
+   std::unique_ptr<BodyWork> aKikiBodywork{ aSelector.create<BodyWork>() };
+
+   ASSERT_EQ( aTotoroChassis->make(), "Chasis Totoro" );
+   ASSERT_EQ( aTotoroInterior->produce(), "Interior Totoro" );
+   ASSERT_EQ( aKikiChassis->make(), "Chasis Kiki" );
+   ASSERT_EQ( aKikiBodywork->manufacture(), "Carrocería Kiki" );
+}
+
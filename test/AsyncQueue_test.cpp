@@ -0,0 +1,185 @@
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "cpp14/AsyncQueue.hpp"
+
+using namespace ::testing;
+
+struct AsyncQueueTest : public Test
+{
+   struct Point
+   {
+      int theX;
+      int theY;
+   };
+
+   struct Total
+   {
+      void waitFor( int aCount )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theReadyData.wait( aLock, [this, aCount] { return theCount == aCount; } );
+      }
+
+      int theValue{};
+      int theCount{};
+
+      std::mutex theMutex;
+      std::condition_variable theReadyData;
+   };
+
+   struct Sum
+   {
+      void operator()( Point aPoint )
+      {
+         std::unique_lock<std::mutex> aLock( theTotal->theMutex );
+         theTotal->theValue += aPoint.theX * aPoint.theY;
+         ++theTotal->theCount;
+         theTotal->theReadyData.notify_one();
+      }
+
+      Total* theTotal;
+   };
+};
+
+TEST_F(AsyncQueueTest, ProcessSharedObjects)
+{
+   Total aTotal;
+   AsyncQueue<Point> aQueue{ [&aTotal]( std::shared_ptr<Point> aPoint ) { Sum{ &aTotal }( *aPoint ); } };
+
+   aQueue.store( std::make_shared<Point>( Point{ 2, 3 } ) );
+   aQueue.store( std::make_shared<Point>( Point{ 4, 5 } ) );
+   aTotal.waitFor( 2 );
+
+   ASSERT_EQ( aTotal.theValue, 26 );
+}
+
+TEST_F(AsyncQueueTest, ProcessValuesWithInlineCallback)
+{
+   Total aTotal;
+   AsyncQueue<Point, Sum> aQueue{ Sum{ &aTotal } };
+
+   aQueue.store( Point{ 2, 3 } );
+   aQueue.store( Point{ 4, 5 } );
+   aTotal.waitFor( 2 );
+
+   ASSERT_EQ( aTotal.theValue, 26 );
+}
+
+TEST_F(AsyncQueueTest, ProcessValuesFromSingleProducer)
+{
+   Total aTotal;
+   SpscAsyncQueue<Point, Sum> aQueue{ Sum{ &aTotal } };
+
+   for( int i = 1; i <= 100; ++i )
+   {
+      aQueue.store( Point{ i, 1 } );
+   }
+
+   aTotal.waitFor( 100 );
+
+   ASSERT_EQ( aTotal.theValue, 5050 );
+}
+
+TEST_F(AsyncQueueTest, ProcessScheduledValues)
+{
+   Total aTotal;
+   AsyncQueue<Point, Sum> aQueue{ Sum{ &aTotal } };
+
+   aQueue.storeAfter( std::chrono::milliseconds{ 20 }, Point{ 4, 5 } );
+   const TimerHandle aCancelled = aQueue.storeAfter( std::chrono::milliseconds{ 10 }, Point{ 100, 100 } );
+   aQueue.storeAt( std::chrono::steady_clock::now() + std::chrono::milliseconds{ 5 }, Point{ 2, 3 } );
+   aQueue.store( Point{ 1, 1 } );
+
+   ASSERT_TRUE( aQueue.cancel( aCancelled ) );
+   ASSERT_FALSE( aQueue.cancel( aCancelled ) );
+
+   aTotal.waitFor( 3 );
+
+   ASSERT_EQ( aTotal.theValue, 27 );
+}
+
+TEST_F(AsyncQueueTest, NeverProcessScheduledValuesEarly)
+{
+   using Clock = std::chrono::steady_clock;
+
+   // Cuenta los objetos procesados antes de su instante y el mayor retraso.
+   struct Check
+   {
+      void operator()( Clock::time_point aTime )
+      {
+         const Clock::time_point aNow = Clock::now();
+         std::unique_lock<std::mutex> aLock( theTotal->theMutex );
+         theTotal->theValue += aNow < aTime;
+         theLatest = std::max( theLatest, aNow - aTime );
+         ++theTotal->theCount;
+         theTotal->theReadyData.notify_one();
+      }
+
+      Total* theTotal;
+      Clock::duration& theLatest;
+   };
+
+   const int aCount = 2000;
+   Total aTotal;
+   Clock::duration aLatest{};
+   AsyncQueue<Clock::time_point, Check> aQueue{ Check{ &aTotal, aLatest } };
+
+   const Clock::time_point aStart = Clock::now();
+   for( int i = 0; i < aCount; ++i )
+   {
+      const Clock::time_point aTime = aStart + std::chrono::microseconds{ ( i * 7919 ) % 300000 };
+      aQueue.storeAt( aTime, Clock::time_point{ aTime } );
+   }
+
+   // Los objetos inmediatos despiertan a la tarea en pasos arbitrarios de la rueda.
+   for( int i = 0; i < 30; ++i )
+   {
+      std::this_thread::sleep_for( std::chrono::milliseconds{ 9 } );
+      aQueue.store( Clock::now() );
+   }
+
+   aTotal.waitFor( aCount + 30 );
+
+   std::unique_lock<std::mutex> aLock( aTotal.theMutex );
+   ASSERT_EQ( aTotal.theValue, 0 );
+   ASSERT_LT( aLatest, std::chrono::milliseconds{ 100 } );
+}
+
+TEST_F(AsyncQueueTest, ReportMetrics)
+{
+   Total aTotal;
+   AsyncQueue<Point, Sum> aQueue{ Sum{ &aTotal }, "Points" };
+
+   {
+      // La tarea se bloquea en el primer objeto mientras se almacenan los demás.
+      std::unique_lock<std::mutex> aLock( aTotal.theMutex );
+      for( int i = 1; i <= 1000; ++i )
+      {
+         aQueue.store( Point{ i, 1 } );
+      }
+   }
+
+   aQueue.cancel( aQueue.storeAfter( std::chrono::seconds{ 10 }, Point{} ) );
+   aTotal.waitFor( 1000 );
+
+   const QueueSnapshot aSnapshot = aQueue.metrics().snapshot();
+
+   ASSERT_EQ( aSnapshot.theName, "Points" );
+   ASSERT_EQ( aSnapshot.theEnqueued, 1001u );
+   ASSERT_EQ( aSnapshot.theDispatched, 1000u );
+   ASSERT_EQ( aSnapshot.theDropped, 1u );
+   ASSERT_EQ( aSnapshot.theDepth, 0u );
+   ASSERT_GE( aSnapshot.theHighWater, 999u );
+   ASSERT_EQ( aSnapshot.theSamples, 16u );
+   ASSERT_GT( aSnapshot.theMaximum, 0u );
+   ASSERT_LE( aSnapshot.theMedian, aSnapshot.the99th );
+
+   const std::vector<QueueSnapshot> aQueues = QueueMetrics::collect();
+   ASSERT_TRUE( std::any_of( aQueues.begin(), aQueues.end(),
+                             []( const QueueSnapshot& aQueue ) { return aQueue.theName == "Points"; } ) );
+}
@@ -1,4 +1,7 @@
 #include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
 #include "cpp14/Deliverable.hpp"
 #include "cpp14/Courier.hpp"
 
@@ -40,21 +43,84 @@ struct CourierTest : public Test
       std::string theItem{ "ZX Spectrum +3" };
    };
 
+   class Price;
+
+   struct Shop
+   {
+      int receive( const Price& )
+      {
+         return ++theRequests * 10;
+      }
+
+      int theRequests{};
+   };
+
+   class Price : public Request<Shop&, int>
+   {
+   public:
+
+      int reply( Shop& aShop ) const override
+      {
+         return aShop.receive( *this );
+      }
+   };
+
+   class Restock : public Request<Shop&, void>
+   {
+   public:
+
+      void reply( Shop& aShop ) const override
+      {
+         aShop.theRequests = 0;
+      }
+   };
+
+   // Una petición que el destinatario no puede responder.
+   template<typename R>
+   class Refusal : public Request<Shop&, R>
+   {
+   public:
+
+      R reply( Shop& ) const override
+      {
+         throw std::runtime_error{ "Cerrado" };
+      }
+   };
+
+   // Sustituye al std::coroutine_handle de C++20: cuenta las veces que se reanuda.
+   struct Resumable
+   {
+      static Resumable from_address( void* anAddress )
+      {
+         return Resumable{ static_cast<std::atomic<int>*>( anAddress ) };
+      }
+
+      void* address() const
+      {
+         return theResumes;
+      }
+
+      void resume() const
+      {
+         ++*theResumes;
+      }
+
+      std::atomic<int>* theResumes;
+   };
+
    struct Home : public Destination
    {
       void receive( Book&& aBook )
       {
-         theBook = aBook.theItem;
-
          std::unique_lock<std::mutex> aLock( theMutex );
+         theBook = aBook.theItem;
          theReadyData.notify_one();
       }
 
       void receive( Computer&& aComputer )
       {
-         theComputer = aComputer.theItem;
-
          std::unique_lock<std::mutex> aLock( theMutex );
+         theComputer = aComputer.theItem;
          theReadyData.notify_one();
       }
 
@@ -88,3 +154,108 @@ TEST_F(CourierTest, DispatchTwoObjects)
 }
 
 
+TEST_F(CourierTest, DispatchFromSingleProducer)
+{
+   Home aHome{};
+   SpscCourier<Destination&> aCourier{ aHome };
+
+   aCourier.deliver( std::make_shared<Book>() );
+   aCourier.deliver( std::make_shared<Computer>() );
+
+   std::unique_lock<std::mutex> aLock( aHome.theMutex );
+   aHome.theReadyData.wait( aLock, [&aHome] {
+                                      return aHome.theBook == "Don Quijote de la Mancha" &&
+                                             aHome.theComputer == "ZX Spectrum +3";
+                                   } );
+
+   ASSERT_EQ( aHome.theBook, "Don Quijote de la Mancha" );
+   ASSERT_EQ( aHome.theComputer, "ZX Spectrum +3" );
+}
+
+TEST_F(CourierTest, DispatchScheduledObjects)
+{
+   Home aHome{};
+   Courier<Destination&> aCourier{ aHome };
+
+   const auto aStart = std::chrono::steady_clock::now();
+   aCourier.deliverAfter( std::chrono::milliseconds{ 10 }, std::make_shared<Book>() );
+   aCourier.deliverAt( aStart + std::chrono::milliseconds{ 20 }, std::make_shared<Computer>() );
+
+   std::unique_lock<std::mutex> aLock( aHome.theMutex );
+   aHome.theReadyData.wait( aLock, [&aHome] {
+                                      return aHome.theBook == "Don Quijote de la Mancha" &&
+                                             aHome.theComputer == "ZX Spectrum +3";
+                                   } );
+
+   ASSERT_GE( std::chrono::steady_clock::now() - aStart, std::chrono::milliseconds{ 20 } );
+}
+
+TEST_F(CourierTest, DeliverRequestsWithReply)
+{
+   Shop aShop{};
+   Courier<Shop&> aCourier{ aShop };
+
+   ReplyFuture<int> aFirst = aCourier.deliverWithReply<int>( std::make_shared<Price>() );
+   ReplyFuture<int> aSecond = aCourier.deliverWithReply<int>( std::make_shared<Price>() );
+
+   ASSERT_EQ( aFirst.get(), 10 );
+   ASSERT_EQ( aSecond.get(), 20 );
+
+   ReplyFuture<void> aRestock = aCourier.deliverWithReply<void>( std::make_shared<Restock>() );
+
+   ASSERT_TRUE( aRestock.waitFor( std::chrono::seconds{ 5 } ) );
+   ASSERT_EQ( aCourier.deliverWithReply<int>( std::make_shared<Price>() ).get(), 10 );
+}
+
+TEST_F(CourierTest, ReportFailedRequests)
+{
+   Shop aShop{};
+   Courier<Shop&> aCourier{ aShop };
+
+   ReplyFuture<int> aPrice = aCourier.deliverWithReply<int>( std::make_shared<Refusal<int>>() );
+   ReplyFuture<void> aRestock = aCourier.deliverWithReply<void>( std::make_shared<Refusal<void>>() );
+
+   ASSERT_TRUE( aRestock.waitFor( std::chrono::seconds{ 5 } ) );
+   ASSERT_THROW( aPrice.get(), std::runtime_error );
+   ASSERT_THROW( aRestock.get(), std::runtime_error );
+   ASSERT_EQ( aCourier.deliverWithReply<int>( std::make_shared<Price>() ).get(), 10 );
+}
+
+TEST_F(CourierTest, AwaitReplies)
+{
+   Shop aShop{};
+   std::atomic<int> aResumes{};
+
+   // La respuesta llega después de suspender la corrutina, que se reanuda al completarse.
+   auto aRequest = std::make_shared<Price>();
+   ReplyFuture<int> aFuture{ std::shared_ptr<Request<Shop&, int>>{ aRequest } };
+
+   ASSERT_FALSE( aFuture.await_ready() );
+   ASSERT_TRUE( aFuture.await_suspend( Resumable{ &aResumes } ) );
+   ASSERT_EQ( aResumes, 0 );
+
+   std::thread{ [aRequest, &aShop] { aRequest->deliver( aShop ); } }.join();
+
+   ASSERT_EQ( aResumes, 1 );
+   ASSERT_TRUE( aFuture.await_ready() );
+   ASSERT_EQ( aFuture.await_resume(), 10 );
+
+   // Si la respuesta ya está lista, la corrutina no se suspende.
+   auto aReady = std::make_shared<Price>();
+   ReplyFuture<int> aReadyFuture{ std::shared_ptr<Request<Shop&, int>>{ aReady } };
+   aReady->deliver( aShop );
+
+   ASSERT_TRUE( aReadyFuture.await_ready() );
+   ASSERT_FALSE( aReadyFuture.await_suspend( Resumable{ &aResumes } ) );
+   ASSERT_EQ( aReadyFuture.await_resume(), 20 );
+
+   // Las excepciones del destinatario salen de await_resume.
+   auto aRefusal = std::make_shared<Refusal<int>>();
+   ReplyFuture<int> aRefused{ std::shared_ptr<Request<Shop&, int>>{ aRefusal } };
+
+   ASSERT_TRUE( aRefused.await_suspend( Resumable{ &aResumes } ) );
+   aRefusal->deliver( aShop );
+
+   ASSERT_EQ( aResumes, 2 );
+   ASSERT_THROW( aRefused.await_resume(), std::runtime_error );
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "cpp14/FactoryMethod.hpp"
+
+using namespace ::testing;
+
+struct FactoryMethodTest : public Test
+{
+   // Un argumento que cuenta las veces que se copia.
+   struct Payload
+   {
+      Payload() = default;
+
+      Payload( const Payload& aPayload ) : theCopies{ aPayload.theCopies + 1 } {}
+
+      Payload( Payload&& aPayload ) : theCopies{ aPayload.theCopies } {}
+
+      int theCopies{};
+   };
+
+   struct Product
+   {
+      virtual ~Product() {}
+      virtual int copies() const = 0;
+   };
+
+   struct Ghibli : public Product
+   {
+      Ghibli( Payload aPayload ) : thePayload{ std::move( aPayload ) } {}
+
+      int copies() const { return thePayload.theCopies; }
+
+      Payload thePayload;
+   };
+
+   struct Pixar : public Product
+   {
+      Pixar( const Payload& aPayload ) : theCopies{ aPayload.theCopies } {}
+
+      int copies() const { return theCopies + 100; }
+
+      int theCopies;
+   };
+};
+
+TEST_F(FactoryMethodTest, CreateRegisteredProducts)
+{
+   FactoryMethod<std::string, Product, Payload> aFactory;
+   aFactory.registerType<Ghibli>( "Ghibli" );
+   aFactory.registerType<Pixar>( "Pixar" );
+
+   std::shared_ptr<Product> aGhibli{ aFactory.create( "Ghibli", Payload{} ) };
+   std::shared_ptr<Product> aPixar{ aFactory.create( "Pixar", Payload{} ) };
+   std::shared_ptr<Product> aDisney{ aFactory.create( "Disney", Payload{} ) };
+
+   ASSERT_EQ( aGhibli->copies(), 0 );
+   ASSERT_EQ( aPixar->copies(), 100 );
+   ASSERT_EQ( aDisney, nullptr );
+
+   aFactory.remove( "Pixar" );
+   ASSERT_EQ( aFactory.create( "Pixar", Payload{} ), nullptr );
+}
+
+TEST_F(FactoryMethodTest, ForwardArgumentsWithoutExtraCopies)
+{
+   FactoryMethod<int, Product, Payload> aByValueFactory;
+   aByValueFactory.registerType<Ghibli>( 1 );
+
+   FactoryMethod<int, Product, const Payload&> aByReferenceFactory;
+   aByReferenceFactory.registerType<Ghibli>( 1 );
+
+   Payload aPayload;
+
+   ASSERT_EQ( aByValueFactory.create( 1, Payload{} )->copies(), 0 );
+   ASSERT_EQ( aByValueFactory.create( 1, aPayload )->copies(), 1 );
+   ASSERT_EQ( aByReferenceFactory.create( 1, aPayload )->copies(), 1 );
+}
+
+TEST_F(FactoryMethodTest, PassDerivedArgumentsByReference)
+{
+   struct Config
+   {
+      virtual ~Config() {}
+      virtual int copies() const = 0;
+   };
+
+   struct MyConfig : public Config
+   {
+      int copies() const { return 7; }
+   };
+
+   struct Dreamworks : public Product
+   {
+      Dreamworks( const Config& aConfig ) : theConfig{ &aConfig } {}
+
+      int copies() const { return theConfig->copies(); }
+
+      const Config* theConfig;
+   };
+
+   FactoryMethod<int, Product, const Config&> aFactory;
+   aFactory.registerType<Dreamworks>( 1 );
+
+   MyConfig aConfig;
+   std::shared_ptr<Product> aProduct{ aFactory.create( 1, aConfig ) };
+
+   ASSERT_EQ( aProduct->copies(), 7 );
+   ASSERT_EQ( static_cast<Dreamworks&>( *aProduct ).theConfig, &aConfig );
+}
+
+TEST_F(FactoryMethodTest, EmplaceIntoCallerStorage)
+{
+   FactoryMethod<std::string, Product, Payload> aFactory;
+   aFactory.registerType<Ghibli>( "Ghibli" );
+   aFactory.registerType<Pixar>( "Pixar" );
+
+   ProductSlot<Product, sizeof( Ghibli ) + sizeof( Pixar )> aSlot;
+   ASSERT_FALSE( aSlot );
+
+   Product* aGhibli = aFactory.emplace( aSlot, "Ghibli", Payload{} );
+   ASSERT_EQ( aGhibli, aSlot.get() );
+   ASSERT_EQ( aSlot->copies(), 0 );
+
+   aFactory.emplace( aSlot, "Pixar", Payload{} );
+   ASSERT_EQ( aSlot->copies(), 100 );
+
+   ASSERT_EQ( aFactory.emplace( aSlot, "Disney", Payload{} ), nullptr );
+   ASSERT_FALSE( aSlot );
+
+   alignas( Ghibli ) unsigned char aBuffer[sizeof( Ghibli )];
+   ASSERT_EQ( aFactory.emplace( "Ghibli", aBuffer, sizeof( aBuffer ) - 1, Payload{} ), nullptr );
+
+   Product* aProduct = aFactory.emplace( "Ghibli", aBuffer, sizeof( aBuffer ), Payload{} );
+   ASSERT_EQ( aProduct->copies(), 0 );
+   aProduct->~Product();
+}
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include "cpp14/Journal.hpp"
+
+using namespace ::testing;
+
+struct JournalTest : public Test
+{
+   struct Order
+   {
+      int theProduct;
+      int theUnits;
+   };
+
+   struct Orders
+   {
+      void operator()( Order anOrder )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theOrders.push_back( anOrder );
+         theReadyData.notify_one();
+         theReadyData.wait( aLock, [this] { return !theBlocked; } );
+      }
+
+      void waitFor( std::size_t aCount )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theReadyData.wait( aLock, [this, aCount] { return theOrders.size() >= aCount; } );
+      }
+
+      void unblock()
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theBlocked = false;
+         theReadyData.notify_all();
+      }
+
+      std::vector<Order> theOrders;
+      bool theBlocked{};
+
+      std::mutex theMutex;
+      std::condition_variable theReadyData;
+   };
+
+   struct Forward
+   {
+      void operator()( Order anOrder )
+      {
+         ( *theOrders )( anOrder );
+      }
+
+      Orders* theOrders;
+   };
+
+   JournalTest()
+   {
+      char aTemplate[] = "/tmp/generic-patterns-XXXXXX";
+      theDirectory = ::mkdtemp( aTemplate );
+   }
+
+   ~JournalTest()
+   {
+      for( const auto& aFile : files() )
+      {
+         ::unlink( ( theDirectory + "/" + aFile ).c_str() );
+      }
+
+      ::rmdir( theDirectory.c_str() );
+   }
+
+   std::vector<std::string> files() const
+   {
+      std::vector<std::string> aFiles;
+      DIR* aDirectory = ::opendir( theDirectory.c_str() );
+      while( const dirent* anEntry = ::readdir( aDirectory ) )
+      {
+         if( anEntry->d_name[0] != '.' )
+         {
+            aFiles.push_back( anEntry->d_name );
+         }
+      }
+
+      ::closedir( aDirectory );
+      return aFiles;
+   }
+
+   std::string theDirectory;
+};
+
+TEST_F(JournalTest, ReplayUnacknowledgedObjects)
+{
+   {
+      Journal<Order> aJournal{ theDirectory, 4096 };
+      ASSERT_TRUE( aJournal.isOpen() );
+
+      for( int i = 1; i <= 1000; ++i )
+      {
+         ASSERT_EQ( aJournal.append( Order{ i, 2 * i } ), static_cast<std::uint64_t>( i ) );
+      }
+
+      aJournal.sync();
+      aJournal.acknowledge( 600 );
+
+      ASSERT_EQ( aJournal.durable(), 1000u );
+   }
+
+   Journal<Order> aJournal{ theDirectory, 4096 };
+   std::vector<std::uint64_t> aSequences;
+   aJournal.replay( [&aSequences]( std::uint64_t aSequence, const Order& anOrder ) {
+                       ASSERT_EQ( anOrder.theProduct, static_cast<int>( aSequence ) );
+                       ASSERT_EQ( anOrder.theUnits, static_cast<int>( 2 * aSequence ) );
+                       aSequences.push_back( aSequence );
+                    } );
+
+   ASSERT_EQ( aSequences.size(), 400u );
+   ASSERT_EQ( aSequences.front(), 601u );
+   ASSERT_EQ( aSequences.back(), 1000u );
+   ASSERT_EQ( aJournal.append( Order{} ), 1001u );
+}
+
+TEST_F(JournalTest, RemoveAcknowledgedSegments)
+{
+   Journal<Order> aJournal{ theDirectory, 4096 };
+
+   for( int i = 1; i <= 1000; ++i )
+   {
+      aJournal.append( Order{ i, i } );
+   }
+
+   const std::size_t aCount = files().size();
+   aJournal.sync();
+   aJournal.acknowledge( 1000 );
+
+   ASSERT_GT( aCount, 3u );
+   ASSERT_EQ( files().size(), 2u );
+}
+
+TEST_F(JournalTest, ProcessPendingObjectsAfterRestart)
+{
+   Orders aFirst{};
+   aFirst.theBlocked = true;
+   {
+      DurableAsyncQueue<Order, Forward> aQueue{ theDirectory, Forward{ &aFirst }, 4096 };
+      ASSERT_TRUE( aQueue.isOpen() );
+
+      for( int i = 1; i <= 100; ++i )
+      {
+         aQueue.store( Order{ i, 1 } );
+      }
+
+      aFirst.waitFor( 1 );
+      aFirst.unblock();
+   }
+
+   Orders aSecond{};
+   DurableAsyncQueue<Order, Forward> aQueue{ theDirectory, Forward{ &aSecond }, 4096 };
+   aSecond.waitFor( 100 - aFirst.theOrders.size() );
+
+   std::vector<Order> anOrders = aFirst.theOrders;
+   anOrders.insert( anOrders.end(), aSecond.theOrders.begin(), aSecond.theOrders.end() );
+
+   ASSERT_EQ( anOrders.size(), 100u );
+   for( int i = 0; i < 100; ++i )
+   {
+      ASSERT_EQ( anOrders[i].theProduct, i + 1 );
+   }
+}
+
+TEST_F(JournalTest, KeepSegmentsOfAnotherType)
+{
+   struct Invoice
+   {
+      int theOrder;
+      double theAmount;
+   };
+
+   {
+      Journal<Order> aJournal{ theDirectory, 4096 };
+      for( int i = 1; i <= 100; ++i )
+      {
+         aJournal.append( Order{ i, i } );
+      }
+   }
+
+   const std::vector<std::string> aFiles = files();
+   {
+      Journal<Invoice> aJournal{ theDirectory, 4096 };
+      ASSERT_FALSE( aJournal.isOpen() );
+      ASSERT_EQ( aJournal.append( Invoice{ 1, 1.0 } ), 0u );
+      aJournal.acknowledge( 100 );
+      aJournal.sync();
+   }
+
+   ASSERT_EQ( files(), aFiles );
+
+   Journal<Order> aJournal{ theDirectory, 4096 };
+   std::size_t aCount = 0;
+   aJournal.replay( [&aCount]( std::uint64_t aSequence, const Order& anOrder ) {
+                       ASSERT_EQ( anOrder.theProduct, static_cast<int>( aSequence ) );
+                       ++aCount;
+                    } );
+
+   ASSERT_EQ( aCount, 100u );
+}
+
+TEST_F(JournalTest, RejectSegmentsWithoutRoomForAnObject)
+{
+   Journal<Order> aJournal{ theDirectory, 32 };
+   ASSERT_FALSE( aJournal.isOpen() );
+   ASSERT_EQ( aJournal.append( Order{ 1, 1 } ), 0u );
+
+   aJournal.acknowledge( 1 );
+   aJournal.sync();
+   aJournal.replay( []( std::uint64_t, const Order& ) { FAIL(); } );
+
+   ASSERT_TRUE( files().empty() );
+}
+
+TEST_F(JournalTest, SyncAcknowledgementsWithoutNewObjects)
+{
+   {
+      Journal<Order> aJournal{ theDirectory, 4096 };
+      for( int i = 1; i <= 10; ++i )
+      {
+         aJournal.append( Order{ i, i } );
+      }
+
+      aJournal.sync();
+      aJournal.sync();
+      aJournal.acknowledge( 4 );
+      aJournal.sync();
+   }
+
+   Journal<Order> aJournal{ theDirectory, 4096 };
+   std::vector<std::uint64_t> aSequences;
+   aJournal.replay( [&aSequences]( std::uint64_t aSequence, const Order& ) { aSequences.push_back( aSequence ); } );
+
+   ASSERT_EQ( aSequences.size(), 6u );
+   ASSERT_EQ( aSequences.front(), 5u );
+}
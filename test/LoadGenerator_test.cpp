@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include "../stress/LoadGenerator.hpp"
+
+using namespace ::testing;
+
+struct LoadGeneratorTest : public Test
+{
+   LoadGeneratorTest()
+   {
+      theConfig.theProducers = 3;
+      theConfig.theDestinations = 2;
+      theConfig.theDuration = std::chrono::milliseconds{ 50 };
+      theConfig.theBurst = 16;
+      theConfig.thePause = std::chrono::microseconds{ 200 };
+   }
+
+   template<typename Target>
+   void check()
+   {
+      const LoadReport aReport = LoadGenerator{ theConfig }.run<Target>();
+
+      ASSERT_GT( aReport.theExpected, 0u );
+      ASSERT_EQ( aReport.theReceived, aReport.theExpected );
+      ASSERT_EQ( aReport.theLost, 0u );
+      ASSERT_EQ( aReport.theDuplicated, 0u );
+      ASSERT_EQ( aReport.theReordered, 0u );
+      ASSERT_EQ( aReport.theCorrupted, 0u );
+      ASSERT_LE( aReport.theMedian, aReport.the99th );
+      ASSERT_LE( aReport.the99th, aReport.theMaximum );
+   }
+
+   LoadConfig theConfig;
+};
+
+TEST_F(LoadGeneratorTest, DeliverThroughAsyncQueue)
+{
+   check<AsyncQueueLoad>();
+}
+
+TEST_F(LoadGeneratorTest, DeliverThroughCourier)
+{
+   check<CourierLoad>();
+}
+
+TEST_F(LoadGeneratorTest, DeliverThroughAsyncPublisher)
+{
+   check<PublisherLoad<AsyncLoadModel>>();
+}
+
+TEST_F(LoadGeneratorTest, DeliverThroughSyncPublisher)
+{
+   check<PublisherLoad<SyncLoadModel>>();
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "cpp14/PrototypeFactory.hpp"
+
+using namespace ::testing;
+
+struct PrototypeFactoryTest : public Test
+{
+   struct Table
+   {
+      virtual ~Table() {}
+      virtual std::string lookup() const = 0;
+   };
+
+   // Una tabla cara de construir que lleva la cuenta de sus construcciones.
+   struct Dictionary : public Table
+   {
+      Dictionary( std::string aLanguage, int& aBuilds ) : theLanguage{ std::move( aLanguage ) }
+      {
+         ++aBuilds;
+      }
+
+      std::string lookup() const { return theLanguage; }
+
+      std::string theLanguage;
+   };
+};
+
+TEST_F(PrototypeFactoryTest, CloneRegisteredPrototype)
+{
+   int aBuilds{};
+   PrototypeFactory<int, Table> aFactory;
+   aFactory.registerPrototype( 1, Dictionary{ "ES", aBuilds } );
+
+   std::shared_ptr<Table> aFirst{ aFactory.create( 1 ) };
+   std::shared_ptr<Table> aSecond{ aFactory.create( 1 ) };
+
+   ASSERT_EQ( aFirst->lookup(), "ES" );
+   ASSERT_NE( aFirst, aSecond );
+   ASSERT_EQ( aBuilds, 1 );
+   ASSERT_EQ( aFactory.create( 2 ), nullptr );
+}
+
+TEST_F(PrototypeFactoryTest, BuildLazilyAndRebuildAfterInvalidation)
+{
+   int aBuilds{};
+   std::string aLanguage{ "ES" };
+   PrototypeFactory<int, Table> aFactory;
+   aFactory.registerType<Dictionary>( 1, [&] { return Dictionary{ aLanguage, aBuilds }; } );
+   ASSERT_EQ( aBuilds, 0 );
+
+   std::shared_ptr<const Table> aShared{ aFactory.share( 1 ) };
+   aFactory.create( 1 );
+   ASSERT_EQ( aBuilds, 1 );
+
+   aLanguage = "EN";
+   aFactory.invalidate( 1 );
+   ASSERT_EQ( aFactory.create( 1 )->lookup(), "EN" );
+   ASSERT_EQ( aShared->lookup(), "ES" );
+   ASSERT_EQ( aBuilds, 2 );
+
+   aFactory.refresh( 1, Dictionary{ "FR", aBuilds } );
+   ASSERT_EQ( aFactory.share( 1 )->lookup(), "FR" );
+}
+
+TEST_F(PrototypeFactoryTest, CloneIntoSlot)
+{
+   int aBuilds{};
+   PrototypeFactory<int, Table> aFactory;
+   aFactory.registerPrototype( 1, Dictionary{ "ES", aBuilds } );
+
+   ProductSlot<Table, sizeof( Dictionary )> aSlot;
+   ASSERT_NE( aFactory.emplace( aSlot, 1 ), nullptr );
+   ASSERT_EQ( aSlot->lookup(), "ES" );
+
+   aFactory.invalidate( 1 );
+   ASSERT_EQ( aFactory.emplace( aSlot, 1 ), nullptr );
+   ASSERT_FALSE( aSlot );
+}
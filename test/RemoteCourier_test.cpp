@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <sys/wait.h>
+#include "cpp14/RemoteCourier.hpp"
+
+using namespace ::testing;
+
+struct RemoteCourierTest : public Test
+{
+   struct Sale
+   {
+      int theAmount;
+   };
+
+   struct Restock
+   {
+      int theUnits;
+      char theProduct[16];
+   };
+
+   struct Shop
+   {
+      void receive( const Sale& aSale )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theIncome += aSale.theAmount;
+         ++theMessages;
+         theReadyData.notify_one();
+      }
+
+      void receive( const Restock& aRestock )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theUnits += aRestock.theUnits;
+         theProduct = aRestock.theProduct;
+         ++theMessages;
+         theReadyData.notify_one();
+      }
+
+      void waitFor( int aMessages )
+      {
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theReadyData.wait( aLock, [this, aMessages] { return theMessages == aMessages; } );
+      }
+
+      long theIncome{};
+      int theUnits{};
+      std::string theProduct;
+      int theMessages{};
+
+      std::mutex theMutex;
+      std::condition_variable theReadyData;
+   };
+
+   using Channel = SharedChannel<Sale, Restock>;
+
+   std::string theName{ "/generic-patterns-" + std::to_string( ::getpid() ) };
+};
+
+TEST_F(RemoteCourierTest, DispatchFromSeveralSenders)
+{
+   Shop aShop{};
+   RemoteCourier<Shop&, Sale, Restock> aCourier{ theName.c_str(), aShop, 64 };
+   ASSERT_TRUE( aCourier.isOpen() );
+
+   auto aSender = [this] {
+                     Channel aChannel{ SharedMemory{ theName.c_str() } };
+                     for( int i = 1; i <= 10000; ++i )
+                     {
+                        aChannel.send( Sale{ i } );
+                     }
+
+                     aChannel.send( Restock{ 5, "Tornillos" } );
+                  };
+
+   std::thread aFirst( aSender );
+   std::thread aSecond( aSender );
+   aFirst.join();
+   aSecond.join();
+
+   aShop.waitFor( 20002 );
+
+   ASSERT_EQ( aShop.theIncome, 2 * 50005000L );
+   ASSERT_EQ( aShop.theUnits, 10 );
+   ASSERT_EQ( aShop.theProduct, "Tornillos" );
+}
+
+TEST_F(RemoteCourierTest, DispatchFromAnotherProcess)
+{
+   const int aDescriptor = SharedMemory::createAnonymous( Channel::sizeFor( 16 ) );
+   ASSERT_GE( aDescriptor, 0 );
+
+   Shop aShop{};
+   RemoteCourier<Shop&, Sale, Restock> aCourier{ SharedMemory{ aDescriptor }, aShop, 16 };
+   ASSERT_TRUE( aCourier.isOpen() );
+
+   const pid_t aChild = ::fork();
+   if( aChild == 0 )
+   {
+      Channel aChannel{ SharedMemory{ aDescriptor } };
+      for( int i = 1; i <= 1000; ++i )
+      {
+         aChannel.send( Sale{ i } );
+      }
+
+      ::_exit( 0 );
+   }
+
+   ASSERT_GT( aChild, 0 );
+   int aStatus{};
+   ::waitpid( aChild, &aStatus, 0 );
+   ::close( aDescriptor );
+
+   aShop.waitFor( 1000 );
+
+   ASSERT_EQ( aShop.theIncome, 500500L );
+}
+
+TEST_F(RemoteCourierTest, RejectDifferentMessages)
+{
+   Shop aShop{};
+   RemoteCourier<Shop&, Sale, Restock> aCourier{ theName.c_str(), aShop };
+
+   SharedChannel<Sale> aChannel{ SharedMemory{ theName.c_str() } };
+
+   ASSERT_FALSE( aChannel.isOpen() );
+}
+
+TEST_F(RemoteCourierTest, RejectMessagesInAnotherOrder)
+{
+   struct Refund
+   {
+      int theAmount;
+   };
+
+   static_assert( sizeof( Refund ) == sizeof( Sale ), "Los mensajes deben tener el mismo tamaño" );
+
+   Shop aShop{};
+   RemoteCourier<Shop&, Sale, Restock> aCourier{ theName.c_str(), aShop };
+
+   SharedChannel<Restock, Sale> aSwapped{ SharedMemory{ theName.c_str() } };
+   SharedChannel<Refund, Restock> aRenamed{ SharedMemory{ theName.c_str() } };
+   Channel aSame{ SharedMemory{ theName.c_str() } };
+
+   ASSERT_FALSE( aSwapped.isOpen() );
+   ASSERT_FALSE( aRenamed.isOpen() );
+   ASSERT_TRUE( aSame.isOpen() );
+}
+
+TEST_F(RemoteCourierTest, KeepNameOfCreatedSegment)
+{
+   {
+      SharedMemory aMemory{ std::string{ theName }.c_str(), 4096 };
+      ASSERT_TRUE( aMemory.isOpen() );
+
+      SharedMemory aMoved{ std::move( aMemory ) };
+      ASSERT_TRUE( SharedMemory{ theName.c_str() }.isOpen() );
+   }
+
+   // El segmento se ha borrado por su nombre aunque la cadena del llamante ya no exista.
+   ASSERT_FALSE( SharedMemory{ theName.c_str() }.isOpen() );
+}
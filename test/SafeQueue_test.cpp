@@ -0,0 +1,56 @@
+
+#include <gtest/gtest.h>
+#include <thread>
+#include "cpp14/SafeQueue.hpp"
+
+using namespace ::testing;
+
+template<typename Wait>
+struct SafeQueueTest : public Test
+{
+   static constexpr int theCount = 10000;
+
+   BasicSafeQueue<int, Wait> theQueue;
+};
+
+using WaitStrategies = Types<BlockingWait, BusySpinWait, SpinYieldWait, SpinParkWait>;
+
+TYPED_TEST_SUITE(SafeQueueTest, WaitStrategies);
+
+TYPED_TEST(SafeQueueTest, KeepOrderAcrossThreads)
+{
+   auto& aQueue = this->theQueue;
+   std::thread aProducer( [&aQueue] {
+                             for( int i = 0; i < TestFixture::theCount; ++i )
+                             {
+                                aQueue.push( i );
+                             }
+                          } );
+
+   int aMismatches = 0;
+   for( int i = 0; i < TestFixture::theCount; ++i )
+   {
+      if( aQueue.front() != i )
+      {
+         ++aMismatches;
+      }
+
+      aQueue.pop();
+   }
+
+   aProducer.join();
+
+   ASSERT_EQ( aMismatches, 0 );
+   ASSERT_TRUE( aQueue.empty() );
+}
+
+TYPED_TEST(SafeQueueTest, StopReleasesConsumer)
+{
+   auto& aQueue = this->theQueue;
+   std::thread aConsumer( [&aQueue] {
+                             ASSERT_EQ( aQueue.front(), 0 );
+                          } );
+
+   aQueue.stop();
+   aConsumer.join();
+}
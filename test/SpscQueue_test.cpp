@@ -0,0 +1,65 @@
+
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "cpp14/SpscQueue.hpp"
+
+using namespace ::testing;
+
+struct SpscQueueTest : public Test
+{
+   static constexpr int theCount = 100000;
+};
+
+TEST_F(SpscQueueTest, KeepOrderAcrossThreads)
+{
+   SpscQueue<int> aQueue{ 16 };
+
+   std::thread aProducer( [&aQueue] {
+                             for( int i = 0; i < theCount; ++i )
+                             {
+                                aQueue.emplace( int( i ) );
+                             }
+                          } );
+
+   int aMismatches = 0;
+   for( int i = 0; i < theCount; ++i )
+   {
+      if( aQueue.front() != i )
+      {
+         ++aMismatches;
+      }
+
+      aQueue.pop();
+   }
+
+   aProducer.join();
+
+   ASSERT_EQ( aMismatches, 0 );
+   ASSERT_TRUE( aQueue.empty() );
+}
+
+TEST_F(SpscQueueTest, StopReleasesConsumer)
+{
+   SpscQueue<std::shared_ptr<int>> aQueue;
+
+   std::thread aConsumer( [&aQueue] {
+                             ASSERT_EQ( aQueue.front(), nullptr );
+                          } );
+
+   aQueue.stop();
+   aConsumer.join();
+}
+
+TEST_F(SpscQueueTest, AllocateWithPlainNew)
+{
+   static_assert( alignof( SpscQueue<int> ) <= alignof( std::max_align_t ), "SpscQueue is over-aligned" );
+
+   std::unique_ptr<SpscQueue<int>> aQueue{ new SpscQueue<int>{ 16 } };
+   aQueue->push( 1 );
+
+   ASSERT_EQ( reinterpret_cast<std::uintptr_t>( aQueue.get() ) % alignof( SpscQueue<int> ), 0u );
+   ASSERT_EQ( aQueue->front(), 1 );
+}
@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 #include "cpp14/StateContext.hpp"
+#include "cpp14/OrthogonalRegions.hpp"
+#include "cpp14/StateTrace.hpp"
 
 using namespace ::testing;
 
@@ -107,8 +113,273 @@ struct StatePatternTest : public Test
 
       std::string theString;
    };
+
+   // Un estado que solo maneja enteros.
+   class Counting : public State<int>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, int n ) const
+      {
+         aContext.theNumber += n;
+      }
+   };
+
+   // Un estado que solo maneja caracteres.
+   class Waiting : public State<char>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, char ) const
+      {
+         aContext.changeState( Counting{} );
+      }
+   };
+
+   // Un contexto que cuenta las entradas que su estado no trata.
+   struct CountingContext : public BasicStateContext<CountUnhandled, CountingContext, Counting, Waiting>
+   {
+      CountingContext()
+      {
+         changeState( Counting{} );
+      }
+
+      template<typename T>
+      void handle( T anInput )
+      {
+         delegate( anInput );
+      }
+
+      int theNumber{};
+   };
+
+   // Un estado que genera nuevas entradas mientras trata otras.
+   class Chaining : public State<int, char>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, int n ) const
+      {
+         aContext.theLog += std::to_string( n );
+         if( n < 0 )
+         {
+            aContext.post( '!' );
+            throw n;
+         }
+
+         if( n > 0 )
+         {
+            aContext.post( n - 1 );
+            aContext.post( '.' );
+         }
+      }
+
+      template<typename C>
+      void handle( C& aContext, char c ) const
+      {
+         aContext.theLog += c;
+      }
+   };
+
+   // Un contexto que trata entradas encadenadas y por lotes.
+   struct ChainingContext : public StateContext<ChainingContext, Chaining>
+   {
+      ChainingContext()
+      {
+         changeState( Chaining{} );
+      }
+
+      void handle( int n )
+      {
+         delegate( n );
+      }
+
+      void handleAll( const std::vector<int>& aNumbers )
+      {
+         processBatch( aNumbers.begin(), aNumbers.end() );
+      }
+
+      void run( SafeQueue<int>& aQueue )
+      {
+         feed( aQueue );
+      }
+
+      std::string theLog;
+   };
+
+   // Un estado con datos que anota cuándo se entra en él y cuándo se sale.
+   class Buffering : public State<char>
+   {
+   public:
+
+      Buffering( std::size_t aCapacity ) : theBuffer( aCapacity ) {}
+
+      template<typename C>
+      void handle( C& aContext, char c ) const;
+
+      template<typename C>
+      void onEnter( C& aContext )
+      {
+         aContext.theLog += "[" + std::to_string( theBuffer.size() );
+      }
+
+      template<typename C>
+      void onExit( C& aContext )
+      {
+         aContext.theLog += "]";
+      }
+
+      std::vector<char> theBuffer;
+   };
+
+   // Un estado sin datos que construye en su lugar el siguiente estado.
+   class Idle : public State<int>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, int n ) const
+      {
+         aContext.template emplaceState<Buffering>( n );
+      }
+   };
+
+   // Un contexto cuyos estados tienen acciones de entrada y salida.
+   struct HookContext : public StateContext<HookContext, Idle, Buffering>
+   {
+      HookContext()
+      {
+         changeState( Idle{} );
+      }
+
+      template<typename T>
+      void handle( T anInput )
+      {
+         delegate( anInput );
+      }
+
+      std::string theLog;
+   };
+
+   // Una entrada común a varios estados.
+   struct Reset {};
+
+   // Un superestado que trata la entrada común a sus subestados.
+   class Active : public State<Reset>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, const Reset& ) const
+      {
+         aContext.theLog += "R";
+         aContext.changeState( Starting{} );
+      }
+   };
+
+   // Un subestado de Active que maneja enteros.
+   class Starting : public SubState<Active, int>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, int n ) const
+      {
+         aContext.theLog += std::to_string( n );
+         aContext.changeState( Running{} );
+      }
+   };
+
+   // Otro subestado de Active que maneja caracteres.
+   class Running : public SubState<Active, char>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, char c ) const
+      {
+         aContext.theLog += c;
+      }
+   };
+
+   // Un contexto cuyos estados están anidados en un superestado.
+   struct NestedContext : public StateContext<NestedContext, Starting, Running>
+   {
+      NestedContext()
+      {
+         changeState( Starting{} );
+      }
+
+      template<typename T>
+      void handle( T anInput )
+      {
+         delegate( anInput );
+      }
+
+      std::string theLog;
+   };
+
+   // Un contexto con traza que descarta las entradas que su estado no trata.
+   struct TracedContext : public BasicStateContext<Traced<IgnoreUnhandled>::Policy, TracedContext, Counting, Waiting>
+   {
+      TracedContext()
+      {
+         changeState( Waiting{} );
+      }
+
+      template<typename T>
+      void handle( T anInput )
+      {
+         delegate( anInput );
+      }
+
+      int theNumber{};
+   };
+
+   // Un estado cuyos datos se copian trivialmente.
+   class Summing : public State<int>
+   {
+   public:
+
+      explicit Summing( int aTotal = 0 ) : theTotal{ aTotal } {}
+
+      template<typename C>
+      void handle( C& aContext, int n ) const
+      {
+         aContext.theNumber = theTotal + n;
+         aContext.changeState( Summing{ theTotal + n } );
+      }
+
+      int theTotal;
+   };
+
+   // Un contexto del que se toman instantáneas.
+   struct SnapshotContext : public StateContext<SnapshotContext, Counting, Summing>
+   {
+      SnapshotContext()
+      {
+         changeState( Summing{} );
+      }
+
+      void handle( int n )
+      {
+         delegate( n );
+      }
+
+      int theNumber{};
+   };
 };
 
+template<typename C>
+void StatePatternTest::Buffering::handle( C& aContext, char c ) const
+{
+   aContext.theLog += c;
+   aContext.changeState( Idle{} );
+}
+
 TEST_F( StatePatternTest, ThreeActionsThreeStateChanges )
 {
    Context aContext;
@@ -130,4 +401,208 @@ TEST_F( StatePatternTest, FourActionsThreeStateChanges )
    ASSERT_EQ( aContext.theNumber, 207 );
 }
 
+TEST_F( StatePatternTest, CountUnhandledInputs )
+{
+   CountingContext aContext;
+   aContext.handle( 5 );
+   aContext.handle( 'a' );
+   aContext.handle( 'b' );
+   aContext.handle( FixedNumber{} );
+
+   ASSERT_EQ( aContext.theNumber, 5 );
+   ASSERT_EQ( ( aContext.unhandledCount<Counting, int>() ), 0u );
+   ASSERT_EQ( ( aContext.unhandledCount<Counting, char>() ), 2u );
+   ASSERT_EQ( ( aContext.unhandledCount<Counting, FixedNumber>() ), 1u );
+
+   // Dos estados por tres columnas: int, char y los tipos que no maneja ningún estado.
+   const auto aCounts = aContext.unhandledCounts();
+   ASSERT_EQ( aCounts.size(), 6u );
+   ASSERT_EQ( aCounts[0], 0u );
+   ASSERT_EQ( aCounts[1], 2u );
+   ASSERT_EQ( aCounts[2], 1u );
+}
+
+TEST_F( StatePatternTest, PostedInputsRunToCompletion )
+{
+   ChainingContext aContext;
+   aContext.handle( 2 );
+
+   ASSERT_EQ( aContext.theLog, "21.0." );
+}
+
+TEST_F( StatePatternTest, RecoverFromThrowingHandler )
+{
+   ChainingContext aContext;
+
+   ASSERT_THROW( aContext.handle( -1 ), int );
+   aContext.handle( 1 );
+
+   ASSERT_EQ( aContext.theLog, "-1!10." );
+}
+
+TEST_F( StatePatternTest, ProcessBatchAndFeedFromQueue )
+{
+   ChainingContext aContext;
+   aContext.handleAll( { 1, 0, 1 } );
+
+   ASSERT_EQ( aContext.theLog, "10.010." );
+
+   SafeQueue<int> aQueue;
+   ChainingContext aFedContext;
+   std::thread aFeeder{ [&] { aFedContext.run( aQueue ); } };
+   aQueue.push( 1 );
+   aQueue.push( 0 );
+   while( !aQueue.empty() )
+   {
+      std::this_thread::yield();
+   }
+
+   aQueue.stop();
+   aFeeder.join();
+
+   ASSERT_EQ( aFedContext.theLog, "10.0" );
+}
+
+TEST_F( StatePatternTest, EmplaceStateWithEntryAndExitActions )
+{
+   HookContext aContext;
+   aContext.handle( 4 );
+   aContext.handle( 'x' );
+   aContext.handle( 2 );
+
+   ASSERT_EQ( aContext.theLog, "[4x][2" );
+}
+
+TEST_F( StatePatternTest, SuperStateHandlesCommonInputs )
+{
+   NestedContext aContext;
+   aContext.handle( 1 );
+   aContext.handle( 'a' );
+   aContext.handle( Reset{} );
+   aContext.handle( 2 );
+   aContext.handle( Reset{} );
+
+   ASSERT_EQ( aContext.theLog, "1aR2R" );
+}
+
+TEST_F( StatePatternTest, OrthogonalRegionsShareInputs )
+{
+   OrthogonalRegions<NestedContext, CountingContext> aRegions;
+   aRegions.delegate( 3 );
+   aRegions.delegate( Reset{} );
+   aRegions.delegate( 4 );
+
+   ASSERT_EQ( aRegions.region<NestedContext>().theLog, "3R4" );
+   ASSERT_EQ( aRegions.region<CountingContext>().theNumber, 7 );
+
+   // La región CountingContext no maneja Reset, así que no llega a recibirlo.
+   for( auto aCount : aRegions.region<CountingContext>().unhandledCounts() )
+   {
+      ASSERT_EQ( aCount, 0u );
+   }
+}
+
+TEST_F( StatePatternTest, TraceTransitionsAndHandlingTimes )
+{
+   TracedContext aContext;
+   aContext.handle( 'a' );
+   aContext.handle( 5 );
+   aContext.handle( 6 );
+
+   ASSERT_EQ( aContext.theNumber, 11 );
+   ASSERT_EQ( ( aContext.handlingTime<Waiting, char>().count() ), 1u );
+   ASSERT_EQ( ( aContext.handlingTime<Counting, int>().count() ), 2u );
+   ASSERT_EQ( ( aContext.handlingTime<Counting, char>().count() ), 0u );
+
+   std::vector<TraceRecord> aRecords;
+   for( const TraceRecord& aRecord : TraceRing::collect() )
+   {
+      if( aRecord.theContext == static_cast<const void*>( &aContext ) )
+      {
+         aRecords.push_back( aRecord );
+      }
+   }
+
+   ASSERT_EQ( aRecords.size(), 3u );
+   ASSERT_EQ( *aRecords[0].theFrom, typeid( Waiting ) );
+   ASSERT_EQ( *aRecords[0].theInput, typeid( char ) );
+   ASSERT_EQ( *aRecords[0].theTo, typeid( Counting ) );
+   ASSERT_EQ( *aRecords[2].theFrom, typeid( Counting ) );
+   ASSERT_LE( aRecords[1].theTime, aRecords[2].theTime );
+
+   std::ostringstream aDump;
+   aContext.dumpHandlingTimes( aDump );
+   std::istringstream aLines{ aDump.str() };
+   std::string aState;
+   std::string anInput;
+   std::string aRest;
+   ASSERT_TRUE( aLines >> aState >> anInput && std::getline( aLines, aRest ) );
+   ASSERT_EQ( aState, typeid( Counting ).name() );
+   ASSERT_EQ( anInput, typeid( int ).name() );
+   ASSERT_TRUE( aLines >> aState >> anInput && std::getline( aLines, aRest ) );
+   ASSERT_EQ( aState, typeid( Waiting ).name() );
+   ASSERT_EQ( anInput, typeid( char ).name() );
+   ASSERT_FALSE( aLines >> aState );
+}
+
+TEST_F( StatePatternTest, ForgetTracesOfFinishedThreads )
+{
+   TracedContext aContext;
+   for( int i = 0; i < 10; ++i )
+   {
+      std::thread{ [&aContext] { aContext.handle( 1 ); } }.join();
+   }
+
+   aContext.handle( 1 );
 
+   std::size_t aCount = 0;
+   for( const TraceRecord& aRecord : TraceRing::collect() )
+   {
+      if( aRecord.theContext == static_cast<const void*>( &aContext ) )
+      {
+         ++aCount;
+      }
+   }
+
+   ASSERT_EQ( aContext.theNumber, 0 );
+   ASSERT_EQ( aCount, 1u );
+}
+
+TEST_F( StatePatternTest, SnapshotAndRestoreStates )
+{
+   std::vector<SnapshotContext> aContexts( 3 );
+   aContexts[0].handle( 2 );
+   aContexts[0].handle( 3 );
+   aContexts[1].handle( 10 );
+   aContexts[2].changeState( Counting{} );
+
+   std::vector<SnapshotContext::Snapshot> aSnapshots( aContexts.size() );
+   for( std::size_t i = 0; i < aContexts.size(); ++i )
+   {
+      aContexts[i].snapshot( aSnapshots[i] );
+   }
+
+   std::ostringstream anOutput;
+   writeSnapshots( anOutput, aSnapshots.data(), aSnapshots.size() );
+   const std::string aFile = anOutput.str();
+
+   std::size_t aCount = 0;
+   const SnapshotContext::Snapshot* aRestored =
+      readSnapshots<Counting, Summing>( aFile.data(), aFile.size(), aCount );
+   ASSERT_NE( aRestored, nullptr );
+   ASSERT_EQ( aCount, 3u );
+
+   std::vector<SnapshotContext> aStandbys( aCount );
+   for( std::size_t i = 0; i < aCount; ++i )
+   {
+      ASSERT_TRUE( aStandbys[i].restore( aRestored[i] ) );
+      aStandbys[i].handle( 4 );
+   }
+
+   ASSERT_EQ( aStandbys[0].theNumber, 9 );
+   ASSERT_EQ( aStandbys[1].theNumber, 14 );
+   ASSERT_EQ( aStandbys[2].theNumber, 4 );
+
+   ASSERT_EQ( ( readSnapshots<Counting, Summing>( aFile.data(), aFile.size() - 1, aCount ) ), nullptr );
+   ASSERT_EQ( ( readSnapshots<Summing>( aFile.data(), aFile.size(), aCount ) ), nullptr );
+}
@@ -1,4 +1,8 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <typeinfo>
+#include <vector>
 #include "cpp14/Publisher.hpp"
 
 using namespace ::testing;
@@ -19,17 +23,15 @@ struct ObserverAndAsyncPublisherTest : public Test
    {
       void update( const NumberModel& aSubject )
       {
-         theNumber = aSubject.theNumber;
-
          std::unique_lock<std::mutex> aLock( theMutex );
+         theNumber = aSubject.theNumber;
          theReadyData.notify_one();
       }
 
       void update( const LetterModel& aSubject )
       {
-         theLetter = aSubject.theLetter;
-
          std::unique_lock<std::mutex> aLock( theMutex );
+         theLetter = aSubject.theLetter;
          theReadyData.notify_one();
       }
 
@@ -44,9 +46,28 @@ struct ObserverAndAsyncPublisherTest : public Test
    {
       void update( const NumberModel& aSubject )
       {
+         std::unique_lock<std::mutex> aLock( theMutex );
          theNumber = aSubject.theNumber;
+         theReadyData.notify_one();
+      }
+
+      int theNumber{};
 
+      std::mutex theMutex;
+      std::condition_variable theReadyData;
+   };
+
+   struct SpinningModel : public BasicAsyncPublisher<SpinningModel, SpinParkWait>
+   {
+      int theNumber{ 42 };
+   };
+
+   struct SpinningView : public Subscriber<SpinningModel>
+   {
+      void update( const SpinningModel& aSubject )
+      {
          std::unique_lock<std::mutex> aLock( theMutex );
+         theNumber = aSubject.theNumber;
          theReadyData.notify_one();
       }
 
@@ -153,3 +174,73 @@ TEST_F(ObserverAndAsyncPublisherTest, TwoObserverWatchesTwoSubjects)
    ASSERT_EQ( aView2->theLetter, 'j' );
 }
 
+
+TEST_F(ObserverAndAsyncPublisherTest, SubjectWithSpinningDispatcher)
+{
+   std::shared_ptr<SpinningView> aView = std::make_shared<SpinningView>();
+
+   SpinningModel aModel;
+   aModel.start();
+   aModel.attach( aView );
+   aModel.notify();
+
+   std::unique_lock<std::mutex> aLock( aView->theMutex );
+   aView->theReadyData.wait( aLock, [aView] { return aView->theNumber == 42; } );
+
+   ASSERT_EQ( aView->theNumber, 42 );
+}
+
+TEST_F(ObserverAndAsyncPublisherTest, RegisterMetricsOnlyForStartedSubjects)
+{
+   struct CountedModel : public AsyncPublisher<CountedModel>
+   {
+      int theNumber{ 5 };
+   };
+
+   // Cuenta las métricas registradas para el modelo.
+   static const auto registered = [] {
+      const std::vector<QueueSnapshot> aQueues = QueueMetrics::collect();
+      return std::count_if( aQueues.begin(), aQueues.end(), []( const QueueSnapshot& aQueue ) {
+                               return aQueue.theName == typeid( CountedModel ).name();
+                            } );
+   };
+
+   struct CountedView : public Subscriber<CountedModel>
+   {
+      void update( const CountedModel& aSubject )
+      {
+         // La copia entregada sigue viva mientras se notifica.
+         const auto aRegistered = registered();
+         std::unique_lock<std::mutex> aLock( theMutex );
+         theTotal += aSubject.theNumber;
+         theRegistered = std::max<long>( theRegistered, aRegistered );
+         theReadyData.notify_one();
+      }
+
+      int theTotal{};
+      long theRegistered{};
+
+      std::mutex theMutex;
+      std::condition_variable theReadyData;
+   };
+
+   std::shared_ptr<CountedView> aView = std::make_shared<CountedView>();
+   {
+      CountedModel aModel;
+      aModel.deliver();
+      aModel.start();
+      aModel.attach( aView );
+      for( int i = 0; i < 100; ++i )
+      {
+         aModel.deliver();
+      }
+
+      std::unique_lock<std::mutex> aLock( aView->theMutex );
+      aView->theReadyData.wait( aLock, [aView] { return aView->theTotal == 500; } );
+
+      ASSERT_EQ( aView->theRegistered, 1 );
+      ASSERT_EQ( aModel.metrics().snapshot().theDropped, 1u );
+   }
+
+   ASSERT_EQ( registered(), 0 );
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+#include "cpp14/TimingWheel.hpp"
+
+using namespace ::testing;
+
+struct TimingWheelTest : public Test
+{
+   using Wheel = TimingWheel<std::uint64_t>;
+
+   // Guarda cada objeto con su propio vencimiento como valor.
+   static TimerHandle insert( Wheel& aWheel, std::uint64_t aTick )
+   {
+      return aWheel.insert( aTick, std::uint64_t{ aTick } );
+   }
+
+   // Avanza la rueda como lo hace AsyncQueue, de un paso de next() al siguiente, hasta vaciarla, y
+   // cuenta los objetos que no vencen exactamente en su paso.
+   static std::size_t drain( Wheel& aWheel, std::vector<std::uint64_t>* anExpired = nullptr )
+   {
+      std::size_t aMismatches = 0;
+      while( !aWheel.empty() )
+      {
+         const std::uint64_t aTick = aWheel.next();
+         aWheel.advance( aTick, [&]( std::uint64_t anObject ) {
+                            aMismatches += anObject != aTick;
+                            if( anExpired )
+                            {
+                               anExpired->push_back( anObject );
+                            }
+                         } );
+      }
+
+      return aMismatches;
+   }
+};
+
+TEST_F(TimingWheelTest, ExpireAtCascadeBoundaries)
+{
+   Wheel aWheel;
+   const std::vector<std::uint64_t> aTicks{ 0, 1, 255, 256, 257, 511, 512, 65535, 65536, 65537, 70000,
+                                            ( 1u << 24 ) - 1, 1u << 24, ( 1u << 24 ) + 1 };
+   for( std::uint64_t aTick : aTicks )
+   {
+      insert( aWheel, aTick );
+   }
+
+   std::vector<std::uint64_t> anExpired;
+   ASSERT_EQ( drain( aWheel, &anExpired ), 0u );
+   ASSERT_EQ( anExpired, aTicks );
+}
+
+TEST_F(TimingWheelTest, NextSeesPendingCascade)
+{
+   Wheel aWheel;
+   insert( aWheel, 300 );
+   aWheel.advance( 255, []( std::uint64_t ) { FAIL(); } );
+
+   ASSERT_EQ( aWheel.current(), 256u );
+   ASSERT_EQ( aWheel.next(), 256u );
+
+   aWheel.advance( aWheel.next(), []( std::uint64_t ) { FAIL(); } );
+
+   ASSERT_EQ( aWheel.next(), 300u );
+   ASSERT_EQ( drain( aWheel ), 0u );
+}
+
+TEST_F(TimingWheelTest, ExpireRandomTimersOnTime)
+{
+   Wheel aWheel;
+   std::mt19937_64 aRandom{ 7 };
+   std::uniform_int_distribution<std::uint64_t> aDelay{ 0, 1u << 18 };
+   for( int i = 0; i < 100000; ++i )
+   {
+      insert( aWheel, aDelay( aRandom ) );
+   }
+
+   // A mitad de camino se añaden más temporizadores relativos al paso actual.
+   aWheel.advance( 100000, []( std::uint64_t ) {} );
+   for( int i = 0; i < 100000; ++i )
+   {
+      insert( aWheel, aWheel.current() + aDelay( aRandom ) );
+   }
+
+   ASSERT_EQ( drain( aWheel ), 0u );
+}
+
+TEST_F(TimingWheelTest, ExpireFarTimers)
+{
+   Wheel aWheel;
+   const std::uint64_t aFar = ( std::uint64_t{ 1 } << 32 ) + 7;
+   insert( aWheel, ( 1u << 16 ) + 5 );
+   insert( aWheel, aFar );
+
+   std::vector<std::uint64_t> anExpired;
+   aWheel.advance( aFar - 1, [&anExpired]( std::uint64_t anObject ) { anExpired.push_back( anObject ); } );
+
+   ASSERT_EQ( anExpired, ( std::vector<std::uint64_t>{ ( 1u << 16 ) + 5 } ) );
+   ASSERT_EQ( aWheel.size(), 1u );
+
+   aWheel.advance( aFar, [&anExpired]( std::uint64_t anObject ) { anExpired.push_back( anObject ); } );
+
+   ASSERT_EQ( anExpired.back(), aFar );
+   ASSERT_TRUE( aWheel.empty() );
+}
+
+TEST_F(TimingWheelTest, ExpireLateInsertionsOnNextTick)
+{
+   Wheel aWheel;
+   insert( aWheel, 10 );
+   aWheel.advance( 10, []( std::uint64_t ) {} );
+   aWheel.insert( 3, 3 );
+
+   std::vector<std::uint64_t> anExpired;
+   aWheel.advance( 11, [&anExpired]( std::uint64_t anObject ) { anExpired.push_back( anObject ); } );
+
+   ASSERT_EQ( anExpired, ( std::vector<std::uint64_t>{ 3 } ) );
+}
+
+TEST_F(TimingWheelTest, IgnoreStaleHandles)
+{
+   Wheel aWheel;
+   const TimerHandle anExpired = insert( aWheel, 1 );
+   const TimerHandle aCancelled = insert( aWheel, 2 );
+   aWheel.advance( 1, []( std::uint64_t ) {} );
+
+   ASSERT_FALSE( aWheel.cancel( anExpired ) );
+   ASSERT_TRUE( aWheel.cancel( aCancelled ) );
+   ASSERT_FALSE( aWheel.cancel( aCancelled ) );
+   ASSERT_FALSE( aWheel.cancel( TimerHandle{ 1000, 0 } ) );
+
+   // Las posiciones liberadas se reutilizan, pero los identificadores antiguos no las cancelan.
+   const TimerHandle aReused = insert( aWheel, 5 );
+   ASSERT_TRUE( aReused.theIndex == anExpired.theIndex || aReused.theIndex == aCancelled.theIndex );
+   ASSERT_FALSE( aWheel.cancel( anExpired ) );
+   ASSERT_FALSE( aWheel.cancel( aCancelled ) );
+   ASSERT_EQ( aWheel.size(), 1u );
+
+   std::vector<std::uint64_t> anExpiredObjects;
+   ASSERT_EQ( drain( aWheel, &anExpiredObjects ), 0u );
+   ASSERT_EQ( anExpiredObjects, ( std::vector<std::uint64_t>{ 5 } ) );
+}
@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "cpp17/StateContextArray.hpp"
+
+using namespace ::testing;
+
+struct StateContextArrayTest : public Test
+{
+   // Los datos de cada máquina: las entradas que ha tratado y la tarea que las trató.
+   struct Counter
+   {
+      std::vector<int> theInputs;
+
+      std::thread::id theThread;
+
+      bool isShared{};
+
+      void record( int n )
+      {
+         if( theInputs.empty() )
+         {
+            theThread = std::this_thread::get_id();
+         }
+         else if( theThread != std::this_thread::get_id() )
+         {
+            isShared = true;
+         }
+
+         theInputs.push_back( n );
+      }
+   };
+
+   // Un estado sin datos que guarda los enteros y pasa a Negative con el primero negativo.
+   class Positive : public State<int>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aCounter, int n ) const;
+   };
+
+   // Un estado con datos que guarda los enteros sumándoles su desplazamiento y vuelve a Positive
+   // con el cero.
+   class Negative : public State<int>
+   {
+   public:
+
+      Negative() = default;
+
+      explicit Negative( int anOffset )
+         :
+         theOffset{ anOffset }
+      {
+
+      }
+
+      template<typename C>
+      void handle( C& aCounter, int n ) const
+      {
+         aCounter->record( n + theOffset );
+         if( n == 0 )
+         {
+            aCounter.changeState( Positive{} );
+         }
+      }
+
+   private:
+
+      int theOffset{};
+   };
+
+   using Counters = BasicStateContextArray<CountUnhandled, Counter, Positive, Negative>;
+
+   static constexpr std::size_t theSize = 64;
+
+   static constexpr int theInputs = 50;
+
+   StateContextArrayTest()
+   {
+      for( std::size_t i = 0; i < theSize; ++i )
+      {
+         theCounters.add( Counter{}, Positive{} );
+      }
+   }
+
+   // Un lote con theInputs entradas por máquina, intercaladas.
+   std::vector<std::pair<std::size_t, int>> makeBatch() const
+   {
+      std::vector<std::pair<std::size_t, int>> aBatch;
+      for( int n = 0; n < theInputs; ++n )
+      {
+         for( std::size_t i = 0; i < theSize; ++i )
+         {
+            aBatch.emplace_back( i, n % 7 == 3 ? -n : n );
+         }
+      }
+
+      return aBatch;
+   }
+
+   Counters theCounters;
+};
+
+template<typename C>
+void StateContextArrayTest::Positive::handle( C& aCounter, int n ) const
+{
+   aCounter->record( n );
+   if( n < 0 )
+   {
+      aCounter.changeState( Negative{ 1000 } );
+   }
+}
+
+TEST_F(StateContextArrayTest, DelegateToCurrentState)
+{
+   ASSERT_TRUE( theCounters.delegate( 2, 1 ) );
+   ASSERT_TRUE( theCounters.delegate( 2, -1 ) );
+   ASSERT_TRUE( theCounters.delegate( 2, 5 ) );
+   ASSERT_TRUE( theCounters.delegate( 2, 0 ) );
+   ASSERT_TRUE( theCounters.delegate( 2, 5 ) );
+
+   ASSERT_EQ( theCounters[2].theInputs, ( std::vector<int>{ 1, -1, 1005, 1000, 5 } ) );
+   ASSERT_EQ( theCounters.stateOf( 2 ), 0u );
+   ASSERT_TRUE( theCounters[1].theInputs.empty() );
+}
+
+TEST_F(StateContextArrayTest, ProcessBatchInOrder)
+{
+   const std::vector<std::pair<std::size_t, int>> aBatch = makeBatch();
+   Counters anExpected;
+   for( std::size_t i = 0; i < theSize; ++i )
+   {
+      anExpected.add( Counter{}, Positive{} );
+   }
+
+   for( const auto& anItem : aBatch )
+   {
+      anExpected.delegate( anItem.first, anItem.second );
+   }
+
+   ASSERT_EQ( theCounters.processBatch( aBatch.begin(), aBatch.end() ), 0u );
+
+   for( std::size_t i = 0; i < theSize; ++i )
+   {
+      ASSERT_EQ( theCounters[i].theInputs.size(), static_cast<std::size_t>( theInputs ) );
+      ASSERT_EQ( theCounters[i].theInputs, anExpected[i].theInputs );
+      ASSERT_EQ( theCounters.stateOf( i ), anExpected.stateOf( i ) );
+   }
+}
+
+TEST_F(StateContextArrayTest, ProcessPartitionsInParallel)
+{
+   const std::vector<std::pair<std::size_t, int>> aBatch = makeBatch();
+   Counters anExpected;
+   for( std::size_t i = 0; i < theSize; ++i )
+   {
+      anExpected.add( Counter{}, Positive{} );
+   }
+
+   for( int aRepetition = 0; aRepetition < 3; ++aRepetition )
+   {
+      anExpected.processBatch( aBatch.begin(), aBatch.end() );
+      ASSERT_EQ( theCounters.processBatch( aBatch.begin(), aBatch.end(), 4 + aRepetition ), 0u );
+   }
+
+   for( std::size_t i = 0; i < theSize; ++i )
+   {
+      ASSERT_EQ( theCounters[i].theInputs, anExpected[i].theInputs );
+      ASSERT_EQ( theCounters.stateOf( i ), anExpected.stateOf( i ) );
+   }
+
+   // Con el mismo número de particiones, cada máquina se trata siempre en la misma tarea.
+   for( int aRepetition = 0; aRepetition < 3; ++aRepetition )
+   {
+      for( std::size_t i = 0; i < theSize; ++i )
+      {
+         theCounters[i] = Counter{};
+      }
+
+      theCounters.processBatch( aBatch.begin(), aBatch.end(), 4 );
+      for( std::size_t i = 0; i < theSize; ++i )
+      {
+         ASSERT_FALSE( theCounters[i].isShared );
+         ASSERT_EQ( theCounters[i].theThread, theCounters[i / ( theSize / 4 ) * ( theSize / 4 )].theThread );
+      }
+
+      ASSERT_NE( theCounters[0].theThread, theCounters[theSize - 1].theThread );
+      ASSERT_EQ( theCounters[0].theThread, std::this_thread::get_id() );
+   }
+}
+
+TEST_F(StateContextArrayTest, DiscardUnknownMachines)
+{
+   const std::vector<std::pair<std::size_t, int>> aBatch{ { 0, 1 }, { theSize, 2 }, { 1, 3 }, { static_cast<std::size_t>( -1 ), 4 }, { theSize - 1, 5 } };
+
+   ASSERT_FALSE( theCounters.delegate( theSize, 1 ) );
+   ASSERT_EQ( theCounters.processBatch( aBatch.begin(), aBatch.end(), 3 ), 2u );
+   ASSERT_EQ( theCounters.processBatch( aBatch.begin(), aBatch.end() ), 2u );
+
+   ASSERT_EQ( theCounters[0].theInputs, ( std::vector<int>{ 1, 1 } ) );
+   ASSERT_EQ( theCounters[1].theInputs, ( std::vector<int>{ 3, 3 } ) );
+   ASSERT_EQ( theCounters[theSize - 1].theInputs, ( std::vector<int>{ 5, 5 } ) );
+
+   Counters anEmpty;
+   ASSERT_FALSE( anEmpty.delegate( 0, 1 ) );
+   ASSERT_EQ( anEmpty.processBatch( aBatch.begin(), aBatch.end(), 2 ), aBatch.size() );
+}
+
+TEST_F(StateContextArrayTest, CountUnhandledInputs)
+{
+   ASSERT_TRUE( theCounters.delegate( 0, 'c' ) );
+
+   ASSERT_EQ( ( theCounters.unhandledCount<Positive, char>() ), 1u );
+   ASSERT_TRUE( theCounters[0].theInputs.empty() );
+}
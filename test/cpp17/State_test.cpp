@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <variant>
+#include "cpp17/State.hpp"
+
+using namespace ::testing;
+
+struct StateTest : public Test
+{
+   // Una entrada que solo puede moverse.
+   struct Parcel
+   {
+      std::unique_ptr<std::string> theContent;
+   };
+
+   class Closed;
+
+   // Un estado que acumula enteros, guarda los paquetes y pasa a Closed con cualquier carácter.
+   class Open : public State<int, char, Parcel>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, int n ) const
+      {
+         aContext.theNumber += n;
+      }
+
+      template<typename C>
+      void handle( C& aContext, char ) const;
+
+      template<typename C>
+      void handle( C& aContext, Parcel&& aParcel ) const
+      {
+         if( !aParcel.theContent )
+         {
+            throw std::move( aParcel );
+         }
+
+         aContext.theContent += *aParcel.theContent;
+         if( aParcel.theContent->size() > 1 )
+         {
+            aContext.post( Parcel{ std::make_unique<std::string>( aParcel.theContent->substr( 1 ) ) } );
+            aContext.post( 1 );
+         }
+      }
+   };
+
+   // Un estado que solo trata caracteres, con los que vuelve a Open.
+   class Closed : public State<char>
+   {
+   public:
+
+      template<typename C>
+      void handle( C& aContext, char ) const
+      {
+         aContext.changeState( Open{} );
+      }
+   };
+
+   // Un estado cuya construcción falla. No se copia trivialmente, así que la máquina se queda sin
+   // estado al intentar construirlo.
+   struct Broken : public State<int>
+   {
+      explicit Broken( int n )
+      {
+         throw n;
+      }
+
+      template<typename C>
+      void handle( C&, int ) const {}
+
+      std::string theReason;
+   };
+
+   struct Door : public BasicStateContext<CountUnhandled, Door, Open, Closed, Broken>
+   {
+      Door()
+      {
+         changeState( Open{} );
+      }
+
+      int theNumber{};
+
+      std::string theContent;
+   };
+};
+
+template<typename C>
+void StateTest::Open::handle( C& aContext, char ) const
+{
+   aContext.changeState( Closed{} );
+}
+
+TEST_F(StateTest, DelegateToCurrentState)
+{
+   Door aDoor;
+   const int aNumber = 7;
+
+   aDoor.delegate( 3 );
+   aDoor.delegate( aNumber );
+   aDoor.delegate( 'c' );
+   aDoor.delegate( 5 );
+   aDoor.delegate( 'o' );
+   aDoor.delegate( 1 );
+
+   ASSERT_EQ( aDoor.theNumber, 11 );
+}
+
+TEST_F(StateTest, ForwardInputsWithoutCopies)
+{
+   Door aDoor;
+
+   aDoor.delegate( Parcel{ std::make_unique<std::string>( "C" ) } );
+
+   ASSERT_EQ( aDoor.theContent, "C" );
+}
+
+TEST_F(StateTest, CountUnhandledInputs)
+{
+   Door aDoor;
+
+   aDoor.delegate( 'c' );
+   aDoor.delegate( 5 );
+   aDoor.delegate( 6 );
+   aDoor.delegate( 2.5 );
+
+   ASSERT_EQ( aDoor.theNumber, 0 );
+   ASSERT_EQ( ( aDoor.unhandledCount<Closed, int>() ), 2u );
+   ASSERT_EQ( ( aDoor.unhandledCount<Closed, double>() ), 1u );
+   ASSERT_EQ( ( aDoor.unhandledCount<Open, int>() ), 0u );
+}
+
+TEST_F(StateTest, RejectInputsWithoutState)
+{
+   Door aDoor;
+
+   ASSERT_THROW( aDoor.emplaceState<Broken>( 1 ), int );
+   ASSERT_THROW( aDoor.delegate( 1 ), std::bad_variant_access );
+
+   aDoor.changeState( Open{} );
+   aDoor.delegate( 1 );
+
+   ASSERT_EQ( aDoor.theNumber, 1 );
+}
+
+TEST_F(StateTest, PostMoveOnlyInputs)
+{
+   Door aDoor;
+
+   aDoor.delegate( Parcel{ std::make_unique<std::string>( "abc" ) } );
+
+   ASSERT_EQ( aDoor.theContent, "abcbcc" );
+   ASSERT_EQ( aDoor.theNumber, 2 );
+}
+
+TEST_F(StateTest, RecoverFromThrowingHandler)
+{
+   Door aDoor;
+
+   ASSERT_THROW( aDoor.delegate( Parcel{} ), Parcel );
+   aDoor.delegate( Parcel{ std::make_unique<std::string>( "ab" ) } );
+
+   ASSERT_EQ( aDoor.theContent, "abb" );
+   ASSERT_EQ( aDoor.theNumber, 1 );
+}
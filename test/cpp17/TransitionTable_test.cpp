@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include "cpp17/TransitionTable.hpp"
+
+using namespace ::testing;
+
+struct TransitionTableTest : public Test
+{
+   struct Closed {};
+   struct Listening {};
+   struct Established {};
+
+   struct Open {};
+   struct Synchronize
+   {
+      int theSequence;
+   };
+   struct Close {};
+
+   // Guarda en el registro de la conexión la secuencia recibida.
+   struct SendAck
+   {
+      template<typename C>
+      void operator()( C& aConnection, const Synchronize& aSynchronize ) const
+      {
+         aConnection.theLog += "ack" + std::to_string( aSynchronize.theSequence ) + ' ';
+      }
+   };
+
+   struct CountClose
+   {
+      template<typename C>
+      void operator()( C& aConnection, const Close& ) const
+      {
+         ++aConnection.theCloses;
+      }
+   };
+
+   using TcpTable = TransitionTable<Transition<Closed, Open, Listening>,
+                                    Transition<Listening, Synchronize, Established, SendAck>,
+                                    Transition<Listening, Close, Closed, CountClose>,
+                                    Transition<Established, Close, Closed, CountClose>>;
+
+   struct TcpConnection : public BasicTableStateContext<CountUnhandled, TcpConnection, TcpTable>
+   {
+      std::string theLog;
+
+      int theCloses{};
+   };
+};
+
+TEST_F(TransitionTableTest, DeduceStatesAndInputs)
+{
+   static_assert( std::is_same_v<TcpTable::States, std::tuple<Closed, Listening, Established>> );
+   static_assert( std::is_same_v<TcpTable::Inputs, std::tuple<Open, Synchronize, Close>> );
+   static_assert( std::is_same_v<Unique<int, char, int, double, char>, std::tuple<int, char, double>> );
+
+   TcpConnection aConnection;
+
+   ASSERT_TRUE( aConnection.isIn<Closed>() );
+}
+
+TEST_F(TransitionTableTest, FollowTransitions)
+{
+   TcpConnection aConnection;
+
+   aConnection.delegate( Open{} );
+   ASSERT_TRUE( aConnection.isIn<Listening>() );
+
+   aConnection.delegate( Synchronize{ 7 } );
+   ASSERT_TRUE( aConnection.isIn<Established>() );
+
+   const Close aClose;
+   aConnection.delegate( aClose );
+   ASSERT_TRUE( aConnection.isIn<Closed>() );
+
+   aConnection.delegate( Open{} );
+   aConnection.delegate( Close{} );
+   ASSERT_TRUE( aConnection.isIn<Closed>() );
+
+   ASSERT_EQ( aConnection.theLog, "ack7 " );
+   ASSERT_EQ( aConnection.theCloses, 2 );
+}
+
+TEST_F(TransitionTableTest, ReportUnhandledInputs)
+{
+   struct Connection : public BasicTableStateContext<CallbackUnhandled, Connection, TcpTable>
+   {
+      std::string theLog;
+
+      int theCloses{};
+   };
+
+   Connection aConnection;
+   std::vector<std::pair<std::size_t, std::type_index>> anUnhandled;
+   aConnection.onUnhandled( [&anUnhandled]( std::size_t aState, const std::type_info& anInput )
+   {
+      anUnhandled.emplace_back( aState, anInput );
+   } );
+
+   aConnection.delegate( Close{} );
+   aConnection.delegate( Synchronize{ 1 } );
+   aConnection.delegate( Open{} );
+   aConnection.delegate( Open{} );
+   aConnection.delegate( Synchronize{ 2 } );
+   aConnection.delegate( Open{} );
+
+   ASSERT_TRUE( aConnection.isIn<Established>() );
+   ASSERT_EQ( aConnection.theLog, "ack2 " );
+   ASSERT_EQ( aConnection.theCloses, 0 );
+   ASSERT_EQ( anUnhandled, ( std::vector<std::pair<std::size_t, std::type_index>>{
+      { 0, typeid( Close ) }, { 0, typeid( Synchronize ) }, { 1, typeid( Open ) }, { 2, typeid( Open ) } } ) );
+}
+
+TEST_F(TransitionTableTest, CountUnhandledInputs)
+{
+   TcpConnection aConnection;
+
+   aConnection.delegate( Close{} );
+   aConnection.delegate( Synchronize{ 1 } );
+   aConnection.delegate( Open{} );
+   aConnection.delegate( Open{} );
+
+   // Los estados de la tabla no declaran sus entradas, así que se cuentan juntas por estado.
+   ASSERT_TRUE( aConnection.isIn<Listening>() );
+   ASSERT_EQ( ( aConnection.unhandledCount<Closed, Close>() ), 2u );
+   ASSERT_EQ( ( aConnection.unhandledCount<Listening, Open>() ), 1u );
+   ASSERT_EQ( ( aConnection.unhandledCount<Established, Open>() ), 0u );
+}